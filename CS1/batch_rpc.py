@@ -0,0 +1,240 @@
+# batch_rpc.py
+"""
+Batched, pipelined RPC for the CS1 consumer.
+
+The consumer of Activity1.md calls rpc_proxy.process_message() once per
+message and waits for each answer, so it can never do more than one
+message per round trip. This module removes that limit in three ways:
+
+- Batching: process_messages(list) processes a whole array in one call.
+  The standard XML-RPC multicall (system.multicall) is also enabled.
+- Pipelining: PipelinedRPCClient keeps up to 'window' batch requests
+  outstanding on ONE keep-alive connection. It sends the next batch
+  before the previous answers arrive and reads the answers in order, so
+  the round trip is overlapped instead of paid per message.
+- Encodings:
+    "xml"     XML-RPC over HTTP/1.1, the same protocol as rpc_server.py,
+              with several requests in flight on the connection
+    "binary"  compact frames on a plain TCP port:
+                u32 length | u32 request id | u8 method | payload
+              where the payload of a batch is u32 count, then
+              (u32 length | UTF-8 text) per message
+
+Server (replaces rpc_server.py; process_message still works for old
+clients):
+    python batch_rpc.py [--port 8000] [--binary-port 8001]
+
+Client:
+    client = PipelinedRPCClient("localhost", 8000, encoding="xml",
+                                batch_size=64, window=4, on_results=print)
+    for message in messages:
+        client.call(message)        # sends a batch whenever one is full
+    client.flush()                  # sends the rest and waits for every answer
+"""
+
+import argparse
+import collections
+import socket
+import socketserver
+import struct
+import threading
+import xmlrpc.client
+from xmlrpc.server import SimpleXMLRPCRequestHandler, SimpleXMLRPCServer
+
+FRAME = struct.Struct("!IIB")       # payload length, request id, method
+COUNT = struct.Struct("!I")
+METHOD_PROCESS_MESSAGES = 1
+
+
+# --- The RPC functions ---
+def process_message(message):
+    """Same function as rpc_server.py: append a marker to the message."""
+    return f"{message} [Processed by RPC]"
+
+
+def process_messages(messages):
+    """Array endpoint: one call processes a whole batch."""
+    return [process_message(m) for m in messages]
+
+
+# --- Binary encoding ---
+def encode_strings(strings):
+    parts = [COUNT.pack(len(strings))]
+    for s in strings:
+        data = s.encode()
+        parts.append(COUNT.pack(len(data)))
+        parts.append(data)
+    return b"".join(parts)
+
+
+def decode_strings(payload):
+    view = memoryview(payload)
+    count = COUNT.unpack_from(view)[0]
+    offset = COUNT.size
+    strings = []
+    for _ in range(count):
+        n = COUNT.unpack_from(view, offset)[0]
+        offset += COUNT.size
+        strings.append(str(view[offset:offset + n], "utf-8"))
+        offset += n
+    return strings
+
+
+# --- Servers ---
+class KeepAliveRequestHandler(SimpleXMLRPCRequestHandler):
+    # HTTP/1.1 keeps the connection open between calls, and the handler
+    # reads requests one after another from it, so pipelined requests work
+    protocol_version = "HTTP/1.1"
+    rpc_paths = ("/", "/RPC2")
+
+    def log_message(self, format, *args):
+        pass
+
+
+class ThreadedXMLRPCServer(socketserver.ThreadingMixIn, SimpleXMLRPCServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+
+class BinaryRequestHandler(socketserver.StreamRequestHandler):
+    def setup(self):
+        super().setup()
+        self.connection.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+
+    def handle(self):
+        while True:
+            header = self.rfile.read(FRAME.size)
+            if len(header) < FRAME.size:
+                return
+            length, request_id, method = FRAME.unpack(header)
+            payload = self.rfile.read(length)
+            if len(payload) < length or method != METHOD_PROCESS_MESSAGES:
+                return
+            reply = encode_strings(process_messages(decode_strings(payload)))
+            self.wfile.write(FRAME.pack(len(reply), request_id, method) + reply)
+
+
+class ThreadedBinaryServer(socketserver.ThreadingMixIn, socketserver.TCPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+
+def make_servers(host, port, binary_port):
+    xml_server = ThreadedXMLRPCServer((host, port), requestHandler=KeepAliveRequestHandler,
+                                      logRequests=False, allow_none=True)
+    xml_server.register_function(process_message, "process_message")
+    xml_server.register_function(process_messages, "process_messages")
+    xml_server.register_multicall_functions()
+    binary_server = ThreadedBinaryServer((host, binary_port), BinaryRequestHandler)
+    return xml_server, binary_server
+
+
+# --- Client ---
+class PipelinedRPCClient:
+    """Batches calls and keeps up to 'window' batches in flight on one connection.
+
+    on_results(results) is called with the list of results of every batch,
+    in the order in which the batches were sent.
+    """
+
+    def __init__(self, host, port, encoding="xml", batch_size=64, window=4, on_results=None):
+        if encoding not in ("xml", "binary"):
+            raise ValueError("encoding must be 'xml' or 'binary'")
+        self.host = host
+        self.encoding = encoding
+        self.batch_size = batch_size
+        self.window = window
+        self.on_results = on_results or (lambda results: None)
+        self.sock = socket.create_connection((host, port))
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.reader = self.sock.makefile("rb")
+        self.batch = []
+        self.in_flight = collections.deque()    # request ids, oldest first
+        self.next_id = 1
+
+    def call(self, message):
+        self.batch.append(message)
+        if len(self.batch) >= self.batch_size:
+            self._send_batch()
+
+    def flush(self):
+        """Sends the partial batch and waits for every outstanding answer."""
+        if self.batch:
+            self._send_batch()
+        while self.in_flight:
+            self._receive_one()
+
+    @property
+    def pending(self):
+        return bool(self.batch or self.in_flight)
+
+    def close(self):
+        self.flush()
+        self.reader.close()
+        self.sock.close()
+
+    def _send_batch(self):
+        if len(self.in_flight) >= self.window:
+            self._receive_one()             # the window is full: wait for the oldest answer
+        request_id = self.next_id
+        self.next_id = (self.next_id + 1) & 0xFFFFFFFF
+        if self.encoding == "xml":
+            body = xmlrpc.client.dumps((self.batch,), "process_messages").encode()
+            request = (f"POST /RPC2 HTTP/1.1\r\nHost: {self.host}\r\n"
+                       f"Content-Type: text/xml\r\nContent-Length: {len(body)}\r\n\r\n").encode() + body
+        else:
+            payload = encode_strings(self.batch)
+            request = FRAME.pack(len(payload), request_id, METHOD_PROCESS_MESSAGES) + payload
+        self.sock.sendall(request)
+        self.in_flight.append(request_id)
+        self.batch = []
+
+    def _receive_one(self):
+        request_id = self.in_flight.popleft()
+        if self.encoding == "xml":
+            results = self._read_http_response()
+        else:
+            header = self.reader.read(FRAME.size)
+            if len(header) < FRAME.size:
+                raise ConnectionError("RPC server closed the connection")
+            length, reply_id, _ = FRAME.unpack(header)
+            if reply_id != request_id:
+                raise ConnectionError(f"answer {reply_id} does not match request {request_id}")
+            results = decode_strings(self.reader.read(length))
+        self.on_results(results)
+
+    def _read_http_response(self):
+        status = self.reader.readline()
+        if not status:
+            raise ConnectionError("RPC server closed the connection")
+        if b" 200 " not in status:
+            raise ConnectionError(f"RPC server answered {status.decode().strip()}")
+        length = 0
+        while True:
+            line = self.reader.readline()
+            if line in (b"\r\n", b"\n", b""):
+                break
+            name, _, value = line.partition(b":")
+            if name.strip().lower() == b"content-length":
+                length = int(value)
+        return xmlrpc.client.loads(self.reader.read(length))[0][0]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Batched RPC server (XML-RPC and binary)")
+    parser.add_argument("--host", default="localhost")
+    parser.add_argument("--port", type=int, default=8000, help="XML-RPC port")
+    parser.add_argument("--binary-port", type=int, default=8001, help="binary protocol port")
+    args = parser.parse_args()
+
+    xml_server, binary_server = make_servers(args.host, args.port, args.binary_port)
+    threading.Thread(target=binary_server.serve_forever, daemon=True).start()
+    print(f"RPC Server listening on port {args.port} (XML-RPC) and {args.binary_port} (binary)...")
+    try:
+        xml_server.serve_forever()
+    except KeyboardInterrupt:
+        print("RPC Server: Shutting down.")
+
+
+if __name__ == "__main__":
+    main()
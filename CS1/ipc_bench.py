@@ -0,0 +1,154 @@
+#!/usr/bin/env python3
+"""
+Producer -> consumer IPC: multiprocessing.Pipe vs. the shared-memory ring.
+
+A producer process hands --count messages of --size bytes to a consumer
+process in one of four ways:
+
+  pipe        conn.send(message)        what socket_ipc_server.py does:
+                                        every message is pickled, one
+                                        write() and one read() per message
+  pipe-bytes  conn.send_bytes(message)  no pickling, same system calls
+  ring        ShmRing.put(message)      shared memory, one publish per message
+  ring-batch  ShmRing.put_many(batch)   shared memory, one publish per batch
+
+Two measurements per mode:
+
+  throughput  the producer sends as fast as it can; messages/sec is
+              counted from the first send to the last receive
+  latency     the producer offers --rate messages/sec (the way a socket
+              front end receives them) and hands over everything that is
+              due in one call; latency = receive time - due time, reported
+              as p50 / p99
+
+Every message starts with its due time (time.monotonic_ns(), which is the
+same clock in both processes), so the consumer can measure latency.
+
+Run examples:
+    python ipc_bench.py
+    python ipc_bench.py --count 200000 --size 256 --rate 20000
+
+No external libraries are required (Linux, Python 3.10+).
+"""
+
+import argparse
+import multiprocessing as mp
+import struct
+import time
+
+from shm_ring import ShmRing, RingClosed
+
+MODES = ("pipe", "pipe-bytes", "ring", "ring-batch")
+STAMP = struct.Struct("=Q")
+BATCH = 64                  # ring-batch: messages per put_many() in the throughput run
+
+
+def consume(mode, source, count, results):
+    """Consumer process: receives 'count' messages, records the latencies."""
+    latencies = []
+    received = 0
+    if mode.startswith("pipe"):
+        recv = source.recv if mode == "pipe" else source.recv_bytes
+        while received < count:
+            message = recv()
+            latencies.append(time.monotonic_ns() - STAMP.unpack_from(message)[0])
+            received += 1
+    else:
+        try:
+            while received < count:
+                batch = source.get_batch()
+                now = time.monotonic_ns()
+                for message in batch:
+                    latencies.append(now - STAMP.unpack_from(message)[0])
+                received += len(batch)
+        except RingClosed:
+            pass
+    results.send((time.monotonic_ns(), latencies))
+
+
+def produce(mode, sink, count, size, rate):
+    """Sends 'count' messages; paced at 'rate' per second if rate > 0."""
+    body = bytes(size - STAMP.size)
+    if mode == "pipe":
+        send_one = sink.send
+    elif mode == "pipe-bytes":
+        send_one = sink.send_bytes
+    else:
+        send_one = sink.put
+    start = time.monotonic_ns()
+    sent = 0
+    while sent < count:
+        if rate > 0:
+            # Everything that is due by now goes out in one go
+            due = min(count, (time.monotonic_ns() - start) * rate // 1_000_000_000 + 1)
+            if due <= sent:
+                time.sleep(0.0002)
+                continue
+            stamps = [start + i * 1_000_000_000 // rate for i in range(sent, due)]
+        else:
+            due = min(count, sent + BATCH)
+            stamps = [time.monotonic_ns()] * (due - sent)
+        messages = [STAMP.pack(t) + body for t in stamps]
+        if mode == "ring-batch":
+            sink.put_many(messages)
+        else:
+            for message in messages:
+                send_one(message)
+        sent = due
+    return start
+
+
+def run(mode, count, size, rate):
+    ctx = mp.get_context("fork")
+    results_recv, results_send = ctx.Pipe(duplex=False)
+    if mode.startswith("pipe"):
+        source, sink = ctx.Pipe(duplex=False)
+        ring = None
+    else:
+        ring = source = sink = ShmRing(1 << 20)
+    consumer = ctx.Process(target=consume, args=(mode, source, count, results_send))
+    consumer.start()
+    time.sleep(0.1)
+
+    start = produce(mode, sink, count, size, rate)
+    end, latencies = results_recv.recv()
+    consumer.join()
+    if ring is not None:
+        ring.close()
+    latencies.sort()
+    return {
+        "msgs_per_sec": count / ((end - start) / 1e9),
+        "p50_us": latencies[len(latencies) // 2] / 1000,
+        "p99_us": latencies[int(0.99 * (len(latencies) - 1))] / 1000,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("--count", type=int, default=100000, help="messages per run")
+    parser.add_argument("--size", type=int, default=64, help="bytes per message")
+    parser.add_argument("--rate", type=int, default=10000, help="offered load of the latency run")
+    args = parser.parse_args()
+    args.size = max(args.size, STAMP.size)
+
+    latency_count = min(args.count, args.rate * 5)
+    print(f"{args.count} messages of {args.size} bytes (throughput), "
+          f"{latency_count} at {args.rate} msgs/s (latency)\n")
+    print("| Mode       | Msgs/sec (max) | p50 latency us | p99 latency us |")
+    print("|------------|----------------|----------------|----------------|")
+    results = {}
+    for mode in MODES:
+        throughput = run(mode, args.count, args.size, 0)
+        latency = run(mode, latency_count, args.size, args.rate)
+        results[mode] = (throughput, latency)
+        print(f"| {mode:<10} | {throughput['msgs_per_sec']:14.0f} | {latency['p50_us']:14.1f} "
+              f"| {latency['p99_us']:14.1f} |")
+
+    base = results["pipe"][0]["msgs_per_sec"]
+    for mode in MODES[1:]:
+        print(f"\n{mode}: {results[mode][0]['msgs_per_sec'] / base:.1f}x the messages/sec of pipe", end="")
+    print()
+
+
+if __name__ == "__main__":
+    main()
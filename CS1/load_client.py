@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""
+Load generator for the CS1 socket servers: many clients at the same time.
+
+Each client thread connects, sends --messages lines in windows of --window
+lines (the next window is sent when all acknowledgments of the previous
+one have arrived), and records the time from sending a window to receiving
+its last acknowledgment. It prints the total messages/sec and the p50/p99
+acknowledgment latency.
+
+Run examples:
+    python load_client.py --clients 20 --messages 2000
+    python load_client.py --clients 100 --messages 500 --window 1
+
+No external libraries are required.
+"""
+
+import argparse
+import socket
+import threading
+import time
+
+ACK_LINE = b"\n"
+
+
+def run_client(host, port, client_no, messages, window, latencies, lock, barrier):
+    with socket.create_connection((host, port)) as sock:
+        barrier.wait()
+        mine = []
+        pending = b""
+        for start in range(0, messages, window):
+            n = min(window, messages - start)
+            lines = b"".join(b"client %d message %d\n" % (client_no, start + i) for i in range(n))
+            t0 = time.perf_counter()
+            sock.sendall(lines)
+            acked = 0
+            while acked < n:
+                data = sock.recv(65536)
+                if not data:
+                    raise ConnectionError("server closed the connection")
+                pending += data
+                acked += pending.count(ACK_LINE)
+                pending = pending[pending.rfind(ACK_LINE) + 1:]
+            mine.append(time.perf_counter() - t0)
+    with lock:
+        latencies.extend(mine)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("--host", default="localhost")
+    parser.add_argument("--port", type=int, default=12345)
+    parser.add_argument("--clients", type=int, default=20)
+    parser.add_argument("--messages", type=int, default=1000, help="messages per client")
+    parser.add_argument("--window", type=int, default=16, help="messages in flight per client")
+    args = parser.parse_args()
+
+    latencies, lock = [], threading.Lock()
+    barrier = threading.Barrier(args.clients + 1)
+    threads = [threading.Thread(target=run_client,
+                                args=(args.host, args.port, i, args.messages, args.window,
+                                      latencies, lock, barrier))
+               for i in range(args.clients)]
+    for t in threads:
+        t.start()
+    barrier.wait()                      # everybody is connected
+    t0 = time.perf_counter()
+    for t in threads:
+        t.join()
+    elapsed = time.perf_counter() - t0
+
+    total = args.clients * args.messages
+    latencies.sort()
+    print(f"{args.clients} clients x {args.messages} messages (window {args.window}): "
+          f"{total / elapsed:.0f} msgs/sec")
+    print(f"acknowledgment latency per window: p50 {1000 * latencies[len(latencies) // 2]:.2f} ms, "
+          f"p99 {1000 * latencies[int(0.99 * (len(latencies) - 1))]:.2f} ms")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""
+End-to-end throughput of ring_ipc_server.py against its number of consumer
+workers.
+
+For each worker count the benchmark starts the batch_rpc.py servers (behind
+the delay proxy of rpc_bench.py when --rtt-ms > 0) and ring_ipc_server.py
+with --workers N, and then runs load_client.py. The run ends when the server
+has been stopped with Ctrl-C (SIGINT) and every consumer has drained its
+ring. Throughput = messages / (end - start). The consumers' exit lines also
+show how the messages were spread and whether any client's messages were
+processed out of order.
+
+Run examples:
+    python pipeline_bench.py
+    python pipeline_bench.py --workers 1,2,4,8 --rpc-mode xml --rtt-ms 2
+    python pipeline_bench.py --rpc none --clients 40
+
+No external libraries are required.
+"""
+
+import argparse
+import multiprocessing as mp
+import os
+import re
+import signal
+import subprocess
+import sys
+import time
+
+from rpc_bench import free_port, run_delay_proxy, run_servers
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def start_rpc(rtt_ms):
+    ctx = mp.get_context("fork")
+    port, binary_port = free_port(), free_port()
+    ready = ctx.Event()
+    procs = [ctx.Process(target=run_servers, args=(port, binary_port, ready), daemon=True)]
+    procs[0].start()
+    ready.wait()
+    if rtt_ms > 0:
+        ports = []
+        for target in (port, binary_port):
+            listen, ready = free_port(), ctx.Event()
+            p = ctx.Process(target=run_delay_proxy, args=(listen, target, rtt_ms / 2000.0, ready),
+                            daemon=True)
+            p.start()
+            ready.wait()
+            procs.append(p)
+            ports.append(listen)
+        port, binary_port = ports
+    return procs, port, binary_port
+
+
+def run(workers, args, rpc_port, rpc_binary_port):
+    port = free_port()
+    rpc = "none" if args.rpc == "none" else f"http://127.0.0.1:{rpc_port}/"
+    server = subprocess.Popen(
+        [sys.executable, "ring_ipc_server.py", "--host", "127.0.0.1", "--port", str(port),
+         "--workers", str(workers), "--quiet", "--rpc", rpc, "--rpc-mode", args.rpc_mode,
+         "--rpc-binary-port", str(rpc_binary_port)],
+        cwd=HERE, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    time.sleep(1.0)
+    t0 = time.perf_counter()
+    subprocess.run([sys.executable, "load_client.py", "--host", "127.0.0.1", "--port", str(port),
+                    "--clients", str(args.clients), "--messages", str(args.messages)],
+                   cwd=HERE, check=True, stdout=subprocess.DEVNULL)
+    server.send_signal(signal.SIGINT)
+    output, _ = server.communicate()
+    elapsed = time.perf_counter() - t0
+
+    done = [(int(a), int(b)) for a, b in
+            re.findall(r"Exiting after (\d+) messages, (\d+) out of order", output)]
+    processed = sum(a for a, _ in done)
+    return {
+        "rate": processed / elapsed,
+        "processed": processed,
+        "per_worker": [a for a, _ in done],
+        "out_of_order": sum(b for _, b in done),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("--workers", default="1,2,4,8", help="comma-separated worker counts")
+    parser.add_argument("--clients", type=int, default=16)
+    parser.add_argument("--messages", type=int, default=500, help="messages per client")
+    parser.add_argument("--rpc", default="batch_rpc", help='"none" to skip the RPC call')
+    parser.add_argument("--rpc-mode", choices=["sync", "xml", "binary"], default="sync")
+    parser.add_argument("--rtt-ms", type=float, default=2.0, help="simulated RTT to the RPC server")
+    args = parser.parse_args()
+
+    procs, rpc_port, rpc_binary_port = start_rpc(args.rtt_ms) if args.rpc != "none" else ([], 0, 0)
+    total = args.clients * args.messages
+    print(f"{args.clients} clients x {args.messages} messages, RPC "
+          f"{'none' if args.rpc == 'none' else args.rpc_mode}, RTT {args.rtt_ms:.1f} ms\n")
+    print("| Workers | Msgs/sec | Speed-up | Messages per worker | Out of order |")
+    print("|---------|----------|----------|---------------------|--------------|")
+    base = None
+    for workers in (int(w) for w in args.workers.split(",")):
+        r = run(workers, args, rpc_port, rpc_binary_port)
+        base = base or r["rate"]
+        per_worker = "/".join(str(n) for n in r["per_worker"])
+        print(f"| {workers:7d} | {r['rate']:8.0f} | {r['rate'] / base:7.1f}x | {per_worker:<19} "
+              f"| {r['out_of_order']:12d} |")
+        if r["processed"] != total:
+            print(f"  warning: {r['processed']} of {total} messages processed")
+    for p in procs:
+        p.terminate()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,267 @@
+# ring_ipc_server.py
+"""
+The socket_ipc_server.py pipeline of Activity1.md, with a multi-client front
+end and the shared-memory ring in place of multiprocessing.Pipe.
+
+- Front end: the event loop of lab/server_core.py serves every client at
+  the same time (the original handles one connection at a time, so a second
+  client waits until the first one leaves). Messages are lines ending with
+  "\\n"; each one is acknowledged with one line. --shards S runs S front
+  ends on the same port (SO_REUSEPORT), each with its own workers, and
+  Ctrl-C lets connected clients finish for up to --drain-timeout seconds.
+- IPC: everything read in one round of the loop goes to the consumers with
+  one ShmRing.put_many() call per consumer. Records are
+  u32 client id | u32 per-client sequence number | UTF-8 text; nothing is
+  pickled.
+- Consumers: --workers N consumer processes, each with its own ring (so
+  every ring keeps one producer and one consumer). Clients are assigned to
+  the workers round robin, and a client's messages always go to its
+  worker, so they are processed in order; every worker checks the
+  sequence numbers.
+- Back-pressure: when a worker falls behind, its ring fills up and the
+  front end keeps up to MAX_PENDING of its records. Beyond that it stops
+  reading from the clients of that worker until the ring has room again.
+  Their TCP windows then fill up and they slow down, while clients of the
+  other workers are not affected.
+- RPC: the consumer sends its messages to the RPC server in batches, with
+  several batches in flight on one connection (batch_rpc.py), instead of
+  one blocking call per message. --rpc-mode sync keeps the original
+  one-call-per-message behaviour and works with rpc_server.py.
+
+Run:
+    python batch_rpc.py                     # RPC server, ports 8000 and 8001
+    python ring_ipc_server.py               # --rpc-mode binary for the compact encoding
+    python load_client.py --clients 20 --messages 2000
+
+Use --rpc none to measure the pipeline without the RPC call.
+"""
+
+import argparse
+import multiprocessing
+import os
+import struct
+import sys
+import time
+import urllib.parse
+import xmlrpc.client
+
+from batch_rpc import PipelinedRPCClient
+from shm_ring import ShmRing, RingClosed
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "lab"))
+from server_core import Handler, ServerCore  # noqa: E402
+
+RECORD = struct.Struct("!II")       # client id, sequence number, then the message text
+ACK = b"Message received and is being processed.\n"
+MAX_LINE = 64 * 1024                # a client sending longer lines is dropped
+FLUSH_AFTER = 0.002                 # idle time after which a partial RPC batch is sent
+MAX_PENDING = 4096                  # records held for a full ring before its clients are paused
+
+
+# --- IPC Consumer Process ---
+def consumer_process(worker, ring, args):
+    """
+    Reads batches from the ring, processes every message (uppercase and a
+    timestamp), then hands it to the RPC service, like the original consumer.
+    """
+    quiet = args.quiet
+    name = f"Consumer {worker}"
+    last_seq = {}                       # client id -> last sequence number seen
+    out_of_order = 0
+
+    def print_results(results):
+        if not quiet:
+            for rpc_result in results:
+                print(f"{name}: RPC result: {rpc_result}")
+
+    rpc_proxy = client = None
+    if args.rpc != "none":
+        if args.rpc_mode == "sync":
+            rpc_proxy = xmlrpc.client.ServerProxy(args.rpc, allow_none=True)
+        else:
+            url = urllib.parse.urlsplit(args.rpc)
+            port = args.rpc_binary_port if args.rpc_mode == "binary" else url.port or 80
+            client = PipelinedRPCClient(url.hostname, port, encoding=args.rpc_mode,
+                                        batch_size=args.rpc_batch, window=args.rpc_window,
+                                        on_results=print_results)
+
+    processed = 0
+    while True:
+        try:
+            # With RPC calls waiting in a partial batch, do not wait long for more
+            batch = ring.get_batch(timeout=FLUSH_AFTER if client and client.pending else None)
+        except RingClosed:
+            if client is not None:
+                client.close()
+            print(f"{name}: Exiting after {processed} messages, "
+                  f"{out_of_order} out of order.")
+            break
+        if not batch:
+            client.flush()
+            continue
+        for record in batch:
+            client_id, seq = RECORD.unpack_from(record)
+            message = record[RECORD.size:].decode(errors="replace")
+            if seq != last_seq.get(client_id, 0) + 1:
+                out_of_order += 1
+            last_seq[client_id] = seq
+
+            # Local processing: uppercase conversion and adding a timestamp
+            processed_msg = f"{time.strftime('%Y-%m-%d %H:%M:%S')} - {message.upper()}"
+            if not quiet:
+                print(f"{name}: Client {client_id}: {processed_msg}")
+
+            # Hand the message to the RPC service for further processing
+            try:
+                if client is not None:
+                    client.call(processed_msg)
+                elif rpc_proxy is not None:
+                    print_results([rpc_proxy.process_message(processed_msg)])
+            except Exception as e:
+                print(f"{name}: RPC call failed with error: {e}")
+            processed += 1
+    ring.close()
+
+
+# --- Multi-client Front End (the producer) ---
+class Client:
+    __slots__ = ("id", "seq", "partition")
+
+    def __init__(self, client_id, partition):
+        self.id = client_id
+        self.seq = 0
+        self.partition = partition
+
+
+class Partition:
+    """One consumer worker: its ring, records waiting for room, its clients."""
+
+    def __init__(self, ring):
+        self.ring = ring
+        self.pending = []
+        self.clients = set()
+        self.paused = False
+
+
+class RingFrontEnd(Handler):
+    """server_core handler: forwards the clients' lines to the consumer workers.
+
+    One front end runs in every shard (--shards), with its own rings and
+    consumers, so the shards share nothing.
+    """
+
+    def __init__(self, args):
+        # Create the rings before forking, so that the consumers inherit them
+        self.partitions = [Partition(ShmRing(args.ring_size)) for _ in range(args.workers)]
+        self.consumers = []
+        for p in self.partitions:
+            consumer = multiprocessing.get_context("fork").Process(
+                target=consumer_process, args=(len(self.consumers), p.ring, args))
+            consumer.start()
+            self.consumers.append(consumer)
+        self.core = None
+        self.next_id = 1
+        self.accepted = 0
+        self.feed_scheduled = False
+
+    def on_start(self, core):
+        self.core = core
+        self.next_id = core.shard + 1
+
+    def on_connect(self, conn):
+        # Round robin: each client is assigned to the next worker, and all its
+        # messages go to that worker.
+        # Ids step by the number of shards so that they are unique across shards.
+        client = Client(self.next_id, self.partitions[self.accepted % len(self.partitions)])
+        self.next_id += self.core.shards
+        self.accepted += 1
+        conn.state = client
+        client.partition.clients.add(conn)
+        if client.partition.paused:
+            conn.pause_reading()             # its worker is behind
+        print(f"Socket Server: Client {client.id} connected from {conn.peer}")
+
+    def on_data(self, conn):
+        client = conn.state
+        pending = client.partition.pending
+        acks = 0
+        leaving = False
+        for line in conn.read_lines():
+            text = line.strip()
+            if not text:
+                continue
+            if text.lower() == b"exit":
+                leaving = True
+                break
+            client.seq += 1
+            pending.append(RECORD.pack(client.id, client.seq) + text)
+            acks += 1
+        if acks:
+            conn.write(ACK * acks)
+            # Everything read in this round of the event loop goes to the rings together
+            if not self.feed_scheduled:
+                self.feed_scheduled = True
+                self.core.loop.call_soon(self.feed_workers)
+        if leaving:
+            conn.close()                     # after the ACKs: close() drops later writes
+
+    def on_close(self, conn):
+        conn.state.partition.clients.discard(conn)
+        print(f"Socket Server: Client {conn.state.id} disconnected.")
+
+    def feed_workers(self):
+        """Moves pending records into the rings without blocking; pauses or resumes clients."""
+        self.feed_scheduled = False
+        for p in self.partitions:
+            if p.pending:
+                del p.pending[:p.ring.put_many(p.pending, block=False)]
+            if len(p.pending) > MAX_PENDING and not p.paused:
+                # This worker is behind: stop reading from its clients
+                p.paused = True
+                for conn in p.clients:
+                    conn.pause_reading()
+            elif not p.pending and p.paused:
+                p.paused = False
+                for conn in p.clients:
+                    conn.resume_reading()
+        # While records wait for room in a ring, poll instead of waiting for clients
+        if any(p.pending for p in self.partitions):
+            self.feed_scheduled = True
+            self.core.loop.call_later(0.001, self.feed_workers)
+
+    def on_shutdown(self):
+        for p in self.partitions:
+            p.ring.put_many(p.pending)      # records still held by the front end
+            p.ring.close_writer()           # the consumer drains its ring, then exits
+        for consumer in self.consumers:
+            consumer.join()
+        for p in self.partitions:
+            p.ring.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Multi-client socket server with shared-memory IPC")
+    parser.add_argument("--host", default="localhost")
+    parser.add_argument("--port", type=int, default=12345)
+    parser.add_argument("--rpc", default="http://localhost:8000/", help='RPC server URL, or "none"')
+    parser.add_argument("--rpc-mode", choices=["sync", "xml", "binary"], default="xml",
+                        help="sync: one call per message; xml/binary: batched and pipelined")
+    parser.add_argument("--rpc-binary-port", type=int, default=8001)
+    parser.add_argument("--rpc-batch", type=int, default=64, help="messages per RPC request")
+    parser.add_argument("--rpc-window", type=int, default=4, help="RPC requests in flight")
+    parser.add_argument("--workers", type=int, default=1, help="consumer processes")
+    parser.add_argument("--shards", type=int, default=1,
+                        help="front-end processes sharing the port, each with --workers consumers")
+    parser.add_argument("--drain-timeout", type=float, default=5.0,
+                        help="seconds connected clients get to finish after Ctrl-C")
+    parser.add_argument("--ring-size", type=int, default=1 << 20, help="ring capacity per worker (bytes)")
+    parser.add_argument("--quiet", action="store_true", help="do not print every message")
+    args = parser.parse_args()
+
+    server = ServerCore(lambda: RingFrontEnd(args), args.host, args.port, shards=args.shards,
+                        max_input=MAX_LINE, drain_timeout=args.drain_timeout, name="Socket Server")
+    server.run()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""
+RPC throughput of the CS1 consumer: one call per message vs. batched and
+pipelined calls.
+
+The batch_rpc.py servers run in a child process. --rtt-ms puts a delay
+proxy in front of them that holds every chunk of data for half the round
+trip in each direction, like a network link between the consumer and the
+RPC server would.
+
+Clients compared (--count messages each):
+
+  sync              ServerProxy.process_message per message: what
+                    consumer_process in Activity1.md does
+  multicall         xmlrpc.client.MultiCall, --batch calls per request
+  batch             process_messages(list), one request in flight
+  batch-pipelined   process_messages(list), --window requests in flight
+  binary-pipelined  the compact binary encoding, --window requests in flight
+
+Run examples:
+    python rpc_bench.py
+    python rpc_bench.py --rtt-ms 2 --count 5000
+    python rpc_bench.py --batch 256 --window 8
+
+No external libraries are required.
+"""
+
+import argparse
+import asyncio
+import multiprocessing as mp
+import socket
+import threading
+import time
+import xmlrpc.client
+
+from batch_rpc import PipelinedRPCClient, make_servers
+
+MODES = ("sync", "multicall", "batch", "batch-pipelined", "binary-pipelined")
+
+
+def free_port():
+    with socket.socket() as s:
+        s.bind(("127.0.0.1", 0))
+        return s.getsockname()[1]
+
+
+def run_servers(port, binary_port, ready):
+    xml_server, binary_server = make_servers("127.0.0.1", port, binary_port)
+    threading.Thread(target=binary_server.serve_forever, daemon=True).start()
+    ready.set()
+    xml_server.serve_forever()
+
+
+def run_delay_proxy(listen_port, target_port, one_way, ready):
+    """Forwards TCP connections, delaying every chunk by 'one_way' seconds."""
+    async def pipe(reader, writer):
+        loop = asyncio.get_running_loop()
+        try:
+            while True:
+                data = await reader.read(65536)
+                if not data:
+                    break
+                loop.call_later(one_way, writer.write, data)
+        finally:
+            loop.call_later(one_way, writer.close)
+
+    async def handle(client_reader, client_writer):
+        server_reader, server_writer = await asyncio.open_connection("127.0.0.1", target_port)
+        await asyncio.gather(pipe(client_reader, server_writer), pipe(server_reader, client_writer))
+
+    async def main():
+        server = await asyncio.start_server(handle, "127.0.0.1", listen_port)
+        ready.set()
+        await server.serve_forever()
+
+    asyncio.run(main())
+
+
+def run_client(mode, port, binary_port, count, batch, window):
+    messages = [f"2025-01-01 00:00:00 - CLIENT MESSAGE {i}" for i in range(count)]
+    results = []
+    t0 = time.perf_counter()
+    if mode == "sync":
+        proxy = xmlrpc.client.ServerProxy(f"http://127.0.0.1:{port}/", allow_none=True)
+        for m in messages:
+            results.append(proxy.process_message(m))
+    elif mode == "multicall":
+        proxy = xmlrpc.client.ServerProxy(f"http://127.0.0.1:{port}/", allow_none=True)
+        for start in range(0, count, batch):
+            multicall = xmlrpc.client.MultiCall(proxy)
+            for m in messages[start:start + batch]:
+                multicall.process_message(m)
+            results.extend(multicall())
+    else:
+        encoding = "binary" if mode.startswith("binary") else "xml"
+        client = PipelinedRPCClient("127.0.0.1", binary_port if encoding == "binary" else port,
+                                    encoding=encoding, batch_size=batch,
+                                    window=1 if mode == "batch" else window,
+                                    on_results=results.extend)
+        for m in messages:
+            client.call(m)
+        client.close()
+    elapsed = time.perf_counter() - t0
+    assert len(results) == count and results[-1] == messages[-1] + " [Processed by RPC]"
+    return count / elapsed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("--count", type=int, default=5000, help="messages per client mode")
+    parser.add_argument("--batch", type=int, default=64, help="messages per request")
+    parser.add_argument("--window", type=int, default=4, help="requests in flight")
+    parser.add_argument("--rtt-ms", type=float, default=0.0, help="simulated round-trip time")
+    args = parser.parse_args()
+
+    ctx = mp.get_context("fork")
+    port, binary_port = free_port(), free_port()
+    ready = ctx.Event()
+    servers = ctx.Process(target=run_servers, args=(port, binary_port, ready), daemon=True)
+    servers.start()
+    ready.wait()
+    proxy = None
+    if args.rtt_ms > 0:
+        proxy_port, proxy_binary_port = free_port(), free_port()
+        proxy = []
+        for listen, target in ((proxy_port, port), (proxy_binary_port, binary_port)):
+            ready = ctx.Event()
+            p = ctx.Process(target=run_delay_proxy,
+                            args=(listen, target, args.rtt_ms / 2000.0, ready), daemon=True)
+            p.start()
+            ready.wait()
+            proxy.append(p)
+        port, binary_port = proxy_port, proxy_binary_port
+
+    print(f"{args.count} messages, batch {args.batch}, window {args.window}, "
+          f"simulated RTT {args.rtt_ms:.1f} ms\n")
+    print("| Client           | Msgs/sec |")
+    print("|------------------|----------|")
+    rates = {}
+    for mode in MODES:
+        # One call per round trip is slow with a large RTT: measure fewer
+        count = args.count if mode != "sync" or args.rtt_ms == 0 else min(args.count, 500)
+        rates[mode] = run_client(mode, port, binary_port, count, args.batch, args.window)
+        print(f"| {mode:<16} | {rates[mode]:8.0f} |")
+    if args.rtt_ms > 0:
+        print(f"\none call per round trip cannot exceed {1000 / args.rtt_ms:.0f} msgs/sec")
+    for mode in MODES[1:]:
+        print(f"{mode}: {rates[mode] / rates['sync']:.1f}x sync")
+
+    servers.terminate()
+    for p in proxy or []:
+        p.terminate()
+
+
+if __name__ == "__main__":
+    main()
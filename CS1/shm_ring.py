@@ -0,0 +1,208 @@
+"""
+shm_ring.py
+Single-producer / single-consumer ring buffer in shared memory.
+
+multiprocessing.Pipe pickles every message and costs at least one write()
+and one read() system call per message. ShmRing keeps the messages in a
+multiprocessing.shared_memory block that both processes map:
+
+    +------+------+-----------+-----------+--------+----------------------+
+    | head | tail | cons_wait | prod_wait | closed | data (capacity bytes) |
+    +------+------+-----------+-----------+--------+----------------------+
+      one 64-byte cache line per u64 control field
+
+    record = u32 length | payload | padding to 8 bytes
+
+- head is only written by the producer and tail only by the consumer, so no
+  lock is needed. The producer writes the records first and then publishes
+  them with a single store of head. x86 keeps stores in order, and an
+  aligned 8-byte store through a memoryview is one instruction. (A C
+  version would use atomics with release/acquire ordering.)
+- Batching: put_many() publishes a whole batch with one head update, and
+  get_batch() takes every published record and frees them with one tail
+  update.
+- A record that does not fit before the end of the buffer is preceded by a
+  WRAP marker and starts again at offset 0.
+- Waiting: a side that finds the ring empty (consumer) or full (producer)
+  spins briefly. It then sets its *_wait flag and sleeps on an eventfd; the
+  other side writes the eventfd only when that flag is set. Python has no
+  memory fences, so a wake-up can be missed in a rare race. The sleeper
+  therefore re-checks every WAIT_SLICE seconds.
+
+Create the ring BEFORE forking the other process: the eventfds are
+inherited, not passed by name. Linux only (os.eventfd, Python 3.10+).
+"""
+
+import os
+import select
+import struct
+import time
+from multiprocessing import shared_memory
+
+SLOT = 8                    # u64 entries per cache line in the control block
+HEAD, TAIL, CONS_WAIT, PROD_WAIT, CLOSED = (i * SLOT for i in range(5))
+HEADER_SIZE = 5 * 64
+LENGTH = struct.Struct("=I")
+WRAP = 0xFFFFFFFF
+SPIN = 200                  # polls before going to sleep
+WAIT_SLICE = 0.01           # seconds; bounds the cost of a missed wake-up
+
+
+class RingClosed(Exception):
+    pass
+
+
+def record_size(payload_len):
+    return (LENGTH.size + payload_len + 7) & ~7
+
+
+class ShmRing:
+    def __init__(self, capacity=1 << 20):
+        if capacity & (capacity - 1) or capacity < 64:
+            raise ValueError("capacity must be a power of two >= 64")
+        self.capacity = capacity
+        self.mask = capacity - 1
+        self.shm = shared_memory.SharedMemory(create=True, size=HEADER_SIZE + capacity)
+        self.ctrl = self.shm.buf[:HEADER_SIZE].cast("Q")
+        self.data = self.shm.buf[HEADER_SIZE:HEADER_SIZE + capacity]
+        for i in (HEAD, TAIL, CONS_WAIT, PROD_WAIT, CLOSED):
+            self.ctrl[i] = 0
+        self.data_ready = os.eventfd(0, os.EFD_NONBLOCK)    # wakes the consumer
+        self.space_ready = os.eventfd(0, os.EFD_NONBLOCK)   # wakes the producer
+        self.owner = os.getpid()
+
+    # -- Producer -----------------------------------------------------------
+    def put(self, payload):
+        self.put_many((payload,))
+
+    def put_many(self, payloads, block=True):
+        """Appends the payloads (bytes-like) and publishes them together.
+
+        Blocks while the ring is full, which is the back-pressure on the
+        producer; records written so far are published first so the
+        consumer can make room. With block=False it stops at the first
+        payload that does not fit. Returns the number of payloads written.
+        """
+        ctrl, data, capacity = self.ctrl, self.data, self.capacity
+        head = ctrl[HEAD]
+        written = 0
+        for payload in payloads:
+            n = len(payload)
+            size = record_size(n)
+            if size > capacity // 2:
+                raise ValueError("message of %d bytes does not fit in the ring" % n)
+            pos = head & self.mask
+            room = capacity - pos
+            needed = size if size <= room else room + size
+            if head + needed - ctrl[TAIL] > capacity:
+                if not block:
+                    break
+                self._publish(head)
+                self._wait_space(head + needed)
+            if size > room:
+                LENGTH.pack_into(data, pos, WRAP)
+                head += room
+                pos = 0
+            LENGTH.pack_into(data, pos, n)
+            data[pos + LENGTH.size:pos + LENGTH.size + n] = payload
+            head += size
+            written += 1
+        if written:
+            self._publish(head)
+        return written
+
+    def _publish(self, head):
+        self.ctrl[HEAD] = head
+        if self.ctrl[CONS_WAIT]:
+            os.eventfd_write(self.data_ready, 1)
+
+    def _wait_space(self, end):
+        ctrl = self.ctrl
+        spins = 0
+        while end - ctrl[TAIL] > self.capacity:
+            if spins < SPIN:
+                spins += 1
+                continue
+            ctrl[PROD_WAIT] = 1
+            if end - ctrl[TAIL] <= self.capacity:
+                break
+            select.select([self.space_ready], [], [], WAIT_SLICE)
+            try:
+                os.eventfd_read(self.space_ready)
+            except BlockingIOError:
+                pass
+        ctrl[PROD_WAIT] = 0
+
+    def close_writer(self):
+        """No more messages: the consumer gets RingClosed once it has drained the ring."""
+        self.ctrl[CLOSED] = 1
+        os.eventfd_write(self.data_ready, 1)
+
+    # -- Consumer -----------------------------------------------------------
+    def get_batch(self, max_items=1 << 30, timeout=None):
+        """Returns the published payloads as a list of bytes (at most max_items).
+
+        Waits until there is at least one, or returns [] after 'timeout'
+        seconds. Raises RingClosed when the producer closed an empty ring.
+        """
+        ctrl, data = self.ctrl, self.data
+        tail = ctrl[TAIL]
+        head = ctrl[HEAD]
+        if head == tail:
+            head = self._wait_data(tail, timeout)
+            if head == tail:
+                if not ctrl[CLOSED]:
+                    return []
+                # The last batch may have been published just before CLOSED
+                head = ctrl[HEAD]
+                if head == tail:
+                    raise RingClosed()
+        batch = []
+        while tail != head and len(batch) < max_items:
+            pos = tail & self.mask
+            n = LENGTH.unpack_from(data, pos)[0]
+            if n == WRAP:
+                tail += self.capacity - pos
+                continue
+            batch.append(bytes(data[pos + LENGTH.size:pos + LENGTH.size + n]))
+            tail += record_size(n)
+        ctrl[TAIL] = tail
+        if ctrl[PROD_WAIT]:
+            os.eventfd_write(self.space_ready, 1)
+        return batch
+
+    def _wait_data(self, tail, timeout):
+        ctrl = self.ctrl
+        deadline = None if timeout is None else time.monotonic() + timeout
+        spins = 0
+        while True:
+            head = ctrl[HEAD]
+            if head != tail or ctrl[CLOSED]:
+                return head
+            if spins < SPIN:
+                spins += 1
+                continue
+            ctrl[CONS_WAIT] = 1
+            head = ctrl[HEAD]
+            if head == tail and not ctrl[CLOSED]:
+                wait = WAIT_SLICE if deadline is None else min(WAIT_SLICE, deadline - time.monotonic())
+                if wait > 0:
+                    select.select([self.data_ready], [], [], wait)
+                try:
+                    os.eventfd_read(self.data_ready)
+                except BlockingIOError:
+                    pass
+            ctrl[CONS_WAIT] = 0
+            if deadline is not None and time.monotonic() >= deadline:
+                return ctrl[HEAD]
+
+    # -- Cleanup ------------------------------------------------------------
+    def close(self):
+        """Unmaps the ring; the creating process also removes it."""
+        self.ctrl.release()
+        self.data.release()
+        self.shm.close()
+        if os.getpid() == self.owner:
+            self.shm.unlink()
+            os.close(self.data_ready)
+            os.close(self.space_ready)
@@ -0,0 +1,400 @@
+// mpi_blas1.c
+// Fused BLAS-1 engine for the vector add/multiply example in vecadd&mul.md.
+//
+// For distributed vectors x and y (block distribution, no root copy) one
+// streaming pass per rank computes all four results:
+//
+//   axpy:  z[i] = a*x[i] + y[i]
+//   mul:   w[i] = x[i] * y[i]
+//   dot:   sum x[i]*y[i]        (one MPI_Allreduce of 2 doubles
+//   nrm2:  sqrt(sum x[i]^2)      for both dot and nrm2)
+//
+// x and y are read once (16 bytes/element), z and w are written once (16
+// bytes/element). The unfused version - one loop per operation, as in the
+// original example - reads 56 and writes 16 bytes per element.
+//
+// Large outputs are written with non-temporal (streaming) stores: they go
+// straight to memory without first reading the target cache line (no
+// "read for ownership") and without evicting x and y from the cache.
+//
+// Output placement:
+//   distributed  z and w stay as local blocks on each rank
+//   allgather    each rank writes its block directly at its offset inside
+//                full-length z and w, then MPI_Allgatherv(MPI_IN_PLACE, ...)
+//                fills in the other blocks - no extra local copy
+//
+// Every rank also runs the STREAM triad  a[i] = b[i] + s*c[i]  on the same
+// local length, once with regular and once with streaming stores. Bandwidths
+// are reported as "effective" GB/s: the minimum bytes the operation must move
+// divided by the time (the slowest rank). "% of triad" compares the memory
+// traffic actually moved, write-allocate included, with the triad that uses
+// the same kind of store.
+//
+// Compile: mpicc -O3 -march=native -o mpi_blas1 mpi_blas1.c -lm
+// Run:     mpirun -np 4 ./mpi_blas1 <n> [reps] [distributed|allgather]
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#define ALIGNMENT 64
+// Use streaming stores once both outputs of a rank exceed this many bytes
+// (roughly: larger than a last-level cache share)
+#define NT_THRESHOLD_BYTES (8L << 20)
+
+// -------------------------------------------------------------------------
+// Block distribution helpers (as in CS5/mpi_mat_vect.c)
+// -------------------------------------------------------------------------
+static int block_size(int total, int parts, int idx) {
+    return total / parts + (idx < total % parts ? 1 : 0);
+}
+
+static int block_start(int total, int parts, int idx) {
+    int rem = total % parts;
+    return idx * (total / parts) + (idx < rem ? idx : rem);
+}
+
+static double* alloc_doubles(long n) {
+    size_t bytes = ((n * sizeof(double) + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+    double* p = aligned_alloc(ALIGNMENT, bytes > 0 ? bytes : ALIGNMENT);
+    if (p == NULL) {
+        fprintf(stderr, "Error: cannot allocate %ld doubles\n", n);
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    return p;
+}
+
+// -------------------------------------------------------------------------
+// Kernels
+// -------------------------------------------------------------------------
+
+// Unfused baseline: one pass per operation
+static void unfused(long n, double a, const double* x, const double* y,
+                    double* z, double* w, double* dot, double* sumsq) {
+    for (long i = 0; i < n; i++) z[i] = a * x[i] + y[i];
+    for (long i = 0; i < n; i++) w[i] = x[i] * y[i];
+    double d = 0.0;
+    for (long i = 0; i < n; i++) d += x[i] * y[i];
+    double s = 0.0;
+    for (long i = 0; i < n; i++) s += x[i] * x[i];
+    *dot = d;
+    *sumsq = s;
+}
+
+// Fused single pass. 'nt' selects streaming stores for z and w. z and w must
+// have the same alignment (they do: same offset into 64-byte aligned arrays).
+static void fused(long n, double a, const double* x, const double* y,
+                  double* z, double* w, int nt, double* dot, double* sumsq) {
+    double d = 0.0, s = 0.0;
+    long i = 0;
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+    // Scalar peel until the outputs are vector aligned
+    for (; i < n && ((size_t) (z + i) % ALIGNMENT) != 0; i++) {
+        z[i] = a * x[i] + y[i];
+        w[i] = x[i] * y[i];
+        d += x[i] * y[i];
+        s += x[i] * x[i];
+    }
+#endif
+
+#if defined(__AVX512F__)
+    // Two independent accumulator pairs hide the FMA latency
+    __m512d va = _mm512_set1_pd(a);
+    __m512d d0 = _mm512_setzero_pd(), d1 = _mm512_setzero_pd();
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+    for (; i + 16 <= n; i += 16) {
+        __m512d x0 = _mm512_loadu_pd(x + i), x1 = _mm512_loadu_pd(x + i + 8);
+        __m512d y0 = _mm512_loadu_pd(y + i), y1 = _mm512_loadu_pd(y + i + 8);
+        __m512d z0 = _mm512_fmadd_pd(va, x0, y0), z1 = _mm512_fmadd_pd(va, x1, y1);
+        __m512d w0 = _mm512_mul_pd(x0, y0),       w1 = _mm512_mul_pd(x1, y1);
+        if (nt) {
+            _mm512_stream_pd(z + i, z0); _mm512_stream_pd(z + i + 8, z1);
+            _mm512_stream_pd(w + i, w0); _mm512_stream_pd(w + i + 8, w1);
+        } else {
+            _mm512_store_pd(z + i, z0);  _mm512_store_pd(z + i + 8, z1);
+            _mm512_store_pd(w + i, w0);  _mm512_store_pd(w + i + 8, w1);
+        }
+        d0 = _mm512_add_pd(d0, w0);      d1 = _mm512_add_pd(d1, w1);
+        s0 = _mm512_fmadd_pd(x0, x0, s0); s1 = _mm512_fmadd_pd(x1, x1, s1);
+    }
+    d += _mm512_reduce_add_pd(_mm512_add_pd(d0, d1));
+    s += _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+#elif defined(__AVX2__)
+    __m256d va = _mm256_set1_pd(a);
+    __m256d d0 = _mm256_setzero_pd(), d1 = _mm256_setzero_pd();
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    for (; i + 8 <= n; i += 8) {
+        __m256d x0 = _mm256_loadu_pd(x + i), x1 = _mm256_loadu_pd(x + i + 4);
+        __m256d y0 = _mm256_loadu_pd(y + i), y1 = _mm256_loadu_pd(y + i + 4);
+        __m256d z0 = _mm256_add_pd(_mm256_mul_pd(va, x0), y0);
+        __m256d z1 = _mm256_add_pd(_mm256_mul_pd(va, x1), y1);
+        __m256d w0 = _mm256_mul_pd(x0, y0), w1 = _mm256_mul_pd(x1, y1);
+        if (nt) {
+            _mm256_stream_pd(z + i, z0); _mm256_stream_pd(z + i + 4, z1);
+            _mm256_stream_pd(w + i, w0); _mm256_stream_pd(w + i + 4, w1);
+        } else {
+            _mm256_store_pd(z + i, z0);  _mm256_store_pd(z + i + 4, z1);
+            _mm256_store_pd(w + i, w0);  _mm256_store_pd(w + i + 4, w1);
+        }
+        d0 = _mm256_add_pd(d0, w0); d1 = _mm256_add_pd(d1, w1);
+        s0 = _mm256_add_pd(s0, _mm256_mul_pd(x0, x0));
+        s1 = _mm256_add_pd(s1, _mm256_mul_pd(x1, x1));
+    }
+    double t[4];
+    _mm256_storeu_pd(t, _mm256_add_pd(d0, d1));
+    d += t[0] + t[1] + t[2] + t[3];
+    _mm256_storeu_pd(t, _mm256_add_pd(s0, s1));
+    s += t[0] + t[1] + t[2] + t[3];
+#else
+    (void) nt;
+#endif
+
+    for (; i < n; i++) {
+        z[i] = a * x[i] + y[i];
+        w[i] = x[i] * y[i];
+        d += x[i] * y[i];
+        s += x[i] * x[i];
+    }
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+    // Streaming stores are weakly ordered: make them visible before MPI reads z/w
+    if (nt) _mm_sfence();
+#endif
+    *dot = d;
+    *sumsq = s;
+}
+
+// STREAM triad, the reference for attainable memory bandwidth. 'nt' selects
+// streaming stores for a, so each kernel can be compared with the triad that
+// writes the same way.
+static void triad(long n, double* a, const double* b, const double* c, double scalar, int nt) {
+    long i = 0;
+#if defined(__AVX512F__) || defined(__AVX2__)
+    if (nt) {
+        for (; i < n && ((size_t) (a + i) % ALIGNMENT) != 0; i++) a[i] = b[i] + scalar * c[i];
+#if defined(__AVX512F__)
+        __m512d vs = _mm512_set1_pd(scalar);
+        for (; i + 8 <= n; i += 8)
+            _mm512_stream_pd(a + i, _mm512_fmadd_pd(vs, _mm512_loadu_pd(c + i),
+                                                    _mm512_loadu_pd(b + i)));
+#else
+        __m256d vs = _mm256_set1_pd(scalar);
+        for (; i + 4 <= n; i += 4)
+            _mm256_stream_pd(a + i, _mm256_add_pd(_mm256_loadu_pd(b + i),
+                                                  _mm256_mul_pd(vs, _mm256_loadu_pd(c + i))));
+#endif
+    }
+#else
+    (void) nt;
+#endif
+    for (; i < n; i++) a[i] = b[i] + scalar * c[i];
+#if defined(__AVX512F__) || defined(__AVX2__)
+    if (nt) _mm_sfence();
+#endif
+}
+
+// One line of the results table
+typedef struct {
+    const char* name;
+    double      time;       // best time of the slowest rank
+    int         bytes;      // bytes per element the operation must move
+    int         traffic;    // bytes per element actually moved, with write-allocate
+    int         streaming;  // 1 if the outputs are written with streaming stores
+} Row;
+
+// Time of the slowest rank (callers keep the best over the repetitions)
+static double slowest(double t) {
+    double t_max;
+    MPI_Allreduce(&t, &t_max, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    return t_max;
+}
+
+int main(int argc, char* argv[]) {
+    int rank, size;
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if (argc < 2) {
+        if (rank == 0)
+            fprintf(stderr, "Usage: %s <n> [reps] [distributed|allgather]\n", argv[0]);
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+    int n         = atoi(argv[1]);
+    int reps      = argc > 2 ? atoi(argv[2]) : 10;
+    int allgather = argc > 3 && strcmp(argv[3], "allgather") == 0;
+    if (n < size || reps <= 0) {
+        if (rank == 0) fprintf(stderr, "Error: need n >= number of ranks and reps > 0.\n");
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+    const double a = 2.5;
+
+    int* counts = malloc(size * sizeof(int));
+    int* displs = malloc(size * sizeof(int));
+    for (int p = 0; p < size; p++) {
+        counts[p] = block_size(n, size, p);
+        displs[p] = block_start(n, size, p);
+    }
+    long local_n = counts[rank];
+    long first   = displs[rank];
+
+    // Each rank generates its own block of x and y - nothing is scattered
+    double* x = alloc_doubles(local_n);
+    double* y = alloc_doubles(local_n);
+    for (long i = 0; i < local_n; i++) {
+        long g = first + i;
+        x[i] = 1.0 + (double) (g % 1000) / 1000.0;
+        y[i] = 2.0 - (double) (g % 777) / 777.0;
+    }
+
+    // Outputs: local blocks, or full vectors with this rank's block in place
+    long    out_len = allgather ? n : local_n;
+    long    offset  = allgather ? first : 0;
+    double* z_all   = alloc_doubles(out_len);
+    double* w_all   = alloc_doubles(out_len);
+    double* z       = z_all + offset;
+    double* w       = w_all + offset;
+    double* z_ref   = alloc_doubles(local_n);
+    double* w_ref   = alloc_doubles(local_n);
+
+    // Touch everything once so page faults are not timed
+    memset(z_all, 0, out_len * sizeof(double));
+    memset(w_all, 0, out_len * sizeof(double));
+    memset(z_ref, 0, local_n * sizeof(double));
+    memset(w_ref, 0, local_n * sizeof(double));
+
+    int nt = 2 * local_n * (long) sizeof(double) >= NT_THRESHOLD_BYTES;
+
+    double best_unfused = 1e30, best_fused = 1e30, best_fused_other = 1e30;
+    double best_triad = 1e30, best_triad_nt = 1e30, best_reduce = 1e30, best_gather = 1e30;
+    double dot_l = 0, ss_l = 0, dot_ref = 0, ss_ref = 0;
+
+    for (int r = 0; r < reps; r++) {
+        double t0;
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        t0 = MPI_Wtime();
+        unfused(local_n, a, x, y, z_ref, w_ref, &dot_ref, &ss_ref);
+        best_unfused = fmin(best_unfused, slowest(MPI_Wtime() - t0));
+
+        // STREAM triad into the reference buffers (a = z_ref, b = x, c = y),
+        // with regular and with streaming stores. Timed right after another
+        // pass over x and y, like the fused passes, so all start equally warm.
+        MPI_Barrier(MPI_COMM_WORLD);
+        t0 = MPI_Wtime();
+        triad(local_n, z_ref, x, y, 3.0, 0);
+        best_triad = fmin(best_triad, slowest(MPI_Wtime() - t0));
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        t0 = MPI_Wtime();
+        triad(local_n, z_ref, x, y, 3.0, 1);
+        best_triad_nt = fmin(best_triad_nt, slowest(MPI_Wtime() - t0));
+
+        // The same fused pass with the other store type, for comparison
+        MPI_Barrier(MPI_COMM_WORLD);
+        t0 = MPI_Wtime();
+        fused(local_n, a, x, y, z, w, !nt, &dot_l, &ss_l);
+        best_fused_other = fmin(best_fused_other, slowest(MPI_Wtime() - t0));
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        t0 = MPI_Wtime();
+        fused(local_n, a, x, y, z, w, nt, &dot_l, &ss_l);
+        best_fused = fmin(best_fused, slowest(MPI_Wtime() - t0));
+
+        // dot and nrm2 need one collective, not two
+        double local[2] = { dot_l, ss_l }, global[2];
+        MPI_Barrier(MPI_COMM_WORLD);
+        t0 = MPI_Wtime();
+        MPI_Allreduce(local, global, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        best_reduce = fmin(best_reduce, slowest(MPI_Wtime() - t0));
+        dot_l = global[0];
+        ss_l  = global[1];
+
+        if (allgather) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            t0 = MPI_Wtime();
+            MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL,
+                           z_all, counts, displs, MPI_DOUBLE, MPI_COMM_WORLD);
+            MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL,
+                           w_all, counts, displs, MPI_DOUBLE, MPI_COMM_WORLD);
+            best_gather = fmin(best_gather, slowest(MPI_Wtime() - t0));
+        }
+    }
+
+    // ---------------- Verification ----------------
+    // Recompute the reference once (the triad overwrote z_ref). The fused
+    // kernel may use FMA, so compare with a small tolerance.
+    unfused(local_n, a, x, y, z_ref, w_ref, &dot_ref, &ss_ref);
+    double ref[2] = { dot_ref, ss_ref }, ref_g[2];
+    MPI_Allreduce(MPI_IN_PLACE, ref, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    ref_g[0] = ref[0];
+    ref_g[1] = ref[1];
+
+    long wrong = 0;
+    for (long i = 0; i < local_n; i++)
+        if (fabs(z[i] - z_ref[i]) > 1e-12 || fabs(w[i] - w_ref[i]) > 1e-12) wrong++;
+    if (allgather) {
+        // Every block of the gathered vectors, not just our own
+        for (long g = 0; g < n; g++) {
+            double xg = 1.0 + (double) (g % 1000) / 1000.0;
+            double yg = 2.0 - (double) (g % 777) / 777.0;
+            if (fabs(z_all[g] - (a * xg + yg)) > 1e-12 || fabs(w_all[g] - xg * yg) > 1e-12)
+                wrong++;
+        }
+    }
+    long wrong_total;
+    MPI_Reduce(&wrong, &wrong_total, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        double dot_err = fabs(dot_l - ref_g[0]) / fabs(ref_g[0]);
+        double nrm_err = fabs(sqrt(ss_l) - sqrt(ref_g[1])) / sqrt(ref_g[1]);
+        // Memory traffic per element: a regular store also reads the target
+        // line first (write-allocate), a streaming store does not. Each
+        // kernel is compared with the triad that uses the same kind of store.
+        double elems = (double) counts[0] * size;
+        Row rows[5] = {
+            { "STREAM triad, regular stores", best_triad,    24, 32, 0 },
+            { "STREAM triad, streaming",      best_triad_nt, 24, 24, 1 },
+            { "unfused (4 loops)",            best_unfused,  72, 88, 0 },
+            { "fused, regular stores",        nt ? best_fused_other : best_fused, 32, 48, 0 },
+            { "fused, streaming stores",      nt ? best_fused : best_fused_other, 32, 32, 1 },
+        };
+        double bw_triad    = 32.0 * elems / best_triad / 1e9;
+        double bw_triad_nt = 24.0 * elems / best_triad_nt / 1e9;
+
+        printf("n = %d, ranks = %d, %ld elements/rank, reps = %d, output = %s\n",
+               n, size, (long) counts[0], reps, allgather ? "allgather (in place)" : "distributed");
+        printf("streaming stores: %s (outputs %.1f MB/rank, threshold %.1f MB)\n\n",
+               nt ? "on" : "off", 16.0 * counts[0] / 1e6, NT_THRESHOLD_BYTES / 1e6);
+
+        printf("| Kernel                       |   Time (s) | Bytes/elem | Traffic/elem | Effective GB/s | %% of triad |\n");
+        printf("|------------------------------|------------|------------|--------------|----------------|------------|\n");
+        for (int k = 0; k < 5; k++) {
+            double traffic_bw = rows[k].traffic * elems / rows[k].time / 1e9;
+            double ref = rows[k].streaming ? bw_triad_nt : bw_triad;
+            printf("| %-28s | %10.6f | %10d | %12d | %14.2f | %9.1f%% |\n",
+                   rows[k].name, rows[k].time, rows[k].bytes, rows[k].traffic,
+                   rows[k].bytes * elems / rows[k].time / 1e9, 100.0 * traffic_bw / ref);
+        }
+        printf("\nfused vs unfused speedup: %.2fx\n", best_unfused / best_fused);
+        printf("MPI_Allreduce (dot + nrm2): %.6f s\n", best_reduce);
+        if (allgather)
+            printf("MPI_Allgatherv in place (z and w): %.6f s\n", best_gather);
+        printf("dot = %.10e (rel. error %.1e), nrm2 = %.10e (rel. error %.1e)\n",
+               dot_l, dot_err, sqrt(ss_l), nrm_err);
+        printf("wrong elements: %ld\n", wrong_total);
+    }
+
+    free(x); free(y); free(z_all); free(w_all); free(z_ref); free(w_ref);
+    free(counts); free(displs);
+    MPI_Finalize();
+    return 0;
+}
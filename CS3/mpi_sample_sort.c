@@ -0,0 +1,370 @@
+// mpi_sample_sort.c
+// Distributed sort of integers with MPI: sample sort (PSRS) and a
+// merge-split odd-even transposition sort for small process counts.
+//
+// Sample sort (Parallel Sorting by Regular Sampling):
+//   1. Local parallel sort: NUM_THREADS pthreads radix-sort slices of the
+//      local block, then the sorted slices are k-way merged.
+//   2. Splitters: every rank takes P regular samples, MPI_Allgather them,
+//      and picks P-1 splitters from the sorted samples.
+//   3. Bucket exchange: keys <= splitter[i] go to rank i (MPI_Alltoallv).
+//   4. Final k-way merge of the P sorted runs received from the other ranks.
+//
+// Merge-split odd-even sort (the correct version of odd_even_sort() in
+// add-even.md): sort locally, then for P phases exchange WHOLE blocks with
+// the neighbour; the left rank keeps the smallest local_n keys, the right
+// rank the largest. After P phases the data is globally sorted.
+//
+// Every rank generates its own keys, so n can be far larger than one
+// node's memory (e.g. 10^9 keys over 16+ ranks).
+//
+// Compile: mpicc -O3 -o mpi_sample_sort mpi_sample_sort.c -lpthread
+// Run:     mpirun -np 8 ./mpi_sample_sort <n> [sample|oddeven|both]
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// Number of worker threads per rank for the local sort
+#define NUM_THREADS 4
+
+// -------------------------------------------------------------------------
+// Local sort: LSD radix sort on 32-bit keys (sign bit flipped so negative
+// numbers order correctly), 4 passes of 8 bits.
+// -------------------------------------------------------------------------
+static void radix_sort(int* a, long n, int* tmp) {
+    unsigned* src = (unsigned*) a;
+    unsigned* dst = (unsigned*) tmp;
+
+    for (int shift = 0; shift < 32; shift += 8) {
+        long count[257] = {0};
+        for (long i = 0; i < n; i++)
+            count[(((src[i] ^ 0x80000000u) >> shift) & 0xFF) + 1]++;
+        for (int b = 0; b < 256; b++) count[b + 1] += count[b];
+        for (long i = 0; i < n; i++)
+            dst[count[((src[i] ^ 0x80000000u) >> shift) & 0xFF]++] = src[i];
+        unsigned* t = src; src = dst; dst = t;
+    }
+    // 4 passes: the result is back in 'a'
+}
+
+// -------------------------------------------------------------------------
+// k-way merge of k sorted runs with a binary min-heap of run heads
+// -------------------------------------------------------------------------
+typedef struct {
+    const int* ptr;
+    const int* end;
+} Run;
+
+static void sift_down(Run* heap, int k, int i) {
+    for (;;) {
+        int l = 2 * i + 1, r = l + 1, s = i;
+        if (l < k && *heap[l].ptr < *heap[s].ptr) s = l;
+        if (r < k && *heap[r].ptr < *heap[s].ptr) s = r;
+        if (s == i) return;
+        Run t = heap[i]; heap[i] = heap[s]; heap[s] = t;
+        i = s;
+    }
+}
+
+static void merge_runs(int* const* runs, const long* counts, int k, int* out) {
+    Run* heap = malloc((k > 0 ? k : 1) * sizeof(Run));
+    int  h = 0;
+    for (int i = 0; i < k; i++)
+        if (counts[i] > 0) {
+            heap[h].ptr = runs[i];
+            heap[h].end = runs[i] + counts[i];
+            h++;
+        }
+    for (int i = h / 2 - 1; i >= 0; i--) sift_down(heap, h, i);
+
+    while (h > 0) {
+        *out++ = *heap[0].ptr++;
+        if (heap[0].ptr == heap[0].end) heap[0] = heap[--h];
+        sift_down(heap, h, 0);
+    }
+    free(heap);
+}
+
+// -------------------------------------------------------------------------
+// Local parallel sort: threads radix-sort slices, then merge the slices
+// -------------------------------------------------------------------------
+typedef struct {
+    int* data;
+    int* tmp;
+    long n;
+} SortTask;
+
+static void* thread_sort(void* arg) {
+    SortTask* t = (SortTask*) arg;
+    radix_sort(t->data, t->n, t->tmp);
+    return NULL;
+}
+
+static void local_parallel_sort(int* data, long n, int* tmp) {
+    pthread_t threads[NUM_THREADS];
+    SortTask  tasks[NUM_THREADS];
+    int*      runs[NUM_THREADS];
+    long      counts[NUM_THREADS];
+
+    for (int t = 0; t < NUM_THREADS; t++) {
+        long first = n * t / NUM_THREADS;
+        tasks[t].data = data + first;
+        tasks[t].tmp  = tmp + first;
+        tasks[t].n    = n * (t + 1) / NUM_THREADS - first;
+        runs[t]   = tasks[t].data;
+        counts[t] = tasks[t].n;
+        pthread_create(&threads[t], NULL, thread_sort, &tasks[t]);
+    }
+    for (int t = 0; t < NUM_THREADS; t++) pthread_join(threads[t], NULL);
+
+    merge_runs(runs, counts, NUM_THREADS, tmp);
+    memcpy(data, tmp, n * sizeof(int));
+}
+
+// Number of keys in sorted a[0..n) that are <= key
+static long upper_bound(const int* a, long n, int key) {
+    long lo = 0, hi = n;
+    while (lo < hi) {
+        long mid = lo + (hi - lo) / 2;
+        if (a[mid] <= key) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static int cmp_int(const void* a, const void* b) {
+    int x = *(const int*) a, y = *(const int*) b;
+    return (x > y) - (x < y);
+}
+
+// -------------------------------------------------------------------------
+// Sample sort. On return *out holds this rank's sorted bucket (malloc'd)
+// and the function returns its length.
+// -------------------------------------------------------------------------
+static long sample_sort(int* data, long n, int** out, MPI_Comm comm) {
+    int rank, P;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &P);
+
+    // 1. Local parallel sort
+    int* tmp = malloc((n + 1) * sizeof(int));
+    local_parallel_sort(data, n, tmp);
+    free(tmp);
+
+    // 2. Regular sampling: P samples per rank, P-1 global splitters
+    int* samples     = malloc(P * sizeof(int));
+    int* all_samples = malloc((size_t) P * P * sizeof(int));
+    int* splitters   = malloc((P > 1 ? P - 1 : 1) * sizeof(int));
+    for (int i = 0; i < P; i++)
+        samples[i] = n > 0 ? data[n * i / P] : 0;
+    MPI_Allgather(samples, P, MPI_INT, all_samples, P, MPI_INT, comm);
+    qsort(all_samples, (size_t) P * P, sizeof(int), cmp_int);
+    for (int i = 1; i < P; i++)
+        splitters[i - 1] = all_samples[i * P + P / 2 - 1];
+
+    // 3. Bucket exchange
+    int* send_counts = malloc(P * sizeof(int));
+    int* send_displs = malloc(P * sizeof(int));
+    int* recv_counts = malloc(P * sizeof(int));
+    int* recv_displs = malloc(P * sizeof(int));
+    long prev = 0;
+    for (int i = 0; i < P; i++) {
+        long end = (i < P - 1) ? upper_bound(data, n, splitters[i]) : n;
+        if (end < prev) end = prev;
+        send_counts[i] = (int) (end - prev);
+        send_displs[i] = (int) prev;
+        prev = end;
+    }
+    MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, comm);
+    long total = 0;
+    for (int i = 0; i < P; i++) {
+        recv_displs[i] = (int) total;
+        total += recv_counts[i];
+    }
+
+    int* bucket = malloc((total + 1) * sizeof(int));
+    MPI_Alltoallv(data, send_counts, send_displs, MPI_INT,
+                  bucket, recv_counts, recv_displs, MPI_INT, comm);
+
+    // 4. k-way merge of the P sorted runs
+    int** runs   = malloc(P * sizeof(int*));
+    long* counts = malloc(P * sizeof(long));
+    for (int i = 0; i < P; i++) {
+        runs[i]   = bucket + recv_displs[i];
+        counts[i] = recv_counts[i];
+    }
+    *out = malloc((total + 1) * sizeof(int));
+    merge_runs(runs, counts, P, *out);
+
+    free(runs); free(counts); free(bucket);
+    free(send_counts); free(send_displs); free(recv_counts); free(recv_displs);
+    free(samples); free(all_samples); free(splitters);
+    return total;
+}
+
+// -------------------------------------------------------------------------
+// Merge-split odd-even transposition sort (sorted in place)
+// -------------------------------------------------------------------------
+static void odd_even_merge_split(int* data, long n, MPI_Comm comm) {
+    int rank, P;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &P);
+
+    int* tmp = malloc((n + 1) * sizeof(int));
+    local_parallel_sort(data, n, tmp);
+
+    // Neighbour blocks can differ in size by one element
+    long  max_n   = n;
+    MPI_Allreduce(MPI_IN_PLACE, &max_n, 1, MPI_LONG, MPI_MAX, comm);
+    int*  other   = malloc((max_n + 1) * sizeof(int));
+
+    for (int phase = 0; phase < P; phase++) {
+        int partner = ((phase + rank) % 2 == 0) ? rank + 1 : rank - 1;
+        if (partner < 0 || partner >= P) continue;
+
+        MPI_Status status;
+        int        other_n;
+        MPI_Sendrecv(data, (int) n, MPI_INT, partner, 0,
+                     other, (int) max_n, MPI_INT, partner, 0, comm, &status);
+        MPI_Get_count(&status, MPI_INT, &other_n);
+
+        if (rank < partner) {
+            // Keep the n smallest of the two blocks
+            long i = 0, j = 0;
+            for (long k = 0; k < n; k++)
+                tmp[k] = (j >= other_n || (i < n && data[i] <= other[j])) ? data[i++] : other[j++];
+        } else {
+            // Keep the n largest, filling from the back
+            long i = n - 1, j = other_n - 1;
+            for (long k = n - 1; k >= 0; k--)
+                tmp[k] = (j < 0 || (i >= 0 && data[i] > other[j])) ? data[i--] : other[j--];
+        }
+        memcpy(data, tmp, n * sizeof(int));
+    }
+    free(other);
+    free(tmp);
+}
+
+// -------------------------------------------------------------------------
+// Check: each block sorted, blocks in order across ranks, no keys lost
+// -------------------------------------------------------------------------
+static int verify(const int* a, long n, long long checksum_in, MPI_Comm comm) {
+    int rank, P;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &P);
+
+    int       ok = 1;
+    long long sum = 0;
+    for (long i = 0; i < n; i++) {
+        sum += a[i];
+        if (i > 0 && a[i - 1] > a[i]) ok = 0;
+    }
+
+    // Every rank's (non-empty, first, last) so empty ranks are skipped
+    int  mine[3] = { n > 0, n > 0 ? a[0] : 0, n > 0 ? a[n - 1] : 0 };
+    int* ends    = malloc(3 * P * sizeof(int));
+    MPI_Allgather(mine, 3, MPI_INT, ends, 3, MPI_INT, comm);
+    int have_prev = 0, prev_last = 0;
+    for (int r = 0; r < P; r++) {
+        if (!ends[3 * r]) continue;
+        if (have_prev && prev_last > ends[3 * r + 1]) ok = 0;
+        have_prev = 1;
+        prev_last = ends[3 * r + 2];
+    }
+    free(ends);
+
+    long long sums[2] = { sum, checksum_in }, total[2];
+    MPI_Allreduce(sums, total, 2, MPI_LONG_LONG, MPI_SUM, comm);
+    if (total[0] != total[1]) ok = 0;
+    MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_LAND, comm);
+    return ok;
+}
+
+static void generate(int* a, long n, int rank) {
+    unsigned long long s = 0x9E3779B97F4A7C15ull * (rank + 1);
+    for (long i = 0; i < n; i++) {
+        s ^= s << 13; s ^= s >> 7; s ^= s << 17;     // xorshift64
+        a[i] = (int) (s >> 32);
+    }
+}
+
+static long long checksum(const int* a, long n) {
+    long long s = 0;
+    for (long i = 0; i < n; i++) s += a[i];
+    return s;
+}
+
+int main(int argc, char** argv) {
+    int rank, P, provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &P);
+
+    if (argc < 2) {
+        if (rank == 0) fprintf(stderr, "Usage: %s <n> [sample|oddeven|both]\n", argv[0]);
+        MPI_Finalize();
+        return 1;
+    }
+    long long   n_total = strtoll(argv[1], NULL, 10);
+    const char* mode    = argc > 2 ? argv[2] : "both";
+    int do_sample  = strcmp(mode, "oddeven") != 0;
+    int do_oddeven = strcmp(mode, "sample") != 0;
+
+    // Block distribution with the remainder spread over the first ranks
+    long n = (long) (n_total / P + (rank < n_total % P ? 1 : 0));
+    if (n_total / P + 1 > 0x7FFFFFFFLL) {
+        if (rank == 0) fprintf(stderr, "Error: more than 2^31 keys per rank; use more ranks.\n");
+        MPI_Finalize();
+        return 1;
+    }
+
+    int* data = malloc((n + 1) * sizeof(int));
+    int  all_ok = 1;
+
+    if (rank == 0)
+        printf("n = %lld, P = %d, threads/rank = %d\n%-22s %10s %16s %8s\n",
+               n_total, P, NUM_THREADS, "algorithm", "time(s)", "keys/s/rank", "sorted");
+
+    if (do_sample) {
+        generate(data, n, rank);
+        long long cs = checksum(data, n);
+        int*      out;
+        MPI_Barrier(MPI_COMM_WORLD);
+        double t0 = MPI_Wtime();
+        long   out_n = sample_sort(data, n, &out, MPI_COMM_WORLD);
+        double t = MPI_Wtime() - t0;
+        MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+        int  ok = verify(out, out_n, cs, MPI_COMM_WORLD);
+        long max_n = out_n;
+        MPI_Reduce(rank == 0 ? MPI_IN_PLACE : &max_n, &max_n, 1, MPI_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+        if (rank == 0)
+            printf("%-22s %10.3f %16.3e %8s   (largest bucket %.2fx average)\n",
+                   "sample sort", t, (double) n_total / t / P, ok ? "yes" : "NO",
+                   (double) max_n * P / (n_total ? n_total : 1));
+        all_ok &= ok;
+        free(out);
+    }
+
+    if (do_oddeven) {
+        generate(data, n, rank);
+        long long cs = checksum(data, n);
+        MPI_Barrier(MPI_COMM_WORLD);
+        double t0 = MPI_Wtime();
+        odd_even_merge_split(data, n, MPI_COMM_WORLD);
+        double t = MPI_Wtime() - t0;
+        MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+        int ok = verify(data, n, cs, MPI_COMM_WORLD);
+        if (rank == 0)
+            printf("%-22s %10.3f %16.3e %8s\n", "odd-even merge-split",
+                   t, (double) n_total / t / P, ok ? "yes" : "NO");
+        all_ok &= ok;
+    }
+
+    free(data);
+    MPI_Finalize();
+    return all_ok ? 0 : 1;
+}
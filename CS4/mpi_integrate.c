@@ -0,0 +1,407 @@
+// mpi_integrate.c
+// Adaptive, vectorized numerical integration with MPI + OpenMP.
+//
+// Compared to Trap() in "03_Usecase_MPI can be used for numerical integration.md":
+//   - The integrand is evaluated on BLOCKS of x (f(const double* x, double* y, n)),
+//     so the compiler can vectorize it.
+//   - Sums use Kahan (compensated) or pairwise summation, so rounding error
+//     does not grow with the number of terms.
+//   - Instead of a fixed n, intervals are refined adaptively with
+//     15-point Gauss-Kronrod rules (error = |K15 - G7|), always splitting the
+//     intervals with the LARGEST error estimates first.
+//   - Work is handed out by error, not by position: each round every rank
+//     offers its worst intervals, all ranks agree on the globally worst ones
+//     and split them round-robin, with OpenMP threads inside each rank.
+//   - Partial results are combined with MPI_Reduce (no manual Send/Recv loop).
+//
+// For comparison it also runs a fixed-n trapezoidal rule, doubling n until
+// the Richardson error estimate meets the same tolerance. Each doubling
+// reuses the previous sum and only evaluates the new midpoints.
+//
+// Compile: mpicc -O3 -march=native -fopenmp -o mpi_integrate mpi_integrate.c -lm
+// Run:     mpirun -np 4 ./mpi_integrate [x2|runge|sqrt|osc|peak] [tol]
+
+#include <mpi.h>
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define BLOCK 256           // x values per vectorized trapezoid block
+#define MAX_ROUNDS 100000
+
+// -------------------------------------------------------------------------
+// Integrands, evaluated on blocks
+// -------------------------------------------------------------------------
+typedef void (*BlockFn)(const double* x, double* y, int n);
+
+static void f_x2(const double* x, double* y, int n) {
+    for (int i = 0; i < n; i++) y[i] = x[i] * x[i];
+}
+static void f_runge(const double* x, double* y, int n) {
+    for (int i = 0; i < n; i++) y[i] = 1.0 / (1.0 + 25.0 * x[i] * x[i]);
+}
+static void f_sqrt(const double* x, double* y, int n) {
+    for (int i = 0; i < n; i++) y[i] = sqrt(x[i]);
+}
+static void f_osc(const double* x, double* y, int n) {
+    for (int i = 0; i < n; i++) y[i] = sin(50.0 * x[i]) * exp(-x[i]);
+}
+static void f_peak(const double* x, double* y, int n) {
+    for (int i = 0; i < n; i++) y[i] = 1.0 / ((x[i] - 0.3) * (x[i] - 0.3) + 1e-4);
+}
+
+typedef struct {
+    const char* name;
+    BlockFn     f;
+    double      a, b, exact;
+} Problem;
+
+static Problem problems[5];
+
+static void init_problems(void) {
+    const double pi = 3.14159265358979323846;
+    problems[0] = (Problem){ "x2",    f_x2,    0.0,  3.0, 9.0 };
+    problems[1] = (Problem){ "runge", f_runge, -1.0, 1.0, 0.4 * atan(5.0) };
+    problems[2] = (Problem){ "sqrt",  f_sqrt,  0.0,  1.0, 2.0 / 3.0 };
+    problems[3] = (Problem){ "osc",   f_osc,   0.0,  pi,  50.0 * (1.0 - exp(-pi)) / 2501.0 };
+    problems[4] = (Problem){ "peak",  f_peak,  0.0,  1.0, 100.0 * (atan(70.0) + atan(30.0)) };
+}
+
+// -------------------------------------------------------------------------
+// Compensated summation
+// -------------------------------------------------------------------------
+typedef struct {
+    double sum;
+    double c;       // running compensation (lost low-order bits)
+} Kahan;
+
+static void kahan_add(Kahan* k, double v) {
+    double y = v - k->c;
+    double t = k->sum + y;
+    k->c = (t - k->sum) - y;
+    k->sum = t;
+}
+
+// Pairwise sum: error grows as O(log n) instead of O(n)
+static double pairwise_sum(const double* v, int n) {
+    if (n <= 16) {
+        double s = 0.0;
+        for (int i = 0; i < n; i++) s += v[i];
+        return s;
+    }
+    int h = n / 2;
+    return pairwise_sum(v, h) + pairwise_sum(v + h, n - h);
+}
+
+// -------------------------------------------------------------------------
+// Baseline: trapezoidal rule with blocks, remainder handled, MPI_Allreduce
+// -------------------------------------------------------------------------
+// Sum of f(a + (i0 + k*stride) * h) for k = 0..pts-1 over all ranks; the
+// first ranks take one extra point
+static double point_sum(const Problem* p, double h, long i0, long stride, long pts,
+                        MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    long  first = rank * (pts / size) + (rank < pts % size ? rank : pts % size);
+    long  count = pts / size + (rank < pts % size ? 1 : 0);
+
+    Kahan total = {0.0, 0.0};
+    long  nblocks = (count + BLOCK - 1) / BLOCK;
+
+    #pragma omp parallel
+    {
+        Kahan  mine = {0.0, 0.0};
+        double x[BLOCK], y[BLOCK];
+        #pragma omp for schedule(static)
+        for (long blk = 0; blk < nblocks; blk++) {
+            long k0 = first + blk * BLOCK;
+            int  m  = (int) ((first + count - k0) < BLOCK ? (first + count - k0) : BLOCK);
+            for (int k = 0; k < m; k++) x[k] = p->a + (i0 + (k0 + k) * stride) * h;
+            p->f(x, y, m);
+            kahan_add(&mine, pairwise_sum(y, m));
+        }
+        #pragma omp critical
+        {
+            kahan_add(&total, mine.sum);
+            kahan_add(&total, -mine.c);
+        }
+    }
+
+    double local = total.sum - total.c, global;
+    MPI_Allreduce(&local, &global, 1, MPI_DOUBLE, MPI_SUM, comm);
+    return global;
+}
+
+static double trap_parallel(const Problem* p, long n, MPI_Comm comm) {
+    double h = (p->b - p->a) / n;
+    double ends[2] = { p->a, p->b }, fe[2];
+    p->f(ends, fe, 2);
+    // Interior points 1..n-1
+    return h * (0.5 * (fe[0] + fe[1]) + point_sum(p, h, 1, 1, n - 1, comm));
+}
+
+// T(n) from T(n/2): the old points are reused, only the n/2 new midpoints
+// are evaluated
+static double trap_refine(const Problem* p, double prev, long n, MPI_Comm comm) {
+    double h = (p->b - p->a) / n;
+    return 0.5 * prev + h * point_sum(p, h, 1, 2, n / 2, comm);
+}
+
+// -------------------------------------------------------------------------
+// 15-point Gauss-Kronrod rule (nodes/weights from QUADPACK)
+// -------------------------------------------------------------------------
+static const double xgk[8] = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.000000000000000000000000000000000 };
+static const double wgk[8] = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714 };
+static const double wg[4] = {
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327 };
+
+typedef struct {
+    double a, b;
+    double result;
+    double error;
+} Interval;
+
+// Evaluate all 15 nodes with ONE block call, then form K15 and G7
+static void gk15(BlockFn f, Interval* iv) {
+    double c = 0.5 * (iv->a + iv->b), hl = 0.5 * (iv->b - iv->a);
+    double x[15], y[15];
+    for (int j = 0; j < 7; j++) {
+        x[2 * j]     = c - hl * xgk[j];
+        x[2 * j + 1] = c + hl * xgk[j];
+    }
+    x[14] = c;
+    f(x, y, 15);
+
+    double k = wgk[7] * y[14], g = wg[3] * y[14];
+    for (int j = 0; j < 7; j++) {
+        double pair = y[2 * j] + y[2 * j + 1];
+        k += wgk[j] * pair;
+        if (j % 2 == 1) g += wg[j / 2] * pair;   // Gauss nodes are xgk[1,3,5]
+    }
+    iv->result = k * hl;
+    iv->error  = fabs((k - g) * hl);
+}
+
+// -------------------------------------------------------------------------
+// Max-heap of intervals keyed on error
+// -------------------------------------------------------------------------
+typedef struct {
+    Interval* v;
+    int       n, cap;
+} Heap;
+
+static void heap_push(Heap* h, Interval iv) {
+    if (h->n == h->cap) {
+        h->cap = h->cap ? 2 * h->cap : 64;
+        h->v = realloc(h->v, h->cap * sizeof(Interval));
+    }
+    int i = h->n++;
+    while (i > 0 && h->v[(i - 1) / 2].error < iv.error) {
+        h->v[i] = h->v[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    h->v[i] = iv;
+}
+
+static Interval heap_pop(Heap* h) {
+    Interval top = h->v[0], last = h->v[--h->n];
+    int i = 0;
+    for (;;) {
+        int l = 2 * i + 1, r = l + 1, s = l;
+        if (l >= h->n) break;
+        if (r < h->n && h->v[r].error > h->v[l].error) s = r;
+        if (h->v[s].error <= last.error) break;
+        h->v[i] = h->v[s];
+        i = s;
+    }
+    if (h->n > 0) h->v[i] = last;
+    return top;
+}
+
+static int cmp_error_desc(const void* a, const void* b) {
+    double ea = ((const Interval*) a)->error, eb = ((const Interval*) b)->error;
+    if (ea != eb) return ea < eb ? 1 : -1;
+    double aa = ((const Interval*) a)->a, ab = ((const Interval*) b)->a;
+    return (aa > ab) - (aa < ab);    // deterministic tie-break on position
+}
+
+// -------------------------------------------------------------------------
+// Distributed adaptive Gauss-Kronrod
+// -------------------------------------------------------------------------
+typedef struct {
+    double result, error;
+    long   evals;
+    int    rounds;
+} AdaptResult;
+
+static AdaptResult adaptive_gk(const Problem* p, double tol, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    int threads = omp_get_max_threads();
+
+    // Candidates offered per rank per round; half of all offers get split
+    int K = 4 * threads;
+    Heap heap = {0};
+    long evals = 0;
+    double local_err = 0.0;
+
+    // Initial pieces: size * threads equal intervals, dealt round-robin
+    int pieces = size * threads;
+    for (int i = rank; i < pieces; i += size) {
+        Interval iv = { p->a + (p->b - p->a) * i / pieces,
+                        p->a + (p->b - p->a) * (i + 1) / pieces, 0, 0 };
+        gk15(p->f, &iv);
+        evals += 15;
+        local_err += iv.error;
+        heap_push(&heap, iv);
+    }
+
+    Interval* offer    = malloc(K * sizeof(Interval));
+    Interval* all      = malloc((size_t) K * size * sizeof(Interval));
+    Interval* children = malloc((size_t) 2 * K * size * sizeof(Interval));
+    int*      counts   = malloc(size * sizeof(int));
+    int*      displs   = malloc(size * sizeof(int));
+
+    int round = 0;
+    for (; round < MAX_ROUNDS; round++) {
+        double global_err;
+        MPI_Allreduce(&local_err, &global_err, 1, MPI_DOUBLE, MPI_SUM, comm);
+        if (global_err <= tol) break;
+
+        // 1. Offer my K worst intervals
+        int mine = heap.n < K ? heap.n : K;
+        for (int i = 0; i < mine; i++) {
+            offer[i] = heap_pop(&heap);
+            local_err -= offer[i].error;
+        }
+
+        // 2. Everyone sees every offer (4 doubles per interval)
+        int my_doubles = mine * 4;
+        MPI_Allgather(&my_doubles, 1, MPI_INT, counts, 1, MPI_INT, comm);
+        int total = 0;
+        for (int r = 0; r < size; r++) {
+            displs[r] = total;
+            total += counts[r];
+        }
+        MPI_Allgatherv(offer, my_doubles, MPI_DOUBLE, all, counts, displs, MPI_DOUBLE, comm);
+        int n_all = total / 4;
+
+        // 3. Globally worst half are split, dealt round-robin over ranks.
+        //    Every rank sorts the same list, so all agree without messages.
+        qsort(all, n_all, sizeof(Interval), cmp_error_desc);
+        int n_split = (n_all + 1) / 2;
+
+        int my_splits = 0;
+        for (int i = rank; i < n_split; i += size) my_splits++;
+
+        #pragma omp parallel for schedule(dynamic, 1) reduction(+:evals)
+        for (int s = 0; s < my_splits; s++) {
+            const Interval* iv = &all[rank + s * size];
+            double mid = 0.5 * (iv->a + iv->b);
+            Interval l = { iv->a, mid, 0, 0 }, r = { mid, iv->b, 0, 0 };
+            gk15(p->f, &l);
+            gk15(p->f, &r);
+            children[2 * s] = l;
+            children[2 * s + 1] = r;
+            evals += 30;
+        }
+        for (int c = 0; c < 2 * my_splits; c++) {
+            local_err += children[c].error;
+            heap_push(&heap, children[c]);
+        }
+
+        // 4. Offers that were not split go back to their owner. My offers
+        //    are the ones whose (a, b) I sent; match them in the sorted list.
+        for (int i = n_split; i < n_all; i++) {
+            for (int j = 0; j < mine; j++) {
+                if (offer[j].a == all[i].a && offer[j].b == all[i].b) {
+                    local_err += offer[j].error;
+                    heap_push(&heap, offer[j]);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Combine: Kahan sum locally, then one MPI_Reduce of (sum, error, evals)
+    Kahan k = {0.0, 0.0};
+    double err = 0.0;
+    for (int i = 0; i < heap.n; i++) {
+        kahan_add(&k, heap.v[i].result);
+        err += heap.v[i].error;
+    }
+    double local[3] = { k.sum - k.c, err, (double) evals }, global[3];
+    MPI_Reduce(local, global, 3, MPI_DOUBLE, MPI_SUM, 0, comm);
+
+    free(offer); free(all); free(children); free(counts); free(displs);
+    free(heap.v);
+
+    AdaptResult res = { global[0], global[1], (long) global[2], round };
+    return res;
+}
+
+int main(int argc, char** argv) {
+    int rank, size, provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    init_problems();
+    const char* name = argc > 1 ? argv[1] : "peak";
+    double      tol  = argc > 2 ? atof(argv[2]) : 1e-10;
+    Problem*    p    = NULL;
+    for (int i = 0; i < 5; i++)
+        if (strcmp(problems[i].name, name) == 0) p = &problems[i];
+    if (p == NULL || tol <= 0.0) {
+        if (rank == 0)
+            fprintf(stderr, "Usage: %s [x2|runge|sqrt|osc|peak] [tol > 0]\n", argv[0]);
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Baseline: double n until |T(n) - T(n/2)| / 3 <= tol (Richardson)
+    double t0 = MPI_Wtime();
+    long   n = 1024;
+    double prev = trap_parallel(p, n / 2, MPI_COMM_WORLD), trap = 0.0;
+    long   trap_evals = n / 2 + 1;
+    for (; n <= (1L << 34); n *= 2) {
+        trap = trap_refine(p, prev, n, MPI_COMM_WORLD);
+        trap_evals += n / 2;
+        if (fabs(trap - prev) / 3.0 <= tol) break;
+        prev = trap;
+    }
+    double trap_t = MPI_Wtime() - t0;
+
+    t0 = MPI_Wtime();
+    AdaptResult gk = adaptive_gk(p, tol, MPI_COMM_WORLD);
+    double gk_t = MPI_Wtime() - t0;
+
+    if (rank == 0) {
+        printf("f = %s on [%g, %g], tol = %.1e, ranks = %d, threads/rank = %d\n",
+               p->name, p->a, p->b, tol, size, omp_get_max_threads());
+        printf("%-22s %22s %12s %14s %10s\n", "method", "result", "true error", "f evals", "time(ms)");
+        printf("%-22s %22.15e %12.3e %14ld %10.2f\n", "trapezoid (doubling)",
+               trap, fabs(trap - p->exact), trap_evals, trap_t * 1e3);
+        printf("%-22s %22.15e %12.3e %14ld %10.2f   (est. error %.1e, %d rounds)\n",
+               "adaptive GK15", gk.result, fabs(gk.result - p->exact), gk.evals,
+               gk_t * 1e3, gk.error, gk.rounds);
+        printf("Function evaluations saved: %.1fx\n", (double) trap_evals / gk.evals);
+    }
+
+    MPI_Finalize();
+    return 0;
+}
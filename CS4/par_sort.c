@@ -0,0 +1,244 @@
+// par_sort.c
+// Parallel radix sort and parallel merge sort with SIMD sorting networks.
+// See par_sort.h for the interface.
+
+#include "par_sort.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// =========================================================================
+// Parallel LSD radix sort
+// =========================================================================
+
+#define RADIX_BITS    8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+// Flip the sign bit so that signed ints sort correctly as unsigned
+static inline unsigned radix_key(unsigned v, int shift) {
+    return ((v ^ 0x80000000u) >> shift) & (RADIX_BUCKETS - 1);
+}
+
+void par_radix_sort(int* a, size_t n) {
+    if (n < 2) return;
+
+    int       max_t = omp_get_max_threads();
+    unsigned* src   = (unsigned*) a;
+    unsigned* dst   = malloc(n * sizeof(unsigned));
+    size_t*   hist  = malloc((size_t) max_t * RADIX_BUCKETS * sizeof(size_t));
+    unsigned* buf   = dst;
+
+    for (int shift = 0; shift < 32; shift += RADIX_BITS) {
+        int skip = 0;
+
+        #pragma omp parallel
+        {
+            int     T  = omp_get_num_threads();
+            int     t  = omp_get_thread_num();
+            size_t  lo = n * t / T, hi = n * (t + 1) / T;
+            size_t* h  = hist + (size_t) t * RADIX_BUCKETS;
+
+            // 1. Per-thread histogram of this digit
+            memset(h, 0, RADIX_BUCKETS * sizeof(size_t));
+            for (size_t i = lo; i < hi; i++) h[radix_key(src[i], shift)]++;
+
+            #pragma omp barrier
+            // 2. Exclusive prefix sum in (bucket, thread) order, so each
+            //    thread gets its own output range inside every bucket
+            #pragma omp single
+            {
+                size_t sum = 0;
+                for (int b = 0; b < RADIX_BUCKETS; b++) {
+                    size_t count = 0;
+                    for (int u = 0; u < T; u++) count += hist[(size_t) u * RADIX_BUCKETS + b];
+                    if (count == n) skip = 1;   // every key has the same digit
+                    for (int u = 0; u < T; u++) {
+                        size_t c = hist[(size_t) u * RADIX_BUCKETS + b];
+                        hist[(size_t) u * RADIX_BUCKETS + b] = sum;
+                        sum += c;
+                    }
+                }
+            }
+
+            // 3. Stable scatter (skipped when the pass would not move anything)
+            if (!skip) {
+                for (size_t i = lo; i < hi; i++) dst[h[radix_key(src[i], shift)]++] = src[i];
+            }
+        }
+
+        if (!skip) {
+            unsigned* t = src; src = dst; dst = t;
+        }
+    }
+
+    if (src != (unsigned*) a) {
+        #pragma omp parallel for
+        for (size_t i = 0; i < n; i++) a[i] = (int) src[i];
+    }
+    free(buf);
+    free(hist);
+}
+
+// =========================================================================
+// Parallel merge sort
+// =========================================================================
+
+#define NET_WIDTH 8                    // keys per network lane
+#define NET_BLOCK (NET_WIDTH * NET_WIDTH)
+
+// Optimal 19-comparator sorting network for 8 inputs
+static const int net8[19][2] = {
+    {0, 2}, {1, 3}, {4, 6}, {5, 7},
+    {0, 4}, {1, 5}, {2, 6}, {3, 7},
+    {0, 1}, {2, 3}, {4, 5}, {6, 7},
+    {2, 4}, {3, 5},
+    {1, 4}, {3, 6},
+    {1, 2}, {3, 4}, {5, 6},
+};
+
+// Sort a block of 64 keys into 8 sorted runs of 8.
+// The block is viewed as 8 rows of 8; the network sorts every column at
+// once (one min/max per comparator on whole rows), then the 8x8 transpose
+// turns each sorted column into a sorted, contiguous run.
+static void sort_block64(int* a) {
+#if defined(__AVX2__)
+    __m256i r[8];
+    for (int i = 0; i < 8; i++) r[i] = _mm256_loadu_si256((const __m256i*) (a + 8 * i));
+    for (int c = 0; c < 19; c++) {
+        __m256i lo = _mm256_min_epi32(r[net8[c][0]], r[net8[c][1]]);
+        __m256i hi = _mm256_max_epi32(r[net8[c][0]], r[net8[c][1]]);
+        r[net8[c][0]] = lo;
+        r[net8[c][1]] = hi;
+    }
+
+    // 8x8 transpose of 32-bit lanes
+    __m256 t[8], u[8];
+    for (int i = 0; i < 8; i += 2) {
+        t[i]     = _mm256_unpacklo_ps(_mm256_castsi256_ps(r[i]), _mm256_castsi256_ps(r[i + 1]));
+        t[i + 1] = _mm256_unpackhi_ps(_mm256_castsi256_ps(r[i]), _mm256_castsi256_ps(r[i + 1]));
+    }
+    for (int i = 0; i < 8; i += 4) {
+        u[i]     = _mm256_shuffle_ps(t[i],     t[i + 2], 0x44);
+        u[i + 1] = _mm256_shuffle_ps(t[i],     t[i + 2], 0xEE);
+        u[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], 0x44);
+        u[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], 0xEE);
+    }
+    for (int i = 0; i < 4; i++) {
+        __m256 lo = _mm256_permute2f128_ps(u[i], u[i + 4], 0x20);
+        __m256 hi = _mm256_permute2f128_ps(u[i], u[i + 4], 0x31);
+        _mm256_storeu_si256((__m256i*) (a + 8 * i),       _mm256_castps_si256(lo));
+        _mm256_storeu_si256((__m256i*) (a + 8 * (i + 4)), _mm256_castps_si256(hi));
+    }
+#else
+    // Portable version: same network, one row of 8 lanes at a time
+    int r[8][8];
+    memcpy(r, a, sizeof(r));
+    for (int c = 0; c < 19; c++) {
+        int* p = r[net8[c][0]];
+        int* q = r[net8[c][1]];
+        for (int l = 0; l < 8; l++) {
+            int lo = p[l] < q[l] ? p[l] : q[l];
+            int hi = p[l] < q[l] ? q[l] : p[l];
+            p[l] = lo;
+            q[l] = hi;
+        }
+    }
+    for (int i = 0; i < 8; i++)
+        for (int j = 0; j < 8; j++) a[8 * i + j] = r[j][i];
+#endif
+}
+
+static void insertion_sort(int* a, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        int    v = a[i];
+        size_t j = i;
+        while (j > 0 && a[j - 1] > v) {
+            a[j] = a[j - 1];
+            j--;
+        }
+        a[j] = v;
+    }
+}
+
+static void merge(const int* A, size_t la, const int* B, size_t lb, int* out) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < la && j < lb) out[k++] = (B[j] < A[i]) ? B[j++] : A[i++];
+    while (i < la) out[k++] = A[i++];
+    while (j < lb) out[k++] = B[j++];
+}
+
+// Merge path: number of keys taken from A among the first k merged keys
+static size_t co_rank(size_t k, const int* A, size_t la, const int* B, size_t lb) {
+    size_t lo = k > lb ? k - lb : 0;
+    size_t hi = k < la ? k : la;
+    while (lo < hi) {
+        size_t i = lo + (hi - lo) / 2;
+        size_t j = k - i;
+        if (i < la && j > 0 && A[i] <= B[j - 1]) lo = i + 1;
+        else hi = i;
+    }
+    return lo;
+}
+
+// Merge A and B with all threads: split the output into equal pieces
+static void par_merge(const int* A, size_t la, const int* B, size_t lb, int* out) {
+    size_t total = la + lb;
+    #pragma omp parallel
+    {
+        int    T  = omp_get_num_threads();
+        int    t  = omp_get_thread_num();
+        size_t k0 = total * t / T, k1 = total * (t + 1) / T;
+        size_t i0 = co_rank(k0, A, la, B, lb);
+        size_t i1 = co_rank(k1, A, la, B, lb);
+        merge(A + i0, i1 - i0, B + (k0 - i0), (k1 - i1) - (k0 - i0), out + k0);
+    }
+}
+
+void par_merge_sort(int* a, size_t n) {
+    if (n < 2) return;
+
+    int*   buf = malloc(n * sizeof(int));
+    int*   src = a;
+    int*   dst = buf;
+    size_t blocks = n / NET_BLOCK;
+    int    T = omp_get_max_threads();
+
+    // 1. Sorting networks: every full block becomes 8 sorted runs of 8
+    #pragma omp parallel for schedule(static)
+    for (size_t b = 0; b < blocks; b++) sort_block64(a + b * NET_BLOCK);
+    insertion_sort(a + blocks * NET_BLOCK, n - blocks * NET_BLOCK);
+
+    // 2. Bottom-up merging. While there are many pairs, each thread merges
+    //    whole pairs; near the top, all threads share each merge.
+    for (size_t width = NET_WIDTH; width < n; width *= 2) {
+        size_t pairs = (n + 2 * width - 1) / (2 * width);
+
+        if (pairs >= (size_t) T) {
+            #pragma omp parallel for schedule(dynamic, 1)
+            for (size_t p = 0; p < pairs; p++) {
+                size_t lo  = p * 2 * width;
+                size_t mid = lo + width < n ? lo + width : n;
+                size_t hi  = lo + 2 * width < n ? lo + 2 * width : n;
+                merge(src + lo, mid - lo, src + mid, hi - mid, dst + lo);
+            }
+        } else {
+            for (size_t p = 0; p < pairs; p++) {
+                size_t lo  = p * 2 * width;
+                size_t mid = lo + width < n ? lo + width : n;
+                size_t hi  = lo + 2 * width < n ? lo + 2 * width : n;
+                par_merge(src + lo, mid - lo, src + mid, hi - mid, dst + lo);
+            }
+        }
+        int* t = src; src = dst; dst = t;
+    }
+
+    if (src != a) {
+        #pragma omp parallel for
+        for (size_t i = 0; i < n; i++) a[i] = src[i];
+    }
+    free(buf);
+}
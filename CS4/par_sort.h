@@ -0,0 +1,21 @@
+// par_sort.h
+// Shared-memory parallel sorting with OpenMP.
+//
+//   par_radix_sort()  - LSD radix sort for 32-bit integer keys,
+//                       per-thread histograms, 4 passes of 8 bits.
+//   par_merge_sort()  - merge sort: blocks of 64 keys are sorted with a
+//                       SIMD sorting network, then merged bottom-up; the
+//                       top levels use a parallel (merge-path) merge.
+//
+// Both sort in place and use omp_get_max_threads() threads.
+// Build with: gcc -O3 -march=native -fopenmp ... par_sort.c
+
+#ifndef PAR_SORT_H
+#define PAR_SORT_H
+
+#include <stddef.h>
+
+void par_radix_sort(int* a, size_t n);
+void par_merge_sort(int* a, size_t n);
+
+#endif
@@ -0,0 +1,171 @@
+// sort_bench.c
+// Speedup / efficiency table for the sorts in 06_performance.md:
+//   bubble_sort_serial, bubble_sort_parallel (OpenMP), qsort,
+//   par_radix_sort and par_merge_sort (par_sort.c).
+//
+// Bubble sort is O(n^2): at 10^6 keys it already needs ~10^12 comparisons.
+// It is therefore only run up to BUBBLE_MAX_N keys; for larger n its time
+// is extrapolated as t(BUBBLE_MAX_N) * (n / BUBBLE_MAX_N)^2 and marked "~".
+//
+// Compile: gcc -O3 -march=native -fopenmp -o sort_bench sort_bench.c par_sort.c
+// Run:     ./sort_bench <max_threads> <n> [n ...]
+//          ./sort_bench 8 1000000 10000000 100000000 1000000000
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "par_sort.h"
+
+#define BUBBLE_MAX_N 50000
+
+// ---------------- The two bubble sorts from 06_performance.md ----------------
+void bubble_sort_serial(int arr[], int n) {
+    for (int i = 0; i < n - 1; i++) {
+        for (int j = 0; j < n - i - 1; j++) {
+            if (arr[j] > arr[j + 1]) {
+                int temp = arr[j];
+                arr[j] = arr[j + 1];
+                arr[j + 1] = temp;
+            }
+        }
+    }
+}
+
+void bubble_sort_parallel(int arr[], int n) {
+    for (int i = 0; i < n - 1; i++) {
+        #pragma omp parallel for
+        for (int j = i % 2; j < n - 1; j += 2) {
+            if (arr[j] > arr[j + 1]) {
+                int temp = arr[j];
+                arr[j] = arr[j + 1];
+                arr[j + 1] = temp;
+            }
+        }
+    }
+}
+
+static int cmp_int(const void* a, const void* b) {
+    int x = *(const int*) a, y = *(const int*) b;
+    return (x > y) - (x < y);
+}
+
+// ---------------------------------------------------------------------------
+
+static void fill_random(int* a, size_t n) {
+    unsigned long long s = 88172645463325252ull;
+    for (size_t i = 0; i < n; i++) {
+        s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+        a[i] = (int) (s >> 33);
+    }
+}
+
+static int is_sorted(const int* a, size_t n) {
+    for (size_t i = 1; i < n; i++)
+        if (a[i - 1] > a[i]) return 0;
+    return 1;
+}
+
+typedef void (*SortFn)(int*, size_t);
+
+static void run_qsort(int* a, size_t n)  { qsort(a, n, sizeof(int), cmp_int); }
+static void run_bubble_s(int* a, size_t n) { bubble_sort_serial(a, (int) n); }
+static void run_bubble_p(int* a, size_t n) { bubble_sort_parallel(a, (int) n); }
+
+// Copy the input, sort it, check it, return seconds
+static double time_sort(SortFn fn, const int* input, int* work, size_t n, int* ok) {
+    memcpy(work, input, n * sizeof(int));
+    double t0 = omp_get_wtime();
+    fn(work, n);
+    double t = omp_get_wtime() - t0;
+    if (!is_sorted(work, n)) *ok = 0;
+    return t;
+}
+
+// Bubble sort time, measured directly or extrapolated from BUBBLE_MAX_N
+static double time_bubble(SortFn fn, const int* input, int* work, size_t n,
+                          int* ok, int* estimated) {
+    if (n <= BUBBLE_MAX_N) {
+        *estimated = 0;
+        return time_sort(fn, input, work, n, ok);
+    }
+    *estimated = 1;
+    double t = time_sort(fn, input, work, BUBBLE_MAX_N, ok);
+    double r = (double) n / BUBBLE_MAX_N;
+    return t * r * r;
+}
+
+// '~' marks values that depend on an extrapolated bubble sort time
+static void print_row(size_t n, int p, const char* name, double t, int est,
+                      double t_bubble, int est_bubble, double t_qsort, double t_one) {
+    printf("| %-11zu | %7d | %-20s | %s%9.4f | %s%15.2f | %8.2f | %10.2f |\n",
+           n, p, name, est ? "~" : " ", t, (est || est_bubble) ? "~" : " ",
+           t_bubble / t, t_qsort / t, t_one / (p * t));
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <max_threads> <n> [n ...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    int max_threads = atoi(argv[1]);
+    if (max_threads <= 0) {
+        fprintf(stderr, "Error: max_threads must be positive.\n");
+        return EXIT_FAILURE;
+    }
+
+    int all_ok = 1;
+    printf("| n           | Threads | Algorithm            |   Time (s) | vs bubble_serial | vs qsort | Efficiency |\n");
+    printf("|-------------|---------|----------------------|------------|------------------|----------|------------|\n");
+
+    for (int arg = 2; arg < argc; arg++) {
+        size_t n = strtoull(argv[arg], NULL, 10);
+        if (n < 2) continue;
+
+        int* input = malloc(n * sizeof(int));
+        int* work  = malloc(n * sizeof(int));
+        if (input == NULL || work == NULL) {
+            fprintf(stderr, "Error: not enough memory for n = %zu\n", n);
+            return EXIT_FAILURE;
+        }
+        fill_random(input, n);
+
+        // Serial baselines
+        omp_set_num_threads(1);
+        int    est_bs;
+        double t_bs = time_bubble(run_bubble_s, input, work, n, &all_ok, &est_bs);
+        double t_qs = time_sort(run_qsort, input, work, n, &all_ok);
+        print_row(n, 1, "bubble_sort_serial", t_bs, est_bs, t_bs, est_bs, t_qs, t_bs);
+        print_row(n, 1, "qsort", t_qs, 0, t_bs, est_bs, t_qs, t_qs);
+
+        // Parallel sorts; efficiency is relative to the same sort on 1 thread
+        double one_bp = 0, one_rx = 0, one_ms = 0;
+        // p = 1, 2, 4, ... and always max_threads itself
+        for (int p = 1; p <= max_threads;
+             p = (p < max_threads && p * 2 > max_threads) ? max_threads : p * 2) {
+            omp_set_num_threads(p);
+            int    est_bp;
+            double t_bp = time_bubble(run_bubble_p, input, work, n, &all_ok, &est_bp);
+            double t_rx = time_sort(par_radix_sort, input, work, n, &all_ok);
+            double t_ms = time_sort(par_merge_sort, input, work, n, &all_ok);
+            if (p == 1) {
+                one_bp = t_bp;
+                one_rx = t_rx;
+                one_ms = t_ms;
+            }
+            print_row(n, p, "bubble_sort_parallel", t_bp, est_bp, t_bs, est_bs, t_qs, one_bp);
+            print_row(n, p, "par_radix_sort", t_rx, 0, t_bs, est_bs, t_qs, one_rx);
+            print_row(n, p, "par_merge_sort", t_ms, 0, t_bs, est_bs, t_qs, one_ms);
+        }
+
+        free(input);
+        free(work);
+    }
+
+    if (!all_ok) {
+        printf("ERROR: some output was not sorted\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,324 @@
+// mpi_mat_vect.c
+// Distributed matrix-vector multiply (y = A*x) with MPI + Pthreads.
+//
+// Follows the hybrid structure of lab/lab3.c: MPI spreads the matrix over
+// ranks, and each rank splits its local rows over NUM_THREADS pthreads.
+// Two decompositions are timed on the same problem:
+//
+//   1D (row blocks):  rank p owns rows [r0, r1) of A and a block of x.
+//                     Every product needs the whole x -> MPI_Allgatherv of n
+//                     doubles per rank per multiply.
+//
+//   2D (block grid):  ranks form a pr x pc grid (MPI_Cart_create). Rank (r,c)
+//                     owns block A[r][c]. x is gathered only inside the grid
+//                     column (n/pc doubles) and the partial y is summed only
+//                     inside the grid row (m/pr doubles) with
+//                     MPI_Reduce_scatter. Per-rank traffic shrinks as sqrt(P).
+//
+// Compile: mpicc -O3 -march=native -o mpi_mat_vect mpi_mat_vect.c -lpthread
+// Run:     mpirun -np 4 ./mpi_mat_vect <m> <n> [reps]
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+// Number of worker threads per rank (as in lab3.c)
+#define NUM_THREADS 4
+
+// -------------------------------------------------------------------------
+// Block distribution helpers: split 'total' items over 'parts' owners,
+// giving the first (total % parts) owners one extra item.
+// -------------------------------------------------------------------------
+static int block_size(int total, int parts, int idx) {
+    return total / parts + (idx < total % parts ? 1 : 0);
+}
+
+static int block_start(int total, int parts, int idx) {
+    int rem = total % parts;
+    return idx * (total / parts) + (idx < rem ? idx : rem);
+}
+
+static void block_layout(int total, int parts, int* counts, int* displs) {
+    for (int p = 0; p < parts; p++) {
+        counts[p] = block_size(total, parts, p);
+        displs[p] = block_start(total, parts, p);
+    }
+}
+
+// -------------------------------------------------------------------------
+// Threaded local kernel: y[0..rows) = A_local[rows x cols] * x[0..cols)
+// -------------------------------------------------------------------------
+typedef struct {
+    const double* A;
+    const double* x;
+    double*       y;
+    int           cols;
+    int           first_row;
+    int           last_row;
+} MatVecTask;
+
+static void* thread_mat_vect(void* arg) {
+    MatVecTask* t = (MatVecTask*) arg;
+    int i = t->first_row;
+
+    // 4 rows at a time so each x[j] load is reused
+    for (; i + 4 <= t->last_row; i += 4) {
+        const double* a0 = t->A + (size_t) i * t->cols;
+        const double* a1 = a0 + t->cols;
+        const double* a2 = a1 + t->cols;
+        const double* a3 = a2 + t->cols;
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+        for (int j = 0; j < t->cols; j++) {
+            double xj = t->x[j];
+            s0 += a0[j] * xj;
+            s1 += a1[j] * xj;
+            s2 += a2[j] * xj;
+            s3 += a3[j] * xj;
+        }
+        t->y[i] = s0; t->y[i + 1] = s1; t->y[i + 2] = s2; t->y[i + 3] = s3;
+    }
+    for (; i < t->last_row; i++) {
+        const double* a = t->A + (size_t) i * t->cols;
+        double s = 0.0;
+        for (int j = 0; j < t->cols; j++) s += a[j] * t->x[j];
+        t->y[i] = s;
+    }
+    return NULL;
+}
+
+static void local_mat_vect(const double* A, const double* x, double* y,
+                           int rows, int cols) {
+    pthread_t  threads[NUM_THREADS];
+    MatVecTask tasks[NUM_THREADS];
+
+    for (int t = 0; t < NUM_THREADS; t++) {
+        tasks[t].A         = A;
+        tasks[t].x         = x;
+        tasks[t].y         = y;
+        tasks[t].cols      = cols;
+        tasks[t].first_row = block_start(rows, NUM_THREADS, t);
+        tasks[t].last_row  = tasks[t].first_row + block_size(rows, NUM_THREADS, t);
+        pthread_create(&threads[t], NULL, thread_mat_vect, &tasks[t]);
+    }
+    for (int t = 0; t < NUM_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+}
+
+// Dummy data: A[i][j] = (i + j) % 7, x[j] = 1 + j % 3
+static double a_val(long i, long j) { return (double) ((i + j) % 7); }
+static double x_val(long j)         { return 1.0 + j % 3; }
+
+// Exact y[i] = sum_j a_val(i,j) * x_val(j), computed serially for checking
+static double y_exact(long i, int n) {
+    double s = 0.0;
+    for (long j = 0; j < n; j++) s += a_val(i, j) * x_val(j);
+    return s;
+}
+
+typedef struct {
+    double total;       // seconds per multiply (max over ranks)
+    double comm;        // seconds spent in MPI per multiply (max over ranks)
+    double bytes;       // bytes received per rank per multiply (max over ranks)
+    int    errors;      // wrong entries of y (sum over ranks)
+} Result;
+
+// Combines the per-rank results: max of the times and bytes, sum of the errors
+static Result reduce_result(Result local, MPI_Comm comm) {
+    double in[3] = { local.total, local.comm, local.bytes }, out[3];
+    Result res;
+    MPI_Allreduce(in, out, 3, MPI_DOUBLE, MPI_MAX, comm);
+    MPI_Allreduce(&local.errors, &res.errors, 1, MPI_INT, MPI_SUM, comm);
+    res.total = out[0];
+    res.comm = out[1];
+    res.bytes = out[2];
+    return res;
+}
+
+// -------------------------------------------------------------------------
+// 1D row decomposition
+// -------------------------------------------------------------------------
+static Result run_1d(int m, int n, int reps, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    int* x_counts = malloc(size * sizeof(int));
+    int* x_displs = malloc(size * sizeof(int));
+    block_layout(n, size, x_counts, x_displs);
+
+    int rows = block_size(m, size, rank);
+    int row0 = block_start(m, size, rank);
+
+    double* A       = malloc((size_t) rows * n * sizeof(double));
+    double* x_local = malloc((x_counts[rank] + 1) * sizeof(double));
+    double* x       = malloc(n * sizeof(double));
+    double* y       = malloc((rows + 1) * sizeof(double));
+
+    for (int i = 0; i < rows; i++)
+        for (int j = 0; j < n; j++)
+            A[(size_t) i * n + j] = a_val(row0 + i, j);
+    for (int j = 0; j < x_counts[rank]; j++)
+        x_local[j] = x_val(x_displs[rank] + j);
+
+    double comm_t = 0.0;
+    MPI_Barrier(comm);
+    double t0 = MPI_Wtime();
+    for (int r = 0; r < reps; r++) {
+        double c0 = MPI_Wtime();
+        MPI_Allgatherv(x_local, x_counts[rank], MPI_DOUBLE,
+                       x, x_counts, x_displs, MPI_DOUBLE, comm);
+        comm_t += MPI_Wtime() - c0;
+
+        local_mat_vect(A, x, y, rows, n);
+    }
+    double total_t = MPI_Wtime() - t0;
+
+    int errors = 0;
+    for (int i = 0; i < rows; i++)
+        if (fabs(y[i] - y_exact(row0 + i, n)) > 1e-6) errors++;
+
+    Result local = { total_t / reps, comm_t / reps,
+                     (double) (n - x_counts[rank]) * sizeof(double), errors };
+    Result res = reduce_result(local, comm);
+
+    free(A); free(x_local); free(x); free(y);
+    free(x_counts); free(x_displs);
+    return res;
+}
+
+// -------------------------------------------------------------------------
+// 2D block decomposition over a pr x pc Cartesian grid
+// -------------------------------------------------------------------------
+static Result run_2d(int m, int n, int reps, MPI_Comm comm, int dims_out[2]) {
+    int size;
+    MPI_Comm_size(comm, &size);
+
+    int dims[2] = {0, 0}, periods[2] = {0, 0}, coords[2];
+    MPI_Dims_create(size, 2, dims);
+    dims_out[0] = dims[0];
+    dims_out[1] = dims[1];
+
+    MPI_Comm grid, row_comm, col_comm;
+    int grid_rank;
+    MPI_Cart_create(comm, 2, dims, periods, 1, &grid);
+    MPI_Comm_rank(grid, &grid_rank);
+    MPI_Cart_coords(grid, grid_rank, 2, coords);
+
+    int keep_cols[2] = {0, 1};  // ranks in my grid row (vary column)
+    int keep_rows[2] = {1, 0};  // ranks in my grid column (vary row)
+    MPI_Cart_sub(grid, keep_cols, &row_comm);
+    MPI_Cart_sub(grid, keep_rows, &col_comm);
+
+    int pr = dims[0], pc = dims[1];
+    int my_r = coords[0], my_c = coords[1];
+
+    // My block of A: rows of block my_r, columns of block my_c
+    int rows = block_size(m, pr, my_r), row0 = block_start(m, pr, my_r);
+    int cols = block_size(n, pc, my_c), col0 = block_start(n, pc, my_c);
+
+    // x block my_c is spread over the pr ranks of my grid column
+    int* xc_counts = malloc(pr * sizeof(int));
+    int* xc_displs = malloc(pr * sizeof(int));
+    block_layout(cols, pr, xc_counts, xc_displs);
+
+    // y block my_r ends up spread over the pc ranks of my grid row
+    int* yr_counts = malloc(pc * sizeof(int));
+    int* yr_displs = malloc(pc * sizeof(int));
+    block_layout(rows, pc, yr_counts, yr_displs);
+
+    double* A       = malloc(((size_t) rows * cols + 1) * sizeof(double));
+    double* x_local = malloc((xc_counts[my_r] + 1) * sizeof(double));
+    double* x       = malloc((cols + 1) * sizeof(double));
+    double* y_part  = malloc((rows + 1) * sizeof(double));
+    double* y_local = malloc((yr_counts[my_c] + 1) * sizeof(double));
+
+    for (int i = 0; i < rows; i++)
+        for (int j = 0; j < cols; j++)
+            A[(size_t) i * cols + j] = a_val(row0 + i, col0 + j);
+    for (int j = 0; j < xc_counts[my_r]; j++)
+        x_local[j] = x_val(col0 + xc_displs[my_r] + j);
+
+    double comm_t = 0.0;
+    MPI_Barrier(grid);
+    double t0 = MPI_Wtime();
+    for (int r = 0; r < reps; r++) {
+        double c0 = MPI_Wtime();
+        MPI_Allgatherv(x_local, xc_counts[my_r], MPI_DOUBLE,
+                       x, xc_counts, xc_displs, MPI_DOUBLE, col_comm);
+        comm_t += MPI_Wtime() - c0;
+
+        local_mat_vect(A, x, y_part, rows, cols);
+
+        c0 = MPI_Wtime();
+        MPI_Reduce_scatter(y_part, y_local, yr_counts, MPI_DOUBLE, MPI_SUM, row_comm);
+        comm_t += MPI_Wtime() - c0;
+    }
+    double total_t = MPI_Wtime() - t0;
+
+    int errors = 0;
+    for (int i = 0; i < yr_counts[my_c]; i++)
+        if (fabs(y_local[i] - y_exact(row0 + yr_displs[my_c] + i, n)) > 1e-6) errors++;
+
+    // Received: rest of x block + (pc-1) partial pieces of my y slice
+    double bytes = (double) (cols - xc_counts[my_r]) * sizeof(double)
+                 + (double) (pc - 1) * yr_counts[my_c] * sizeof(double);
+    Result local = { total_t / reps, comm_t / reps, bytes, errors };
+    Result res = reduce_result(local, grid);
+
+    free(A); free(x_local); free(x); free(y_part); free(y_local);
+    free(xc_counts); free(xc_displs); free(yr_counts); free(yr_displs);
+    MPI_Comm_free(&row_comm);
+    MPI_Comm_free(&col_comm);
+    MPI_Comm_free(&grid);
+    return res;
+}
+
+int main(int argc, char** argv) {
+    int rank, size, provided;
+
+    // Only the main thread calls MPI; worker threads never do
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if (argc < 3) {
+        if (rank == 0) fprintf(stderr, "Usage: %s <m> <n> [reps]\n", argv[0]);
+        MPI_Finalize();
+        return 1;
+    }
+    int m    = strtol(argv[1], NULL, 10);
+    int n    = strtol(argv[2], NULL, 10);
+    int reps = argc > 3 ? strtol(argv[3], NULL, 10) : 10;
+    if (m <= 0 || n <= 0 || reps <= 0) {
+        if (rank == 0) fprintf(stderr, "Error: all arguments must be positive.\n");
+        MPI_Finalize();
+        return 1;
+    }
+
+    int    dims[2];
+    Result r1 = run_1d(m, n, reps, MPI_COMM_WORLD);
+    Result r2 = run_2d(m, n, reps, MPI_COMM_WORLD, dims);
+
+    if (rank == 0) {
+        double flops = 2.0 * m * n;
+        printf("m = %d, n = %d, P = %d, threads/rank = %d, reps = %d\n",
+               m, n, size, NUM_THREADS, reps);
+        printf("%-10s %10s %10s %10s %14s %8s\n",
+               "layout", "time(ms)", "comm(ms)", "GFLOP/s", "recv KB/rank", "errors");
+        printf("%-10s %10.3f %10.3f %10.2f %14.1f %8d\n", "1D rows",
+               r1.total * 1e3, r1.comm * 1e3, flops / r1.total * 1e-9,
+               r1.bytes / 1024.0, r1.errors);
+        char name[32];
+        snprintf(name, sizeof(name), "2D %dx%d", dims[0], dims[1]);
+        printf("%-10s %10.3f %10.3f %10.2f %14.1f %8d\n", name,
+               r2.total * 1e3, r2.comm * 1e3, flops / r2.total * 1e-9,
+               r2.bytes / 1024.0, r2.errors);
+    }
+
+    MPI_Finalize();
+    return (r1.errors == 0 && r2.errors == 0) ? 0 : 1;
+}
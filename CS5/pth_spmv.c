@@ -0,0 +1,453 @@
+// pth_spmv.c
+// Sparse matrix-vector multiply (y = A*x) with Pthreads: CSR and SELL-C-sigma.
+//
+//   - Reads a Matrix Market (.mtx) coordinate file into CSR
+//     (real / integer / pattern, general / symmetric).
+//   - Optionally (sigma > 0) converts CSR to SELL-C-sigma: rows are sorted by length
+//     inside windows of sigma rows, packed in chunks of C rows and stored
+//     column-major, so the inner loop runs over C independent rows (SIMD).
+//   - Rows are split between threads by NONZERO count, not by row count,
+//     so a few long rows do not leave the other threads idle.
+//   - Threads are a fixed worker pool (created once, reused every multiply),
+//     as in Option A of lab/lab3.md.
+//
+// Compile: gcc -O3 -march=native -o pth_spmv pth_spmv.c -lpthread
+// Run:     ./pth_spmv <matrix.mtx> <thread_count> [sigma] [reps]
+//          ./pth_spmv random:<rows>:<avg_nnz_per_row> <thread_count> [sigma] [reps]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
+
+#define SELL_C 8            // chunk height: 8 doubles = one AVX-512 register
+
+// -------------------------------------------------------------------------
+// Sparse formats
+// -------------------------------------------------------------------------
+typedef struct {
+    int     m, n;
+    long    nnz;
+    long*   row_ptr;        // m + 1 entries
+    int*    col;            // nnz entries
+    double* val;            // nnz entries
+} CSR;
+
+typedef struct {
+    int     m, n, C, sigma;
+    int     n_chunks;
+    long*   chunk_ptr;      // start of each chunk in col/val (n_chunks + 1)
+    int*    chunk_len;      // width (longest row) of each chunk
+    int*    perm;           // perm[k] = original row stored in slot k
+    int*    col;            // column-major inside a chunk, padded with col 0
+    double* val;            // padded with 0.0
+} SELL;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// -------------------------------------------------------------------------
+// COO -> CSR (counting sort by row)
+// -------------------------------------------------------------------------
+static void coo_to_csr(CSR* A, int m, int n, long nnz,
+                       const int* ri, const int* ci, const double* v) {
+    A->m = m;
+    A->n = n;
+    A->nnz = nnz;
+    A->row_ptr = calloc(m + 1, sizeof(long));
+    A->col = malloc(nnz * sizeof(int));
+    A->val = malloc(nnz * sizeof(double));
+
+    for (long k = 0; k < nnz; k++) A->row_ptr[ri[k] + 1]++;
+    for (int i = 0; i < m; i++) A->row_ptr[i + 1] += A->row_ptr[i];
+
+    long* next = malloc(m * sizeof(long));
+    memcpy(next, A->row_ptr, m * sizeof(long));
+    for (long k = 0; k < nnz; k++) {
+        long dst = next[ri[k]]++;
+        A->col[dst] = ci[k];
+        A->val[dst] = v[k];
+    }
+    free(next);
+}
+
+// -------------------------------------------------------------------------
+// Matrix Market reader. Returns 0 on success.
+// -------------------------------------------------------------------------
+static int read_matrix_market(const char* path, CSR* A) {
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    char line[1024], object[64], format[64], field[64], symmetry[64];
+    if (fgets(line, sizeof(line), f) == NULL ||
+        sscanf(line, "%%%%MatrixMarket %63s %63s %63s %63s",
+               object, format, field, symmetry) != 4 ||
+        strcmp(format, "coordinate") != 0) {
+        fprintf(stderr, "%s: only 'coordinate' Matrix Market files are supported\n", path);
+        fclose(f);
+        return -1;
+    }
+    int pattern   = strcmp(field, "pattern") == 0;
+    int symmetric = strcmp(symmetry, "symmetric") == 0 ||
+                    strcmp(symmetry, "skew-symmetric") == 0;
+    double skew   = strcmp(symmetry, "skew-symmetric") == 0 ? -1.0 : 1.0;
+    if (strcmp(field, "complex") == 0) {
+        fprintf(stderr, "%s: complex matrices are not supported\n", path);
+        fclose(f);
+        return -1;
+    }
+
+    // Skip comments
+    do {
+        if (fgets(line, sizeof(line), f) == NULL) {
+            fclose(f);
+            return -1;
+        }
+    } while (line[0] == '%');
+
+    int  m, n;
+    long entries;
+    if (sscanf(line, "%d %d %ld", &m, &n, &entries) != 3) {
+        fprintf(stderr, "%s: bad size line\n", path);
+        fclose(f);
+        return -1;
+    }
+
+    long    cap = symmetric ? 2 * entries : entries;
+    int*    ri  = malloc(cap * sizeof(int));
+    int*    ci  = malloc(cap * sizeof(int));
+    double* v   = malloc(cap * sizeof(double));
+    long    nnz = 0;
+
+    for (long k = 0; k < entries; k++) {
+        int    i, j;
+        double a = 1.0;
+        int    got = pattern ? fscanf(f, "%d %d", &i, &j)
+                             : fscanf(f, "%d %d %lf", &i, &j, &a);
+        if (got != (pattern ? 2 : 3) || i < 1 || i > m || j < 1 || j > n) {
+            fprintf(stderr, "%s: bad entry %ld\n", path, k + 1);
+            free(ri); free(ci); free(v);
+            fclose(f);
+            return -1;
+        }
+        ri[nnz] = i - 1; ci[nnz] = j - 1; v[nnz] = a; nnz++;
+        if (symmetric && i != j) {
+            ri[nnz] = j - 1; ci[nnz] = i - 1; v[nnz] = skew * a; nnz++;
+        }
+    }
+    fclose(f);
+
+    coo_to_csr(A, m, n, nnz, ri, ci, v);
+    free(ri); free(ci); free(v);
+    return 0;
+}
+
+// -------------------------------------------------------------------------
+// Random test matrix with very uneven row lengths (a few rows are ~50x
+// longer than average), which is where nnz-based partitioning matters.
+// -------------------------------------------------------------------------
+static void random_matrix(CSR* A, int m, int avg) {
+    unsigned seed = 12345;
+    long     cap  = (long) m * avg * 2 + m;
+    int*     ri   = malloc(cap * sizeof(int));
+    int*     ci   = malloc(cap * sizeof(int));
+    double*  v    = malloc(cap * sizeof(double));
+    long     nnz  = 0;
+
+    for (int i = 0; i < m; i++) {
+        seed = seed * 1103515245u + 12345u;
+        int len = (seed >> 16) % 64 == 0 ? avg * 50 : 1 + (int) ((seed >> 8) % avg);
+        if (nnz + len > cap) len = (int) (cap - nnz);
+        for (int k = 0; k < len; k++) {
+            seed = seed * 1103515245u + 12345u;
+            ri[nnz] = i;
+            ci[nnz] = (seed >> 4) % m;
+            v[nnz]  = 1.0 + (seed >> 20) % 4;
+            nnz++;
+        }
+    }
+    coo_to_csr(A, m, m, nnz, ri, ci, v);
+    free(ri); free(ci); free(v);
+}
+
+// -------------------------------------------------------------------------
+// CSR -> SELL-C-sigma
+// -------------------------------------------------------------------------
+static const long* sort_row_ptr;   // row lengths used by the comparator
+
+static int cmp_row_len_desc(const void* a, const void* b) {
+    int ra = *(const int*) a, rb = *(const int*) b;
+    long la = sort_row_ptr[ra + 1] - sort_row_ptr[ra];
+    long lb = sort_row_ptr[rb + 1] - sort_row_ptr[rb];
+    return (la < lb) - (la > lb);
+}
+
+static void csr_to_sell(const CSR* A, SELL* S, int sigma) {
+    S->m = A->m;
+    S->n = A->n;
+    S->C = SELL_C;
+    S->sigma = sigma;
+    S->n_chunks = (A->m + SELL_C - 1) / SELL_C;
+    S->perm = malloc(S->n_chunks * SELL_C * sizeof(int));
+    S->chunk_len = malloc(S->n_chunks * sizeof(int));
+    S->chunk_ptr = malloc((S->n_chunks + 1) * sizeof(long));
+
+    // Sort rows by length inside each sigma window
+    for (int i = 0; i < A->m; i++) S->perm[i] = i;
+    sort_row_ptr = A->row_ptr;
+    for (int w = 0; w < A->m; w += sigma) {
+        int len = (w + sigma <= A->m) ? sigma : A->m - w;
+        qsort(S->perm + w, len, sizeof(int), cmp_row_len_desc);
+    }
+    // Padding slots of the last chunk point at row -1 (empty)
+    for (int k = A->m; k < S->n_chunks * SELL_C; k++) S->perm[k] = -1;
+
+    S->chunk_ptr[0] = 0;
+    for (int c = 0; c < S->n_chunks; c++) {
+        int width = 0;
+        for (int r = 0; r < SELL_C; r++) {
+            int row = S->perm[c * SELL_C + r];
+            if (row >= 0) {
+                int len = (int) (A->row_ptr[row + 1] - A->row_ptr[row]);
+                if (len > width) width = len;
+            }
+        }
+        S->chunk_len[c] = width;
+        S->chunk_ptr[c + 1] = S->chunk_ptr[c] + (long) width * SELL_C;
+    }
+
+    long total = S->chunk_ptr[S->n_chunks];
+    S->col = calloc(total, sizeof(int));
+    S->val = calloc(total, sizeof(double));
+    for (int c = 0; c < S->n_chunks; c++) {
+        for (int r = 0; r < SELL_C; r++) {
+            int row = S->perm[c * SELL_C + r];
+            if (row < 0) continue;
+            long k = 0;
+            for (long p = A->row_ptr[row]; p < A->row_ptr[row + 1]; p++, k++) {
+                long dst = S->chunk_ptr[c] + k * SELL_C + r;
+                S->col[dst] = A->col[p];
+                S->val[dst] = A->val[p];
+            }
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// Kernels over a range of rows (CSR) or chunks (SELL)
+// -------------------------------------------------------------------------
+static void spmv_csr(const CSR* A, const double* x, double* y, int r0, int r1) {
+    for (int i = r0; i < r1; i++) {
+        double s = 0.0;
+        for (long p = A->row_ptr[i]; p < A->row_ptr[i + 1]; p++) {
+            s += A->val[p] * x[A->col[p]];
+        }
+        y[i] = s;
+    }
+}
+
+static void spmv_sell(const SELL* S, const double* x, double* y, int c0, int c1) {
+    for (int c = c0; c < c1; c++) {
+        double acc[SELL_C] = {0};
+        const int*    col = S->col + S->chunk_ptr[c];
+        const double* val = S->val + S->chunk_ptr[c];
+        for (int j = 0; j < S->chunk_len[c]; j++) {
+            // C independent rows -> the compiler turns this into a gather + FMA
+            for (int r = 0; r < SELL_C; r++) {
+                acc[r] += val[j * SELL_C + r] * x[col[j * SELL_C + r]];
+            }
+        }
+        for (int r = 0; r < SELL_C; r++) {
+            int row = S->perm[c * SELL_C + r];
+            if (row >= 0) y[row] = acc[r];
+        }
+    }
+}
+
+// -------------------------------------------------------------------------
+// Nonzero-balanced partition: thread t gets the items whose prefix sum
+// crosses t * total / threads. 'prefix' has count + 1 entries.
+// -------------------------------------------------------------------------
+static int upper_bound(const long* prefix, int count, long target) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (prefix[mid] <= target) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static void partition_by_nnz(const long* prefix, int count, int threads, int* bounds) {
+    long total = prefix[count];
+    bounds[0] = 0;
+    for (int t = 1; t < threads; t++) {
+        int b = upper_bound(prefix, count, total * t / threads) - 1;
+        if (b < bounds[t - 1]) b = bounds[t - 1];
+        bounds[t] = b;
+    }
+    bounds[threads] = count;
+}
+
+// -------------------------------------------------------------------------
+// Worker pool: threads wait on a barrier, run the current job, wait again
+// -------------------------------------------------------------------------
+enum { JOB_CSR, JOB_SELL, JOB_EXIT };
+
+typedef struct {
+    int               thread_count;
+    pthread_barrier_t start, done;
+    int               job;
+    const CSR*        csr;
+    const SELL*       sell;
+    const double*     x;
+    double*           y;
+    int*              csr_bounds;   // thread_count + 1 row boundaries
+    int*              sell_bounds;  // thread_count + 1 chunk boundaries
+} Pool;
+
+typedef struct {
+    Pool* pool;
+    long  rank;
+} Worker;
+
+static void* worker_main(void* arg) {
+    Worker* w = (Worker*) arg;
+    Pool*   p = w->pool;
+    for (;;) {
+        pthread_barrier_wait(&p->start);
+        if (p->job == JOB_EXIT) break;
+        if (p->job == JOB_CSR)
+            spmv_csr(p->csr, p->x, p->y, p->csr_bounds[w->rank], p->csr_bounds[w->rank + 1]);
+        else
+            spmv_sell(p->sell, p->x, p->y, p->sell_bounds[w->rank], p->sell_bounds[w->rank + 1]);
+        pthread_barrier_wait(&p->done);
+    }
+    return NULL;
+}
+
+// The calling thread acts as worker 0
+static void pool_run(Pool* p, int job) {
+    p->job = job;
+    pthread_barrier_wait(&p->start);
+    if (job == JOB_CSR)
+        spmv_csr(p->csr, p->x, p->y, p->csr_bounds[0], p->csr_bounds[1]);
+    else
+        spmv_sell(p->sell, p->x, p->y, p->sell_bounds[0], p->sell_bounds[1]);
+    pthread_barrier_wait(&p->done);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <matrix.mtx | random:<rows>:<avg_nnz>> <thread_count> [sigma] [reps]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    int thread_count = strtol(argv[2], NULL, 10);
+    int sigma        = argc > 3 ? strtol(argv[3], NULL, 10) : 256;
+    int reps         = argc > 4 ? strtol(argv[4], NULL, 10) : 20;
+    if (thread_count <= 0 || sigma < 0 || reps <= 0) {
+        fprintf(stderr, "Error: thread_count and reps must be positive, sigma >= 0 (0 = CSR only).\n");
+        exit(EXIT_FAILURE);
+    }
+
+    CSR A;
+    int rows, avg;
+    if (sscanf(argv[1], "random:%d:%d", &rows, &avg) == 2 && rows > 0 && avg > 0) {
+        random_matrix(&A, rows, avg);
+    } else if (read_matrix_market(argv[1], &A) != 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    double t0 = now_sec();
+    SELL S = {0};
+    if (sigma > 0) csr_to_sell(&A, &S, sigma);
+    double convert_t = now_sec() - t0;
+
+    double* x     = malloc(A.n * sizeof(double));
+    double* y_csr = calloc(A.m, sizeof(double));
+    double* y_sel = calloc(A.m, sizeof(double));
+    double* y_ref = calloc(A.m, sizeof(double));
+    for (int j = 0; j < A.n; j++) x[j] = 1.0 + (j % 5) * 0.25;
+    spmv_csr(&A, x, y_ref, 0, A.m);
+
+    // Partitions: by nonzeros for both formats, and by rows for comparison
+    int* csr_nnz_bounds = malloc((thread_count + 1) * sizeof(int));
+    int* csr_row_bounds = malloc((thread_count + 1) * sizeof(int));
+    int* sell_bounds    = malloc((thread_count + 1) * sizeof(int));
+    partition_by_nnz(A.row_ptr, A.m, thread_count, csr_nnz_bounds);
+    if (sigma > 0) partition_by_nnz(S.chunk_ptr, S.n_chunks, thread_count, sell_bounds);
+    for (int t = 0; t <= thread_count; t++)
+        csr_row_bounds[t] = (int) ((long) A.m * t / thread_count);
+
+    Pool pool = { .thread_count = thread_count, .csr = &A, .sell = &S, .x = x,
+                  .sell_bounds = sell_bounds };
+    pthread_barrier_init(&pool.start, NULL, thread_count);
+    pthread_barrier_init(&pool.done, NULL, thread_count);
+    pthread_t* handles = malloc(thread_count * sizeof(pthread_t));
+    Worker*    workers = malloc(thread_count * sizeof(Worker));
+    for (long t = 0; t < thread_count; t++) {
+        workers[t].pool = &pool;
+        workers[t].rank = t;
+        if (t > 0) pthread_create(&handles[t], NULL, worker_main, &workers[t]);
+    }
+
+    // Minimum data a CSR multiply must move: values, column indices,
+    // row pointers, x once and y once. Both formats are rated against it.
+    double bytes = A.nnz * (sizeof(double) + sizeof(int))
+                 + (A.m + 1) * sizeof(long) + (double) A.n * sizeof(double)
+                 + (double) A.m * sizeof(double);
+
+    struct { const char* name; int job; int* bounds; double* y; double best; } runs[] = {
+        { "CSR, rows split",    JOB_CSR,  csr_row_bounds, y_csr, 1e30 },
+        { "CSR, nnz split",     JOB_CSR,  csr_nnz_bounds, y_csr, 1e30 },
+        { "SELL-C-sigma",       JOB_SELL, NULL,           y_sel, 1e30 },
+    };
+    int n_runs = sigma > 0 ? 3 : 2;
+    int errors = 0;
+
+    for (int k = 0; k < n_runs; k++) {
+        pool.y = runs[k].y;
+        pool.csr_bounds = runs[k].bounds;
+        for (int r = 0; r < reps; r++) {
+            t0 = now_sec();
+            pool_run(&pool, runs[k].job);
+            double dt = now_sec() - t0;
+            if (dt < runs[k].best) runs[k].best = dt;
+        }
+        for (int i = 0; i < A.m; i++)
+            if (fabs(runs[k].y[i] - y_ref[i]) > 1e-9 * (1.0 + fabs(y_ref[i]))) errors++;
+    }
+
+    pool.job = JOB_EXIT;
+    pthread_barrier_wait(&pool.start);
+    for (long t = 1; t < thread_count; t++) pthread_join(handles[t], NULL);
+
+    long padded = sigma > 0 ? S.chunk_ptr[S.n_chunks] : A.nnz;
+    printf("Matrix: %d x %d, nnz = %ld, threads = %d\n", A.m, A.n, A.nnz, thread_count);
+    if (sigma > 0)
+        printf("SELL-%d-%d: %.1f%% padding, conversion %.1f ms\n", SELL_C, sigma,
+               100.0 * (padded - A.nnz) / (A.nnz ? A.nnz : 1), convert_t * 1e3);
+    printf("%-18s %10s %10s %10s\n", "kernel", "time(ms)", "GFLOP/s", "GB/s");
+    for (int k = 0; k < n_runs; k++) {
+        printf("%-18s %10.3f %10.2f %10.2f\n", runs[k].name, runs[k].best * 1e3,
+               2.0 * A.nnz / runs[k].best * 1e-9, bytes / runs[k].best * 1e-9);
+    }
+    if (errors) printf("ERROR: %d wrong entries in y\n", errors);
+
+    pthread_barrier_destroy(&pool.start);
+    pthread_barrier_destroy(&pool.done);
+    free(handles); free(workers);
+    free(csr_nnz_bounds); free(csr_row_bounds); free(sell_bounds);
+    free(x); free(y_csr); free(y_sel); free(y_ref);
+    free(A.row_ptr); free(A.col); free(A.val);
+    free(S.chunk_ptr); free(S.chunk_len); free(S.perm); free(S.col); free(S.val);
+
+    return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,246 @@
+// sync_bench.c
+// Benchmark of synchronization strategies for a shared accumulator.
+//
+// Every strategy computes the same pi series
+//     pi = 4 * (1 - 1/3 + 1/5 - 1/7 + ...)
+// with n terms split over the threads. The strategies differ only in how
+// each term reaches the shared sum:
+//
+//   busy_wait       turn flag (CS5/busy-waiting.md), handed on every term
+//   pthread_mutex   pthread_mutex_t around every add (CS5/mutex.md)
+//   omp_critical    #pragma omp critical around every add (CS7/mutexomp.md)
+//   omp_lock        omp_lock_t around every add
+//   omp_atomic      #pragma omp atomic on every add
+//   c11_relaxed     stdatomic compare-exchange loop, memory_order_relaxed
+//   slots_packed    each thread adds into its own slot of a double[T] array;
+//                   slots share cache lines (false sharing)
+//   slots_padded    same, but each slot has its own 64-byte cache line
+//   local_reduce    thread-local sum, ONE locked add per thread at the end
+//
+// Output is CSV, one row per (strategy, threads):
+//   strategy,threads,terms,time_s,terms_per_s,speedup,efficiency,vs_padded,abs_error
+// speedup/efficiency are against the same strategy on 1 thread; vs_padded is
+// time / time(slots_padded) at the same thread count, so for slots_packed it
+// is the false-sharing penalty.
+//
+// Compile: gcc -O2 -fopenmp -o sync_bench sync_bench.c -lpthread -lm
+// Run:     ./sync_bench <max_threads> [terms] > sync.csv
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <omp.h>
+
+#define CACHE_LINE 64
+#define MAX_THREADS 256
+
+typedef struct {
+    double value;
+    char   pad[CACHE_LINE - sizeof(double)];
+} PaddedSlot;
+
+// Shared state used by the strategies
+static double          shared_sum;
+static _Atomic double  atomic_sum;
+static atomic_int      turn;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static omp_lock_t      omp_lock;
+static volatile double packed_slots[MAX_THREADS];
+static PaddedSlot      padded_slots[MAX_THREADS] __attribute__((aligned(CACHE_LINE)));
+
+static inline double term(long i) {
+    return ((i % 2 == 0) ? 1.0 : -1.0) / (2 * i + 1);
+}
+
+// Thread t handles terms [first, last); the first n % T threads get one extra
+static void my_range(long n, long* first, long* last) {
+    int  T = omp_get_num_threads(), t = omp_get_thread_num();
+    long q = n / T, r = n % T;
+    *first = t * q + (t < r ? t : r);
+    *last  = *first + q + (t < r ? 1 : 0);
+}
+
+// ---------------- Strategies (each runs inside a parallel region) ----------------
+
+// Terms are handed out round-robin (term i belongs to thread i % T) so the
+// turn flag can pass 0 -> 1 -> ... -> T-1 -> 0 on every term.
+static void run_busy_wait(long n) {
+    int T = omp_get_num_threads(), t = omp_get_thread_num();
+    for (long i = t; i < n; i += T) {
+        double v = term(i);
+        while (atomic_load_explicit(&turn, memory_order_acquire) != t)
+            sched_yield();   // without this, oversubscribed threads starve the owner
+        shared_sum += v;
+        atomic_store_explicit(&turn, (t + 1) % T, memory_order_release);
+    }
+}
+
+static void run_pthread_mutex(long n) {
+    long first, last;
+    my_range(n, &first, &last);
+    for (long i = first; i < last; i++) {
+        double v = term(i);
+        pthread_mutex_lock(&mutex);
+        shared_sum += v;
+        pthread_mutex_unlock(&mutex);
+    }
+}
+
+static void run_omp_critical(long n) {
+    long first, last;
+    my_range(n, &first, &last);
+    for (long i = first; i < last; i++) {
+        double v = term(i);
+        #pragma omp critical
+        shared_sum += v;
+    }
+}
+
+static void run_omp_lock(long n) {
+    long first, last;
+    my_range(n, &first, &last);
+    for (long i = first; i < last; i++) {
+        double v = term(i);
+        omp_set_lock(&omp_lock);
+        shared_sum += v;
+        omp_unset_lock(&omp_lock);
+    }
+}
+
+static void run_omp_atomic(long n) {
+    long first, last;
+    my_range(n, &first, &last);
+    for (long i = first; i < last; i++) {
+        double v = term(i);
+        #pragma omp atomic
+        shared_sum += v;
+    }
+}
+
+// C11 has no fetch_add for double, so use a relaxed compare-exchange loop
+static void run_c11_relaxed(long n) {
+    long first, last;
+    my_range(n, &first, &last);
+    for (long i = first; i < last; i++) {
+        double v = term(i);
+        double old = atomic_load_explicit(&atomic_sum, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(&atomic_sum, &old, old + v,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+        }
+    }
+}
+
+static void run_slots_packed(long n) {
+    long first, last;
+    int  t = omp_get_thread_num();
+    my_range(n, &first, &last);
+    for (long i = first; i < last; i++) packed_slots[t] += term(i);
+    #pragma omp barrier
+    #pragma omp single
+    for (int u = 0; u < omp_get_num_threads(); u++) shared_sum += packed_slots[u];
+}
+
+static void run_slots_padded(long n) {
+    long first, last;
+    int  t = omp_get_thread_num();
+    volatile double* slot = &padded_slots[t].value;   // force a store per term, like packed
+    my_range(n, &first, &last);
+    for (long i = first; i < last; i++) *slot += term(i);
+    #pragma omp barrier
+    #pragma omp single
+    for (int u = 0; u < omp_get_num_threads(); u++) shared_sum += padded_slots[u].value;
+}
+
+static void run_local_reduce(long n) {
+    long   first, last;
+    double my_sum = 0.0;
+    my_range(n, &first, &last);
+    for (long i = first; i < last; i++) my_sum += term(i);
+    #pragma omp critical
+    shared_sum += my_sum;
+}
+
+typedef struct {
+    const char* name;
+    void      (*run)(long n);
+} Strategy;
+
+static const Strategy strategies[] = {
+    { "busy_wait",     run_busy_wait },
+    { "pthread_mutex", run_pthread_mutex },
+    { "omp_critical",  run_omp_critical },
+    { "omp_lock",      run_omp_lock },
+    { "omp_atomic",    run_omp_atomic },
+    { "c11_relaxed",   run_c11_relaxed },
+    { "slots_packed",  run_slots_packed },
+    { "slots_padded",  run_slots_padded },
+    { "local_reduce",  run_local_reduce },
+};
+#define N_STRATEGIES (int) (sizeof(strategies) / sizeof(strategies[0]))
+#define PADDED_INDEX 7
+
+static double run_once(const Strategy* s, int threads, long n, double* pi) {
+    shared_sum = 0.0;
+    atomic_store(&atomic_sum, 0.0);
+    atomic_store(&turn, 0);
+    for (int t = 0; t < MAX_THREADS; t++) {
+        packed_slots[t] = 0.0;
+        padded_slots[t].value = 0.0;
+    }
+
+    double t0 = omp_get_wtime();
+    #pragma omp parallel num_threads(threads)
+    s->run(n);
+    double dt = omp_get_wtime() - t0;
+
+    *pi = 4.0 * (shared_sum + atomic_load(&atomic_sum));
+    return dt;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <max_threads> [terms]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    int  max_threads = atoi(argv[1]);
+    long n           = argc > 2 ? atol(argv[2]) : 2000000;
+    if (max_threads <= 0 || max_threads > MAX_THREADS || n <= 0) {
+        fprintf(stderr, "Error: 1 <= max_threads <= %d and terms > 0 required.\n", MAX_THREADS);
+        return EXIT_FAILURE;
+    }
+
+    omp_set_dynamic(0);
+    omp_init_lock(&omp_lock);
+
+    // Reference value with the same number of terms (serial, same order)
+    double ref = 0.0;
+    for (long i = 0; i < n; i++) ref += term(i);
+    ref *= 4.0;
+
+    double one_thread[N_STRATEGIES];
+    double times[N_STRATEGIES];
+    double pis[N_STRATEGIES];
+
+    printf("strategy,threads,terms,time_s,terms_per_s,speedup,efficiency,vs_padded,abs_error\n");
+    for (int p = 1; p <= max_threads; p++) {
+        for (int s = 0; s < N_STRATEGIES; s++) {
+            times[s] = run_once(&strategies[s], p, n, &pis[s]);
+            if (p == 1) one_thread[s] = times[s];
+        }
+        for (int s = 0; s < N_STRATEGIES; s++) {
+            double speedup = one_thread[s] / times[s];
+            printf("%s,%d,%ld,%.6f,%.4e,%.3f,%.3f,%.3f,%.3e\n",
+                   strategies[s].name, p, n, times[s], n / times[s], speedup,
+                   speedup / p, times[s] / times[PADDED_INDEX], fabs(pis[s] - ref));
+        }
+        fflush(stdout);
+    }
+
+    omp_destroy_lock(&omp_lock);
+    return EXIT_SUCCESS;
+}
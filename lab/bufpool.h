@@ -0,0 +1,317 @@
+// bufpool.h
+// Message buffers and zlib streams for the Lab 2/3 master and slaves,
+// reused so that sending a chunk allocates nothing.
+//
+// Every chunk used to get fresh buffers for compress, send, receive and
+// decompress, and compress()/uncompress() set up and free zlib's state
+// (about 270 KB for deflate) on every call. Here:
+//
+//   - Buffers come in power-of-two size classes from BUFPOOL_MIN_SIZE to
+//     BUFPOOL_MAX_SIZE. bufpool_reserve() allocates them up front with
+//     MPI_Alloc_mem, so an MPI on an RDMA fabric can register them once, and
+//     touches every page, so the hot path takes no page faults.
+//   - Each thread keeps up to BUFPOOL_CACHE free buffers per class in a
+//     thread-local stack: get and put need no lock and no atomic exchange.
+//     Only an empty or full stack moves half a stack from or to the shared
+//     depot, under a lock from locks.h.
+//   - bufpool_compress()/bufpool_uncompress() work like compress() and
+//     uncompress(), on a deflate and an inflate stream per thread that are
+//     created once and reset for every message.
+//   - Anything allocated after bufpool_init() other than by bufpool_reserve()
+//     (a get with no free buffer, a thread's first zlib stream) counts as a
+//     hot-path allocation. Reserve the job's working set and the counter
+//     stays at 0; bufpool_report() prints it.
+//
+// Usage:
+//   bufpool_init();                                   // after MPI_Init
+//   bufpool_reserve(n, 4);                            // 4 buffers of >= n bytes
+//   unsigned char* buf = bufpool_get(n);
+//   MPI_Isend(buf, ...); MPI_Wait(...);
+//   bufpool_put(buf);                                 // once the request is done
+//   bufpool_report("Master");
+//   bufpool_destroy();                                // before MPI_Finalize
+//
+// One pool per process. A thread's cached buffers return to the depot only
+// through bufpool_destroy() in that thread, so threads other than the main
+// one should not keep buffers cached when they exit.
+//
+// Header-only: #include "bufpool.h" after mpi.h; link with -lz -lpthread.
+
+#ifndef BUFPOOL_H
+#define BUFPOOL_H
+
+#include <mpi.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "locks.h"
+
+#define BUFPOOL_MIN_SHIFT 12                    // 4 KB
+#define BUFPOOL_MAX_SHIFT 30                    // 1 GB
+#define BUFPOOL_CLASSES   (BUFPOOL_MAX_SHIFT - BUFPOOL_MIN_SHIFT + 1)
+#define BUFPOOL_MIN_SIZE  ((size_t)1 << BUFPOOL_MIN_SHIFT)
+#define BUFPOOL_MAX_SIZE  ((size_t)1 << BUFPOOL_MAX_SHIFT)
+#define BUFPOOL_CACHE     8                     // free buffers per class per thread
+
+// In front of every buffer; keeps the data cache-line aligned
+typedef struct BufHeader {
+    struct BufHeader* next;                     // depot free list
+    int cls;                                    // size class, -1 for an oversized buffer
+    char pad[LOCK_CACHE_LINE - sizeof(void*) - sizeof(int)];
+} BufHeader;
+
+typedef struct {
+    Lock lock;                                  // protects the depot
+    BufHeader* depot[BUFPOOL_CLASSES];
+    int depot_n[BUFPOOL_CLASSES];
+    int started;                                // set by bufpool_init()
+    atomic_long gets;
+    atomic_long hot_allocations;                // see the header comment
+    atomic_long refills;                        // trips to the depot
+    atomic_long reserved;                       // buffers from bufpool_reserve()
+    atomic_long reserved_bytes;
+} BufPool;
+
+typedef struct {
+    BufHeader* buf[BUFPOOL_CACHE];
+    int n;
+} BufCache;
+
+static BufPool bufpool;
+static __thread BufCache bufpool_cache[BUFPOOL_CLASSES];
+static __thread struct {
+    z_stream deflate, inflate;
+    int deflate_ready, inflate_ready;
+} bufpool_zip;
+
+// -------------------------------------------------------------------------
+// Helpers
+// -------------------------------------------------------------------------
+static inline size_t bufpool_class_size(int cls) {
+    return (size_t)1 << (cls + BUFPOOL_MIN_SHIFT);
+}
+
+// Smallest class that holds 'size' bytes, or -1 if none does
+static inline int bufpool_class(size_t size) {
+    int cls = 0;
+    while (cls < BUFPOOL_CLASSES && bufpool_class_size(cls) < size) cls++;
+    return cls < BUFPOOL_CLASSES ? cls : -1;
+}
+
+// A new buffer of class 'cls' ('size' bytes if cls is -1), every page touched
+static inline BufHeader* bufpool_new(int cls, size_t size) {
+    size_t bytes = cls >= 0 ? bufpool_class_size(cls) : size;
+    void* mem;
+    if (MPI_Alloc_mem((MPI_Aint)(sizeof(BufHeader) + bytes), MPI_INFO_NULL, &mem) != MPI_SUCCESS) {
+        fprintf(stderr, "bufpool: cannot allocate %zu bytes\n", bytes);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    BufHeader* h = (BufHeader*)mem;
+    h->next = NULL;
+    h->cls = cls;
+    memset(h + 1, 0, bytes);
+    return h;
+}
+
+// zlib's allocator: count what zlib allocates once the pool has started
+static voidpf bufpool_zalloc(voidpf opaque, uInt items, uInt size) {
+    (void) opaque;
+    if (bufpool.started) atomic_fetch_add_explicit(&bufpool.hot_allocations, 1, memory_order_relaxed);
+    return calloc(items, size);
+}
+
+static void bufpool_zfree(voidpf opaque, voidpf address) {
+    (void) opaque;
+    free(address);
+}
+
+static inline void bufpool_zstream_init(z_stream* z) {
+    memset(z, 0, sizeof(*z));
+    z->zalloc = bufpool_zalloc;
+    z->zfree = bufpool_zfree;
+}
+
+// Moves up to half a cache of class 'cls' from the depot to this thread
+static inline void bufpool_refill(int cls) {
+    BufCache* c = &bufpool_cache[cls];
+    atomic_fetch_add_explicit(&bufpool.refills, 1, memory_order_relaxed);
+    lock_acquire(&bufpool.lock);
+    while (c->n < BUFPOOL_CACHE / 2 && bufpool.depot[cls] != NULL) {
+        BufHeader* h = bufpool.depot[cls];
+        bufpool.depot[cls] = h->next;
+        bufpool.depot_n[cls]--;
+        c->buf[c->n++] = h;
+    }
+    lock_release(&bufpool.lock);
+}
+
+// Moves the 'n' most recently cached buffers of class 'cls' to the depot
+static inline void bufpool_spill(int cls, int n) {
+    BufCache* c = &bufpool_cache[cls];
+    lock_acquire(&bufpool.lock);
+    while (n-- > 0 && c->n > 0) {
+        BufHeader* h = c->buf[--c->n];
+        h->next = bufpool.depot[cls];
+        bufpool.depot[cls] = h;
+        bufpool.depot_n[cls]++;
+    }
+    lock_release(&bufpool.lock);
+}
+
+// -------------------------------------------------------------------------
+// Interface
+// -------------------------------------------------------------------------
+static inline void bufpool_init(void) {
+    memset(&bufpool, 0, sizeof(bufpool));
+    lock_init(&bufpool.lock, LOCK_PTHREAD);
+    // This thread's zlib streams are part of the start-up cost
+    bufpool_zstream_init(&bufpool_zip.deflate);
+    bufpool_zip.deflate_ready = deflateInit(&bufpool_zip.deflate, Z_DEFAULT_COMPRESSION) == Z_OK;
+    bufpool_zstream_init(&bufpool_zip.inflate);
+    bufpool_zip.inflate_ready = inflateInit(&bufpool_zip.inflate) == Z_OK;
+    bufpool.started = 1;
+}
+
+// Allocates 'count' buffers of at least 'size' bytes into the depot
+static inline void bufpool_reserve(size_t size, int count) {
+    int cls = bufpool_class(size);
+    if (cls < 0) return;
+    for (int i = 0; i < count; i++) {
+        BufHeader* h = bufpool_new(cls, 0);
+        lock_acquire(&bufpool.lock);
+        h->next = bufpool.depot[cls];
+        bufpool.depot[cls] = h;
+        bufpool.depot_n[cls]++;
+        lock_release(&bufpool.lock);
+    }
+    atomic_fetch_add(&bufpool.reserved, count);
+    atomic_fetch_add(&bufpool.reserved_bytes, (long)(count * bufpool_class_size(cls)));
+}
+
+// A buffer of at least 'size' bytes (uninitialized contents)
+static inline void* bufpool_get(size_t size) {
+    atomic_fetch_add_explicit(&bufpool.gets, 1, memory_order_relaxed);
+    int cls = bufpool_class(size);
+    BufHeader* h;
+    if (cls < 0) {
+        h = bufpool_new(-1, size);          // too large to pool; freed by bufpool_put()
+        atomic_fetch_add_explicit(&bufpool.hot_allocations, 1, memory_order_relaxed);
+        return h + 1;
+    }
+    BufCache* c = &bufpool_cache[cls];
+    if (c->n == 0) bufpool_refill(cls);
+    if (c->n > 0) {
+        h = c->buf[--c->n];
+    } else {
+        h = bufpool_new(cls, 0);
+        atomic_fetch_add_explicit(&bufpool.hot_allocations, 1, memory_order_relaxed);
+    }
+    return h + 1;
+}
+
+// Returns a buffer from bufpool_get(); NULL is ignored
+static inline void bufpool_put(void* buf) {
+    if (buf == NULL) return;
+    BufHeader* h = (BufHeader*)buf - 1;
+    if (h->cls < 0) {
+        MPI_Free_mem(h);
+        return;
+    }
+    BufCache* c = &bufpool_cache[h->cls];
+    if (c->n == BUFPOOL_CACHE) bufpool_spill(h->cls, BUFPOOL_CACHE / 2);
+    c->buf[c->n++] = h;
+}
+
+// compress() on this thread's deflate stream: same arguments, same results
+static inline int bufpool_compress(Bytef* dst, uLongf* dst_len, const Bytef* src, uLong src_len) {
+    z_stream* z = &bufpool_zip.deflate;
+    if (!bufpool_zip.deflate_ready) {
+        bufpool_zstream_init(z);
+        if (deflateInit(z, Z_DEFAULT_COMPRESSION) != Z_OK) return Z_MEM_ERROR;
+        bufpool_zip.deflate_ready = 1;
+    } else {
+        deflateReset(z);
+    }
+    // avail_in/avail_out are 32-bit: feed buffers over 4 GB a piece at a time
+    uLong left_in = src_len, left_out = *dst_len;
+    z->next_in = (Bytef*)src;
+    z->next_out = dst;
+    z->avail_in = z->avail_out = 0;
+    int err;
+    do {
+        if (z->avail_out == 0) {
+            z->avail_out = left_out > (uInt)-1 ? (uInt)-1 : (uInt)left_out;
+            left_out -= z->avail_out;
+        }
+        if (z->avail_in == 0) {
+            z->avail_in = left_in > (uInt)-1 ? (uInt)-1 : (uInt)left_in;
+            left_in -= z->avail_in;
+        }
+        err = deflate(z, left_in > 0 ? Z_NO_FLUSH : Z_FINISH);
+    } while (err == Z_OK);
+    *dst_len = z->total_out;
+    return err == Z_STREAM_END ? Z_OK : err;
+}
+
+// uncompress() on this thread's inflate stream: same arguments, same results
+static inline int bufpool_uncompress(Bytef* dst, uLongf* dst_len, const Bytef* src, uLong src_len) {
+    z_stream* z = &bufpool_zip.inflate;
+    if (!bufpool_zip.inflate_ready) {
+        bufpool_zstream_init(z);
+        if (inflateInit(z) != Z_OK) return Z_MEM_ERROR;
+        bufpool_zip.inflate_ready = 1;
+    } else {
+        inflateReset(z);
+    }
+    uLong left_in = src_len, left_out = *dst_len;
+    z->next_in = (Bytef*)src;
+    z->next_out = dst;
+    z->avail_in = z->avail_out = 0;
+    int err;
+    do {
+        if (z->avail_out == 0) {
+            z->avail_out = left_out > (uInt)-1 ? (uInt)-1 : (uInt)left_out;
+            left_out -= z->avail_out;
+        }
+        if (z->avail_in == 0) {
+            z->avail_in = left_in > (uInt)-1 ? (uInt)-1 : (uInt)left_in;
+            left_in -= z->avail_in;
+        }
+        err = inflate(z, Z_NO_FLUSH);
+    } while (err == Z_OK);
+    *dst_len = z->total_out;
+    if (err == Z_STREAM_END) return Z_OK;
+    // Output space left over means the input ended early
+    if (err == Z_NEED_DICT || (err == Z_BUF_ERROR && left_out + z->avail_out > 0)) return Z_DATA_ERROR;
+    return err;
+}
+
+static inline void bufpool_report(const char* who) {
+    printf("%s: buffer pool: %ld buffers handed out, %ld allocations on the hot path "
+           "(%ld buffers, %.1f MB reserved and pre-faulted; %ld depot refills).\n",
+           who, atomic_load(&bufpool.gets), atomic_load(&bufpool.hot_allocations),
+           atomic_load(&bufpool.reserved), atomic_load(&bufpool.reserved_bytes) / 1e6,
+           atomic_load(&bufpool.refills));
+}
+
+// Frees the depot and this thread's cache and zlib streams. Buffers still
+// handed out are not freed.
+static inline void bufpool_destroy(void) {
+    for (int cls = 0; cls < BUFPOOL_CLASSES; cls++) {
+        bufpool_spill(cls, BUFPOOL_CACHE);
+        while (bufpool.depot[cls] != NULL) {
+            BufHeader* h = bufpool.depot[cls];
+            bufpool.depot[cls] = h->next;
+            MPI_Free_mem(h);
+        }
+        bufpool.depot_n[cls] = 0;
+    }
+    if (bufpool_zip.deflate_ready) deflateEnd(&bufpool_zip.deflate);
+    if (bufpool_zip.inflate_ready) inflateEnd(&bufpool_zip.inflate);
+    bufpool_zip.deflate_ready = bufpool_zip.inflate_ready = 0;
+    lock_destroy(&bufpool.lock);
+}
+
+#endif // BUFPOOL_H
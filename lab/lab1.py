@@ -1,147 +1,269 @@
-import socket
-import ssl
-import threading
-import psutil
-import time
-
-# Function to create an SSL context for secure communication
-# - For the master node: Loads server certificate and key
-# - For the slave node: Disables hostname verification for testing purposes
-def create_ssl_context(server=True):
-    if server:
-        context = ssl.create_default_context(ssl.Purpose.CLIENT_AUTH)
-        context.load_cert_chain(certfile="server.crt", keyfile="server.key")
-    else:
-        context = ssl.create_default_context(ssl.Purpose.SERVER_AUTH)
-        context.check_hostname = False  # Disable hostname verification
-        context.verify_mode = ssl.CERT_NONE  # Disable certificate verification (for testing)
-    return context
-
-# Master Node Class
-class MasterNode:
-    def __init__(self, host, port):
-        self.host = host
-        self.port = port
-        self.slaves = {}  # Dictionary to track connected slaves and last heartbeat time
-        self.lock = threading.Lock()  # Mutex lock for thread safety
-
-    def start(self):
-        """Starts the master node, listens for incoming connections, and handles slaves."""
-        context = create_ssl_context(server=True)
-        with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as server_socket:
-            server_socket.bind((self.host, self.port))
-            server_socket.listen(5)  # Listen for up to 5 connections
-            print(f"Master Node listening on {self.host}:{self.port}")
-
-            with context.wrap_socket(server_socket, server_side=True) as secure_socket:
-                while True:
-                    client_socket, addr = secure_socket.accept()
-                    print(f"Slave connected: {addr}")
-                    threading.Thread(target=self.handle_slave, args=(client_socket, addr)).start()
-
-    def handle_slave(self, client_socket, addr):
-        """Handles communication with a connected slave node."""
-        with client_socket:
-            while True:
-                try:
-                    data = client_socket.recv(1024).decode()
-                    if not data:
-                        break
-
-                    if data.startswith("HEARTBEAT"):
-                        # Update last heartbeat time for the slave
-                        with self.lock:
-                            self.slaves[addr] = time.time()
-                        print(f"Heartbeat received from {addr}")
-
-                    elif data.startswith("RESOURCE"):
-                        # Handle resource data received from the slave
-                        resource_data = data.split(" ", 1)[1]
-                        print(f"Resource data from {addr}: {resource_data}")
-                except (ConnectionResetError, ssl.SSLError):
-                    print(f"Connection lost with {addr}")
-                    break
-
-        # Remove the slave from the tracking list upon disconnection
-        with self.lock:
-            if addr in self.slaves:
-                del self.slaves[addr]
-
-    def monitor_slaves(self):
-        """Monitors slaves to check for inactive or unresponsive nodes."""
-        while True:
-            with self.lock:
-                now = time.time()
-                for addr, last_heartbeat in list(self.slaves.items()):
-                    if now - last_heartbeat > 10:  # If no heartbeat for 10 seconds, mark as unresponsive
-                        print(f"Slave {addr} is unresponsive")
-                        del self.slaves[addr]
-            time.sleep(5)  # Check every 5 seconds
-
-# Slave Node Class
-class SlaveNode:
-    def __init__(self, master_host, master_port):
-        self.master_host = master_host
-        self.master_port = master_port
-
-    def start(self):
-        """Connects to the master node and sends periodic heartbeats and resource status."""
-        context = create_ssl_context(server=False)
-        with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as slave_socket:
-            with context.wrap_socket(slave_socket, server_hostname=self.master_host) as secure_socket:
-                secure_socket.connect((self.master_host, self.master_port))
-
-                # Start separate threads for sending heartbeat and resource data
-                threading.Thread(target=self.send_heartbeat, args=(secure_socket,), daemon=True).start()
-                threading.Thread(target=self.send_resource_status, args=(secure_socket,), daemon=True).start()
-
-                # Keep the connection alive
-                while True:
-                    try:
-                        time.sleep(1)
-                    except KeyboardInterrupt:
-                        print("Slave shutting down...")
-                        break
-
-    def send_heartbeat(self, secure_socket):
-        """Sends a heartbeat message to the master node every 5 seconds."""
-        while True:
-            try:
-                secure_socket.sendall(b"HEARTBEAT")
-                time.sleep(5)
-            except (ssl.SSLError, BrokenPipeError):
-                print("Error sending heartbeat. Reconnecting...")
-                break
-
-    def send_resource_status(self, secure_socket):
-        """Sends CPU and memory usage data to the master node every 10 seconds."""
-        while True:
-            try:
-                cpu = psutil.cpu_percent()
-                memory = psutil.virtual_memory().percent
-                resource_data = f"CPU: {cpu}%, Memory: {memory}%"
-                secure_socket.sendall(f"RESOURCE {resource_data}".encode())
-                time.sleep(10)
-            except (ssl.SSLError, BrokenPipeError):
-                print("Error sending resource status. Reconnecting...")
-                break
-
-# Main Execution
-if __name__ == "__main__":
-    import sys
-
-    if len(sys.argv) < 2:
-        print("Usage: python script.py [master|slave]")
-        sys.exit(1)
-
-    if sys.argv[1] == "master":
-        master = MasterNode("127.0.0.1", 8000)  # Bind master node to all interfaces on port 8000
-        threading.Thread(target=master.monitor_slaves, daemon=True).start()
-        master.start()
-
-    elif sys.argv[1] == "slave":
-        slave = SlaveNode("127.0.0.1", 8000)  # Connect to master node on localhost
-        slave.start()
-
-    else:
-        print("Invalid argument. Use 'master' or 'slave'.")
+import random
+import socket
+import ssl
+import threading
+import time
+from telemetry import (TelemetryEncoder, TelemetryReader, NodeState, ProtocolError,
+                       MAX_THREADS, sample_resources)
+from server_core import Handler, ServerCore
+
+# Slave reconnect backoff: the delay doubles after every failed attempt
+RECONNECT_MIN = 0.5  # seconds
+RECONNECT_MAX = 30.0  # seconds
+
+# Function to create an SSL context for secure communication
+# - For the master node: Loads server certificate and key
+# - For the slave node: Disables hostname verification for testing purposes
+# Both sides use TLS 1.3; the master hands out session tickets so a slave
+# that reconnects can resume its session instead of doing a full handshake.
+def create_ssl_context(server=True):
+    if server:
+        context = ssl.create_default_context(ssl.Purpose.CLIENT_AUTH)
+        context.load_cert_chain(certfile="server.crt", keyfile="server.key")
+        context.num_tickets = 2  # TLS 1.3 session tickets sent after each handshake
+    else:
+        context = ssl.create_default_context(ssl.Purpose.SERVER_AUTH)
+        context.check_hostname = False  # Disable hostname verification
+        context.verify_mode = ssl.CERT_NONE  # Disable certificate verification (for testing)
+    context.minimum_version = ssl.TLSVersion.TLSv1_3
+    return context
+
+# One context per role and process: a context loads the certificate and keeps
+# the session ticket keys, so it must be shared by all connections
+_ssl_contexts = {}
+_ssl_contexts_lock = threading.Lock()
+
+def get_ssl_context(server=True):
+    with _ssl_contexts_lock:
+        if server not in _ssl_contexts:
+            _ssl_contexts[server] = create_ssl_context(server)
+        return _ssl_contexts[server]
+
+# Master Node Class
+class MasterNode:
+    def __init__(self, host, port):
+        self.host = host
+        self.port = port
+        self.slaves = {}  # Dictionary to track connected slaves: addr -> NodeState
+        self.lock = threading.Lock()  # Mutex lock for thread safety
+
+    def start(self):
+        """Starts the master node, listens for incoming connections, and handles slaves."""
+        context = get_ssl_context(server=True)
+        with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as server_socket:
+            server_socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+            server_socket.bind((self.host, self.port))
+            server_socket.listen(128)  # Many slaves may reconnect at once
+            print(f"Master Node listening on {self.host}:{self.port}")
+
+            while True:
+                # The TLS handshake runs in the slave's thread, not here, so
+                # one slow handshake does not hold up every other slave
+                client_socket, addr = server_socket.accept()
+                threading.Thread(target=self.handle_slave, args=(context, client_socket, addr),
+                                 daemon=True).start()
+
+    def handle_slave(self, context, client_socket, addr):
+        """Handles communication with a connected slave node."""
+        try:
+            client_socket = context.wrap_socket(client_socket, server_side=True)
+        except (ssl.SSLError, OSError) as e:
+            print(f"TLS handshake with {addr} failed: {e}")
+            client_socket.close()
+            return
+        print(f"Slave connected: {addr} "
+              f"({'resumed' if client_socket.session_reused else 'full'} TLS handshake)")
+
+        state = NodeState()
+        state.deadline = time.time() + 10  # until the first report arrives
+        reader = TelemetryReader(client_socket)
+        with self.lock:
+            self.slaves[addr] = state
+
+        with client_socket:
+            while True:
+                try:
+                    # Decodes every complete telemetry frame straight into 'state'
+                    frames = reader.read(state, time.time())
+                    if frames < 0:
+                        break
+                    if frames:
+                        self.mark_alive(addr, state)
+                except (OSError, ssl.SSLError):
+                    print(f"Connection lost with {addr}")
+                    break
+                except ProtocolError as e:
+                    print(f"Protocol error from {addr}: {e}")
+                    break
+
+        # Remove the slave from the tracking list upon disconnection
+        with self.lock:
+            if self.slaves.get(addr) is state:
+                del self.slaves[addr]
+
+    def mark_alive(self, addr, state):
+        """Re-registers a slave that reports again after being marked unresponsive."""
+        with self.lock:
+            if self.slaves.get(addr) is not state:
+                print(f"Slave {addr} is responsive again")
+                self.slaves[addr] = state
+
+    def monitor_slaves(self):
+        """Monitors slaves and prints their latest telemetry every 5 seconds."""
+        while True:
+            self.report_slaves()
+            time.sleep(5)  # Check every 5 seconds
+
+    def report_slaves(self):
+        with self.lock:
+            now = time.time()
+            for addr, state in list(self.slaves.items()):
+                # A slave announces when its next report is due; missing
+                # MISSED_REPORTS of them marks it as unresponsive
+                if now > state.deadline:
+                    print(f"Slave {addr} is unresponsive")
+                    del self.slaves[addr]
+                    continue
+                progress = " ".join(f"{p / 10:.0f}%" for p in state.progress[:state.n_threads])
+                print(f"Slave {addr}: CPU {state.cpu / 10:.1f}%, Memory {state.mem / 10:.1f}%, "
+                      f"net rx {state.rx_total} B tx {state.tx_total} B, "
+                      f"next report within {state.interval:.1f}s"
+                      + (f", progress {progress}" if progress else ""))
+
+# The same master on lab/server_core.py: every slave connection is served by
+# one event loop instead of its own thread, and "master-async N" runs N such
+# processes on the same port (SO_REUSEPORT), each tracking its own slaves.
+class MasterHandler(Handler):
+    def __init__(self, master):
+        self.master = master
+
+    def on_start(self, core):
+        core.call_every(5, self.master.report_slaves)
+
+    def on_connect(self, conn):
+        resumed = conn.transport.get_extra_info("ssl_object").session_reused
+        print(f"Slave connected: {conn.peer} ({'resumed' if resumed else 'full'} TLS handshake)")
+        state = NodeState()
+        state.deadline = time.time() + 10  # until the first report arrives
+        conn.state = (state, TelemetryReader(None))
+        with self.master.lock:
+            self.master.slaves[conn.peer] = state
+
+    def on_data(self, conn):
+        state, reader = conn.state
+        try:
+            # Decodes every complete telemetry frame straight into 'state'
+            if reader.feed(conn.inbuf, state, time.time()):
+                self.master.mark_alive(conn.peer, state)
+        except ProtocolError as e:
+            print(f"Protocol error from {conn.peer}: {e}")
+            conn.close()
+        conn.inbuf.clear()
+
+    def on_drain(self, conn):
+        conn.close()  # slaves reconnect with backoff, e.g. to the restarted master
+
+    def on_close(self, conn):
+        print(f"Connection lost with {conn.peer}")
+        with self.master.lock:
+            if self.master.slaves.get(conn.peer) is conn.state[0]:
+                del self.master.slaves[conn.peer]
+
+# Slave Node Class
+class SlaveNode:
+    def __init__(self, master_host, master_port):
+        self.master_host = master_host
+        self.master_port = master_port
+        self.encoder = TelemetryEncoder()
+        self.n_threads = 0  # worker threads that report progress
+        self.tls_session = None  # reused when reconnecting
+
+    def start(self):
+        """Keeps one connection to the master open and sends telemetry over it.
+
+        If the connection breaks, the slave reconnects with exponential backoff
+        (plus jitter, so a whole cluster does not reconnect in lockstep) and
+        resumes its TLS session, which skips the certificate exchange.
+        """
+        context = get_ssl_context(server=False)
+        delay = RECONNECT_MIN
+        try:
+            while True:
+                try:
+                    with socket.create_connection((self.master_host, self.master_port)) as raw:
+                        with context.wrap_socket(raw, server_hostname=self.master_host,
+                                                 session=self.tls_session) as secure_socket:
+                            self.collect_session_ticket(secure_socket)
+                            print(f"Connected to master "
+                                  f"({'resumed' if secure_socket.session_reused else 'full'} TLS handshake)")
+                            delay = RECONNECT_MIN
+                            self.encoder.restart()
+                            self.send_telemetry(secure_socket)  # returns when the connection breaks
+                except (OSError, ssl.SSLError) as e:
+                    print(f"Cannot reach master: {e}")
+
+                wait = random.uniform(delay / 2, delay)
+                print(f"Reconnecting in {wait:.1f}s...")
+                time.sleep(wait)
+                delay = min(delay * 2, RECONNECT_MAX)
+        except KeyboardInterrupt:
+            print("Slave shutting down...")
+
+    def collect_session_ticket(self, secure_socket):
+        """Keeps the TLS 1.3 session ticket for the next connection.
+
+        The master sends its tickets right after the handshake, but the client
+        only processes them when it reads from the socket; the slave never
+        receives data otherwise, so read once with a short timeout.
+        """
+        secure_socket.settimeout(0.2)
+        try:
+            secure_socket.recv(1)
+        except (socket.timeout, ssl.SSLWantReadError):
+            pass
+        finally:
+            secure_socket.settimeout(None)
+        self.tls_session = secure_socket.session
+
+    def set_progress(self, thread_id, fraction):
+        """Called by worker threads: report 'fraction' (0..1) of their work as done."""
+        if 0 <= thread_id < MAX_THREADS:
+            self.encoder.progress[thread_id] = int(max(0.0, min(1.0, fraction)) * 1000)
+            self.n_threads = max(self.n_threads, thread_id + 1)
+
+    def send_telemetry(self, secure_socket):
+        """Sends one binary frame per report; the rate adapts to how much changes."""
+        while True:
+            try:
+                cpu, memory, rx, tx = sample_resources()
+                secure_socket.sendall(self.encoder.encode(cpu, memory, rx, tx, self.n_threads))
+                time.sleep(self.encoder.interval)
+            except (ssl.SSLError, OSError):
+                print("Error sending telemetry.")
+                return
+
+# Main Execution
+if __name__ == "__main__":
+    import sys
+
+    if len(sys.argv) < 2:
+        print("Usage: python script.py [master|master-async [shards]|slave]")
+        sys.exit(1)
+
+    if sys.argv[1] == "master":
+        master = MasterNode("127.0.0.1", 8000)  # Bind master node to all interfaces on port 8000
+        threading.Thread(target=master.monitor_slaves, daemon=True).start()
+        master.start()
+
+    elif sys.argv[1] == "master-async":
+        master = MasterNode("127.0.0.1", 8000)
+        shards = int(sys.argv[2]) if len(sys.argv) > 2 else 1
+        ServerCore(lambda: MasterHandler(master), master.host, master.port, shards=shards,
+                   ssl_context=get_ssl_context(server=True), name="Master Node").run()
+
+    elif sys.argv[1] == "slave":
+        slave = SlaveNode("127.0.0.1", 8000)  # Connect to master node on localhost
+        slave.start()
+
+    else:
+        print("Invalid argument. Use 'master', 'master-async' or 'slave'.")
@@ -2,31 +2,772 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
 #include <zlib.h>
 #include <unistd.h> // For sleep
+#include "bufpool.h" // Reused message buffers and zlib streams (5.3)
+#include "crc32c.h"  // Piece checksums (5.7)
 
-#define DATA_SIZE 1000000
-#define CHUNK_SIZE 100000
+// Sizes are longs, so that -DDATA_SIZE=... -DCHUNK_SIZE=... can make a chunk
+// larger than 2 GB (5.6)
+#ifndef DATA_SIZE
+#define DATA_SIZE 1000000L
+#endif
+#ifndef CHUNK_SIZE
+#define CHUNK_SIZE 100000L
+#endif
+#define NUM_CHUNKS (DATA_SIZE / CHUNK_SIZE)
 #define HEARTBEAT_TIMEOUT 5  // seconds
+#define VALUE_RANGE 1000000  // Input values repeat, so that process_data() cannot overflow
 
-// Function to simulate data processing at slave nodes
-void process_data(int rank, int data[]) {
-    printf("Slave %d processing data...\n", rank);
+// A chunk is CHUNK_BYTES bytes
+#define CHUNK_BYTES (CHUNK_SIZE * sizeof(int))
+
+// 5.5 Link probe (tag 1) and the smallest frame size threshold
+#define TAG_PROBE 1
+#define PROBE_SMALL 8
+#define PROBE_MIN (64L << 10)    // 5.6 Bandwidth is measured from 64 KB...
+#define PROBE_MAX (16L << 20)    // ...to 16 MB messages
+#define FRAME_MIN 4096
+
+// 5.7 A receiver lists the pieces that failed their check (tag 2); an empty
+// list from the master accepts a slave's result
+#define TAG_RESEND 2
+
+// 5.6 MPI-4 counts are MPI_Count (64 bits): a message of any size is one call.
+// Before MPI-4 they are int, so longer messages travel as segments.
+#if MPI_VERSION >= 4
+#define LARGE_COUNT 1
+#else
+#define LARGE_COUNT 0
+#endif
+
+// 5.4 How chunks travel (LAB2_TRANSFER):
+//   zlib      compressed into a byte buffer (the default)
+//   copy      uncompressed, copied into a byte buffer and out again
+//   zerocopy  MPI reads the chunk straight from full_data and the slave's
+//             data[], and writes it straight into data[] and results[]
+enum { TRANSFER_ZLIB, TRANSFER_COPY, TRANSFER_ZEROCOPY };
+static const char* const transfer_names[] = { "zlib", "copy", "zerocopy" };
+
+// 5.4 Where a chunk lives in full_data (LAB2_BLOCK): with 0, chunk c is the
+// elements [c * CHUNK_SIZE, (c + 1) * CHUNK_SIZE). With B > 0, blocks of B
+// elements are dealt to the chunks round robin (block-cyclic), so chunk c is
+// every NUM_CHUNKS-th block from block c.
+static int block = 0;
+
+// 5.6 Without large counts, a byte message of segment_bytes or more is sent
+// as segments of exactly segment_bytes and a shorter last one (possibly
+// empty), all in flight at once; the receiver takes segments until a short
+// one arrives. A zerocopy chunk goes as segments of segment_elems elements,
+// described inside full_data by segment_type (and tail_type for the rest).
+static long segment_bytes = LONG_MAX;
+static long segment_elems = CHUNK_SIZE;
+static MPI_Datatype segment_type = MPI_DATATYPE_NULL, tail_type = MPI_DATATYPE_NULL;
+
+// 5.5 In the zlib and copy modes a chunk travels as pieces of piece_size
+// elements (LAB2_PIECE), packed into frames. A frame is a uint32_t piece
+// count followed by, for each piece, a PieceHeader and its payload.
+static long piece_size = CHUNK_SIZE;
+static long num_pieces = 1;
+static int coalesce = 1;   // LAB2_COALESCE=0 sends every piece on its own
+
+typedef struct {
+    uint32_t piece;    // index of the piece within its chunk
+    uint32_t crc;      // CRC32C of the piece before compression (5.7)
+    uint64_t bytes;    // payload bytes that follow
+} PieceHeader;
+
+// 5.7 Every piece carries a CRC32C, checked by the receiver (LAB2_CRC=0 turns
+// the check off). LAB2_CORRUPT=N flips a bit in every N-th piece received,
+// before the check, to stand in for a bad link.
+static int check_crc = 1;
+static long corrupt_every = 0;
+static long pieces_in = 0, pieces_corrupted = 0, pieces_bad = 0, pieces_resent = 0;
+static double crc_time = 0, crc_bytes = 0;
+
+// 5.7 What the receiver of a chunk has: the pieces that passed their check
+// so far, and those of the last frame that passed it (arrived) or failed it
+// (bad). In zerocopy mode the whole chunk is piece 0.
+typedef struct {
+    uint8_t* good;
+    long num_good;
+    uint32_t* arrived;
+    long num_arrived;
+    uint32_t* bad;
+    long num_bad;
+} Receipt;
 
-    for (int i = 0; i < CHUNK_SIZE; i++) {
+// A frame sent and not completed yet: one request per segment (5.6)
+typedef struct {
+    unsigned char* buf;
+    int num_requests;
+    MPI_Request* requests;
+} Outgoing;
+
+// 5.5 Packs the pieces for one destination into frames. A frame is sent once
+// it holds 'threshold' bytes, or when its sender runs out of pieces: at the
+// end of a chunk, or (on a slave waiting for input) once the frame's first
+// piece has waited 'max_delay' seconds. Sends stay in flight: the master never
+// waits for a slave to take a frame, and a slave never blocks while the master
+// is still sending to it.
+typedef struct {
+    int dest;
+    int mode;
+    size_t threshold;
+    double max_delay;
+    size_t capacity;             // size of every frame buffer, on both sides
+    unsigned char* frame;        // frame being filled, or NULL
+    size_t bytes;
+    uint32_t pieces;
+    double first_added;
+    Outgoing* in_flight;         // sends not completed yet
+    MPI_Request* requests;       // segments_of(capacity) for each of them
+    long num_in_flight;
+    long messages, pieces_sent, bytes_sent;
+} Coalescer;
+
+// Waits for a receive to complete; returns 0 to give up on it
+typedef int (*WaitFn)(MPI_Request* request, MPI_Status* status, void* context);
+
+// 5.4 Time spent copying (or compressing) chunks into and out of messages
+static double pack_time = 0, unpack_time = 0;
+static int chunks_sent = 0;
+static long frames_received = 0;
+
+// Function to simulate data processing at slave nodes
+void process_data(int data[], long count, int rank) {
+    for (long i = 0; i < count; i++) {
         data[i] = data[i] * rank;
     }
+}
+
+int transfer_mode(void) {
+    const char* env = getenv("LAB2_TRANSFER");
+    for (int m = TRANSFER_ZLIB; m <= TRANSFER_ZEROCOPY; m++) {
+        if (env != NULL && strcmp(env, transfer_names[m]) == 0) return m;
+    }
+    return TRANSFER_ZLIB;
+}
+
+void layout_init(void) {
+    const char* env = getenv("LAB2_BLOCK");
+    block = env != NULL ? atoi(env) : 0;
+    if (block < 0 || (block > 0 && CHUNK_SIZE % block != 0)) {
+        printf("LAB2_BLOCK must divide %ld; using contiguous chunks.\n", CHUNK_SIZE);
+        block = 0;
+    }
+
+    env = getenv("LAB2_PIECE");
+    piece_size = env != NULL ? atol(env) : CHUNK_SIZE;
+    if (piece_size <= 0 || CHUNK_SIZE % piece_size != 0) {
+        printf("LAB2_PIECE must divide %ld; sending whole chunks.\n", CHUNK_SIZE);
+        piece_size = CHUNK_SIZE;
+    }
+    num_pieces = CHUNK_SIZE / piece_size;
+    env = getenv("LAB2_COALESCE");
+    coalesce = env == NULL || atoi(env) != 0;
+
+    env = getenv("LAB2_CRC");
+    check_crc = env == NULL || atoi(env) != 0;
+    env = getenv("LAB2_CORRUPT");
+    corrupt_every = env != NULL ? atol(env) : 0;
+    if (corrupt_every < 0) corrupt_every = 0;
+    if (corrupt_every == 1) {
+        printf("LAB2_CORRUPT=1 would corrupt every piece sent again; using 2.\n");
+        corrupt_every = 2;
+    }
+}
+
+// Element k of a chunk in full_data (or in results, which has the same layout)
+int* chunk_element(int full[], int chunk, long k) {
+    if (block == 0) return &full[chunk * CHUNK_SIZE + k];
+    return &full[((k / block) * NUM_CHUNKS + chunk) * block + k % block];
+}
+
+// Copies a chunk out of full_data into a contiguous buffer, and back
+void gather_chunk(const int full[], int chunk, int dst[]) {
+    if (block == 0) {
+        memcpy(dst, &full[chunk * CHUNK_SIZE], CHUNK_BYTES);
+        return;
+    }
+    for (long b = 0; b < CHUNK_SIZE / block; b++) {
+        memcpy(&dst[b * block], &full[(b * NUM_CHUNKS + chunk) * block], block * sizeof(int));
+    }
+}
+
+void scatter_chunk(int full[], int chunk, const int src[]) {
+    if (block == 0) {
+        memcpy(&full[chunk * CHUNK_SIZE], src, CHUNK_BYTES);
+        return;
+    }
+    for (long b = 0; b < CHUNK_SIZE / block; b++) {
+        memcpy(&full[(b * NUM_CHUNKS + chunk) * block], &src[b * block], block * sizeof(int));
+    }
+}
+
+// Counts the elements of a chunk that are not 'factor' times the input
+long check_chunk(int full_data[], int results[], int chunk, int factor) {
+    long bad = 0;
+    for (long k = 0; k < CHUNK_SIZE; k++) {
+        bad += *chunk_element(results, chunk, k) != *chunk_element(full_data, chunk, k) * factor;
+    }
+    return bad;
+}
+
+// 5.7 CRC32C of a piece, copied to dst on the way unless dst is NULL: on the
+// copy paths the check shares the copy's pass over the data
+uint32_t piece_crc(void* dst, const void* src, size_t bytes) {
+    double t0 = MPI_Wtime();
+    uint32_t crc = dst != NULL ? crc32c_copy(0, dst, src, bytes) : crc32c(0, src, bytes);
+    crc_time += MPI_Wtime() - t0;
+    crc_bytes += bytes;
+    return crc;
+}
+
+// 5.7 CRC32C of a chunk in place in full_data (or results), in chunk order
+uint32_t chunk_crc(const int full[], int chunk) {
+    double t0 = MPI_Wtime();
+    uint32_t crc = 0;
+    if (block == 0) {
+        crc = crc32c(0, &full[chunk * CHUNK_SIZE], CHUNK_BYTES);
+    } else {
+        for (long b = 0; b < CHUNK_SIZE / block; b++) {
+            crc = crc32c(crc, &full[(b * NUM_CHUNKS + chunk) * block], block * sizeof(int));
+        }
+    }
+    crc_time += MPI_Wtime() - t0;
+    crc_bytes += CHUNK_BYTES;
+    return crc;
+}
+
+// 5.7 Called for every piece received: flips a bit in every LAB2_CORRUPT-th
+void maybe_corrupt(unsigned char* byte) {
+    if (corrupt_every > 0 && ++pieces_in % corrupt_every == 0) {
+        *byte ^= 0x10;
+        pieces_corrupted++;
+    }
+}
+
+void receipt_init(Receipt* r) {
+    r->good = calloc(num_pieces, sizeof(uint8_t));
+    r->arrived = malloc(num_pieces * sizeof(uint32_t));
+    r->bad = malloc(num_pieces * sizeof(uint32_t));
+    r->num_good = r->num_arrived = r->num_bad = 0;
+}
+
+void receipt_free(Receipt* r) {
+    free(r->good);
+    free(r->arrived);
+    free(r->bad);
+}
+
+// 5.7 Asks 'peer' to send the pieces that failed their check again
+void request_resend(int peer, const Receipt* r) {
+    pieces_bad += r->num_bad;
+    MPI_Send(r->bad, r->num_bad, MPI_UINT32_T, peer, TAG_RESEND, MPI_COMM_WORLD);
+}
+
+void report_integrity(const char* who) {
+    printf("%s: CRC32C (%s): %.1f MB checksummed in %.2f ms (%.2f GB/s); %ld pieces corrupted, "
+           "%ld failed their check, %ld sent again.\n", who, check_crc ? crc32c_impl : "off",
+           crc_bytes / 1e6, 1e3 * crc_time, crc_time > 0 ? crc_bytes / crc_time / 1e9 : 0.0,
+           pieces_corrupted, pieces_bad, pieces_resent);
+}
+
+// 6.2 Bytes of a chunk as MPI packs it (MPI_Pack_size counts in int)
+long chunk_pack_size(void) {
+    int bytes_sent;
+    if (CHUNK_SIZE > INT_MAX / (long)sizeof(int)) return CHUNK_BYTES;
+    MPI_Pack_size(CHUNK_SIZE, MPI_INT, MPI_COMM_WORLD, &bytes_sent);
+    return bytes_sent;
+}
+
+// 5.6 'count' elements of a chunk as one datatype: contiguous, or a vector of
+// blocks inside full_data. 'count' is a multiple of the block size.
+MPI_Datatype chunk_part_type(long count) {
+    MPI_Datatype type;
+#if LARGE_COUNT
+    if (block == 0) MPI_Type_contiguous_c(count, MPI_INT, &type);
+    else MPI_Type_vector_c(count / block, block, (MPI_Count)block * NUM_CHUNKS, MPI_INT, &type);
+#else
+    if (block == 0) MPI_Type_contiguous((int)count, MPI_INT, &type);
+    else MPI_Type_vector((int)(count / block), block, block * NUM_CHUNKS, MPI_INT, &type);
+#endif
+    MPI_Type_commit(&type);
+    return type;
+}
+
+// 5.6 Builds the zerocopy segment types once segment_bytes is known
+void segments_init(void) {
+    if (!LARGE_COUNT) {
+        segment_elems = segment_bytes / sizeof(int);
+        if (block > 0) segment_elems = segment_elems < block ? block : segment_elems / block * block;
+        if (segment_elems > CHUNK_SIZE) segment_elems = CHUNK_SIZE;
+    }
+    segment_type = chunk_part_type(segment_elems);
+    if (CHUNK_SIZE % segment_elems != 0) tail_type = chunk_part_type(CHUNK_SIZE % segment_elems);
+}
+
+long chunk_segments(void) {
+    return (CHUNK_SIZE + segment_elems - 1) / segment_elems;
+}
+
+// Segments of a byte message of 'bytes' bytes, the short last one included
+long segments_of(long bytes) {
+    return LARGE_COUNT ? 1 : bytes / segment_bytes + 1;
+}
+
+// 5.6 Posts a send or receive of 'count' ints (more than INT_MAX only with large counts)
+void post_ints(int buf[], long count, int peer, int send, MPI_Request* request) {
+#if LARGE_COUNT
+    if (send) MPI_Isend_c(buf, count, MPI_INT, peer, 0, MPI_COMM_WORLD, request);
+    else MPI_Irecv_c(buf, count, MPI_INT, peer, 0, MPI_COMM_WORLD, request);
+#else
+    if (send) MPI_Isend(buf, (int)count, MPI_INT, peer, 0, MPI_COMM_WORLD, request);
+    else MPI_Irecv(buf, (int)count, MPI_INT, peer, 0, MPI_COMM_WORLD, request);
+#endif
+}
+
+// 5.6 Sends a byte message as one message or as segments; returns the number
+// of requests stored in requests[]
+int isend_bytes(const unsigned char* buf, long bytes, int dest, MPI_Request requests[]) {
+#if LARGE_COUNT
+    MPI_Isend_c(buf, bytes, MPI_UNSIGNED_CHAR, dest, 0, MPI_COMM_WORLD, &requests[0]);
+    return 1;
+#else
+    int n = 0;
+    for (long offset = 0; ; offset += segment_bytes) {
+        long length = bytes - offset < segment_bytes ? bytes - offset : segment_bytes;
+        MPI_Isend(buf + offset, (int)length, MPI_UNSIGNED_CHAR, dest, 0, MPI_COMM_WORLD, &requests[n++]);
+        if (length < segment_bytes) return n;
+    }
+#endif
+}
+
+// 5.6 Receives a message sent by isend_bytes() into buf, which holds
+// 'capacity' bytes. wait() waits for every part. Returns the message size, or
+// -1 if wait() gave up.
+long recv_bytes(unsigned char* buf, long capacity, int source, WaitFn wait, void* context) {
+    MPI_Request request;
+    MPI_Status status;
+#if LARGE_COUNT
+    MPI_Irecv_c(buf, capacity, MPI_UNSIGNED_CHAR, source, 0, MPI_COMM_WORLD, &request);
+    if (!wait(&request, &status, context)) return -1;
+    MPI_Count received;
+    MPI_Get_count_c(&status, MPI_UNSIGNED_CHAR, &received);
+    return received;
+#else
+    long offset = 0;
+    for (;;) {
+        long room = capacity - offset < segment_bytes ? capacity - offset : segment_bytes;
+        MPI_Irecv(buf + offset, (int)room, MPI_UNSIGNED_CHAR, source, 0, MPI_COMM_WORLD, &request);
+        if (!wait(&request, &status, context)) return -1;
+        int received;
+        MPI_Get_count(&status, MPI_UNSIGNED_CHAR, &received);
+        offset += received;
+        if (received < segment_bytes) return offset;
+    }
+#endif
+}
+
+// 5.5 One-way time of a message of 'bytes', averaged over 'rounds' round trips
+double ping_pong(int peer, int leader, char* buf, int bytes, int rounds) {
+    double t0 = 0;
+    for (int r = -1; r < rounds; r++) { // Round -1 sets up the connection
+        if (r == 0) t0 = MPI_Wtime();
+        if (leader) {
+            MPI_Send(buf, bytes, MPI_CHAR, peer, TAG_PROBE, MPI_COMM_WORLD);
+            MPI_Recv(buf, bytes, MPI_CHAR, peer, TAG_PROBE, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        } else {
+            MPI_Recv(buf, bytes, MPI_CHAR, peer, TAG_PROBE, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            MPI_Send(buf, bytes, MPI_CHAR, peer, TAG_PROBE, MPI_COMM_WORLD);
+        }
+    }
+    return (MPI_Wtime() - t0) / (2.0 * rounds);
+}
+
+// 5.5 Measures the latency of the link to 'peer', and (5.6) its bandwidth
+// with messages from PROBE_MIN to PROBE_MAX bytes. *segment is the smallest
+// of those sizes that reaches 90% of the best bandwidth. Both ends call it;
+// the leader (the master) uses the results.
+void probe_link(int peer, int leader, double* latency, double* bandwidth, long* segment) {
+    char* buf = calloc(PROBE_MAX, 1);
+    double rates[16];
+    int n = 0;
+    *latency = ping_pong(peer, leader, buf, PROBE_SMALL, 100);
+    *bandwidth = 0;
+    for (long bytes = PROBE_MIN; bytes <= PROBE_MAX; bytes *= 4, n++) {
+        rates[n] = bytes / ping_pong(peer, leader, buf, bytes, 2 + PROBE_MAX / 2 / bytes);
+        if (rates[n] > *bandwidth) *bandwidth = rates[n];
+    }
+    *segment = PROBE_MAX;
+    for (int i = n - 1; i >= 0; i--) {
+        if (rates[i] >= 0.9 * *bandwidth) *segment = PROBE_MIN << (2 * i);
+    }
+    free(buf);
+}
+
+// Largest payload of one piece in a frame
+size_t piece_bound(int mode) {
+    size_t bytes = piece_size * sizeof(int);
+    return mode == TRANSFER_ZLIB ? compressBound(bytes) : bytes;
+}
+
+// 5.3 Frames of one chunk that can be in flight at once: the full ones, plus a
+// partial one for every frame the slave receives
+int frames_per_chunk(size_t threshold) {
+    size_t frames = threshold > 0 ? 2 * (CHUNK_BYTES / threshold + 1) : (size_t)num_pieces;
+    return frames < (size_t)num_pieces ? (int)frames : (int)num_pieces;
+}
 
-    printf("Slave %d processing complete.\n", rank);
+void coalescer_init(Coalescer* c, int dest, int mode, size_t threshold, double max_delay,
+                    size_t capacity) {
+    memset(c, 0, sizeof(*c));
+    c->dest = dest;
+    c->mode = mode;
+    c->threshold = threshold;
+    c->max_delay = max_delay;
+    c->capacity = capacity;
+    // Every frame holds a piece or more; each has its own slice of requests
+    long segments = segments_of(capacity);
+    c->in_flight = malloc(num_pieces * sizeof(Outgoing));
+    c->requests = malloc(num_pieces * segments * sizeof(MPI_Request));
+    for (long i = 0; i < num_pieces; i++) c->in_flight[i].requests = &c->requests[i * segments];
+}
+
+// Waits for every send in flight and returns the buffers to the pool
+void coalescer_drain(Coalescer* c) {
+    for (long i = 0; i < c->num_in_flight; i++) {
+        MPI_Waitall(c->in_flight[i].num_requests, c->in_flight[i].requests, MPI_STATUSES_IGNORE);
+        bufpool_put(c->in_flight[i].buf);
+    }
+    c->num_in_flight = 0;
+}
+
+void coalescer_flush(Coalescer* c) {
+    if (c->frame == NULL) return;
+    memcpy(c->frame, &c->pieces, sizeof(uint32_t));
+    if (c->num_in_flight == num_pieces) coalescer_drain(c); // A second chunk to the same slave
+    Outgoing* o = &c->in_flight[c->num_in_flight++];
+    o->buf = c->frame; // Back to the pool once the send is done
+    o->num_requests = isend_bytes(c->frame, c->bytes, c->dest, o->requests);
+    c->messages++;
+    c->pieces_sent += c->pieces;
+    c->bytes_sent += c->bytes;
+    c->frame = NULL;
+}
+
+// Compresses (or copies) one piece into the current frame
+void coalescer_add(Coalescer* c, uint32_t piece, const int src[]) {
+    double t0 = MPI_Wtime();
+    if (c->frame == NULL) {
+        c->frame = bufpool_get(c->capacity);
+        c->bytes = sizeof(uint32_t);
+        c->pieces = 0;
+        c->first_added = t0;
+    }
+    PieceHeader header = { piece, 0, 0 };
+    unsigned char* payload = c->frame + c->bytes + sizeof(header);
+    uLongf payload_size = piece_bound(c->mode); // Size of dest buffer
+    if (c->mode == TRANSFER_ZLIB) {
+        // 5.7 The CRC reads the piece just before deflate does, while it is in cache
+        if (check_crc) header.crc = piece_crc(NULL, src, piece_size * sizeof(int));
+        int err = bufpool_compress(payload, &payload_size, (const Bytef *)src, piece_size * sizeof(int));
+        if (err != Z_OK) {
+            int rank;
+            MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+            fprintf(stderr, "Node %d: compressing piece %u failed (zlib error %d).\n", rank, piece, err);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    } else if (check_crc) {
+        header.crc = piece_crc(payload, src, payload_size);
+    } else {
+        memcpy(payload, src, payload_size);
+    }
+    header.bytes = payload_size;
+    memcpy(c->frame + c->bytes, &header, sizeof(header)); // Frames are not aligned
+    c->bytes += sizeof(header) + payload_size;
+    c->pieces++;
+    pack_time += MPI_Wtime() - t0;
+
+    if (c->bytes - sizeof(uint32_t) >= c->threshold) coalescer_flush(c);
+}
+
+// Sends a frame that has waited too long (a slave waiting for input), and
+// returns the buffers of completed sends to the pool
+void coalescer_progress(Coalescer* c) {
+    if (c->frame != NULL && MPI_Wtime() - c->first_added >= c->max_delay) coalescer_flush(c);
+    for (long i = 0; i < c->num_in_flight; ) {
+        Outgoing* o = &c->in_flight[i];
+        int done;
+        MPI_Testall(o->num_requests, o->requests, &done, MPI_STATUSES_IGNORE);
+        if (!done) {
+            i++;
+            continue;
+        }
+        bufpool_put(o->buf);
+        // Swap with the last one, which keeps every slot's slice of requests
+        Outgoing last = c->in_flight[--c->num_in_flight];
+        c->in_flight[c->num_in_flight] = *o;
+        *o = last;
+    }
+}
+
+void coalescer_finish(Coalescer* c) {
+    coalescer_flush(c);
+    coalescer_drain(c);
+    free(c->in_flight);
+    free(c->requests);
+}
+
+// Unpacks the pieces of a frame into their places in dst[] (a contiguous
+// chunk). 5.7 Each piece is checked: its size, zlib's return code and its
+// CRC32C. Those that pass are recorded in r->good and r->arrived, the others
+// in r->bad; a piece that has already passed is skipped. Returns
+// r->num_arrived.
+long unpack_frame(unsigned char* frame, long size, int dst[], int mode, Receipt* r) {
+    double t0 = MPI_Wtime();
+    size_t piece_bytes = piece_size * sizeof(int);
+    uint32_t count;
+    memcpy(&count, frame, sizeof(count));
+    size_t offset = sizeof(count);
+    r->num_arrived = r->num_bad = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        PieceHeader header;
+        if (offset + sizeof(header) <= (size_t)size) memcpy(&header, frame + offset, sizeof(header));
+        if (offset + sizeof(header) > (size_t)size || header.piece >= (uint64_t)num_pieces ||
+            header.bytes > size - offset - sizeof(header)) {
+            // A damaged frame: what follows is lost, so ask for every piece still missing
+            r->num_bad = 0;
+            for (long p = 0; p < num_pieces; p++) {
+                if (!r->good[p]) r->bad[r->num_bad++] = p;
+            }
+            break;
+        }
+        offset += sizeof(header);
+        unsigned char* payload = frame + offset;
+        offset += header.bytes;
+        if (r->good[header.piece]) continue; // Sent again, and the first copy was fine
+        if (header.bytes > 0) maybe_corrupt(&payload[header.bytes / 2]);
+
+        int* piece = &dst[header.piece * piece_size];
+        int ok;
+        if (mode == TRANSFER_ZLIB) {
+            uLongf uncompressed_size = piece_bytes;
+            ok = bufpool_uncompress((Bytef *)piece, &uncompressed_size, payload, header.bytes) == Z_OK &&
+                 uncompressed_size == piece_bytes;
+            if (ok && check_crc) ok = piece_crc(NULL, piece, piece_bytes) == header.crc;
+        } else {
+            ok = header.bytes == piece_bytes;
+            if (ok && check_crc) ok = piece_crc(piece, payload, piece_bytes) == header.crc;
+            else if (ok) memcpy(piece, payload, piece_bytes);
+        }
+        if (ok) {
+            r->good[header.piece] = 1;
+            r->num_good++;
+            r->arrived[r->num_arrived++] = header.piece;
+        } else {
+            r->bad[r->num_bad++] = header.piece;
+        }
+    }
+    unpack_time += MPI_Wtime() - t0;
+    return r->num_arrived;
+}
+
+// Master: sends the pieces list[0..n-1] of chunk 'chunk' of full_data to
+// out->dest, or all of them if list is NULL (5.7)
+void send_pieces(int full_data[], int chunk, Coalescer* out, const uint32_t list[], long n) {
+    if (list != NULL) pieces_resent += n;
+
+    if (out->mode == TRANSFER_ZEROCOPY) {
+        // 5.4 Straight from full_data, whatever the layout: no buffer, no copy
+        // 5.6 One segment at a time if the chunk is too large for one message
+        // 5.7 followed by the chunk's CRC32C
+        long segments = chunk_segments();
+        MPI_Request requests[segments + 1];
+        for (long s = 0; s < segments; s++) {
+            MPI_Datatype type = (s + 1) * segment_elems <= CHUNK_SIZE ? segment_type : tail_type;
+            MPI_Isend(chunk_element(full_data, chunk, s * segment_elems), 1, type, out->dest, 0,
+                      MPI_COMM_WORLD, &requests[s]);
+        }
+        uint32_t crc = check_crc ? chunk_crc(full_data, chunk) : 0;
+        if (check_crc) MPI_Isend(&crc, 1, MPI_UINT32_T, out->dest, 0, MPI_COMM_WORLD, &requests[segments]);
+        MPI_Waitall(segments + check_crc, requests, MPI_STATUSES_IGNORE);
+        return;
+    }
+
+    // 5.1 Using Non-Blocking Send/Receive + 5.2 Data Compression
+    // 5.5 Pieces are cut from a contiguous copy of a block-cyclic chunk
+    const int* src = chunk_element(full_data, chunk, 0);
+    int* gathered = NULL;
+    if (block > 0) {
+        double t0 = MPI_Wtime();
+        gathered = bufpool_get(CHUNK_BYTES);
+        gather_chunk(full_data, chunk, gathered);
+        src = gathered;
+        pack_time += MPI_Wtime() - t0;
+    }
+    for (long i = 0; i < n; i++) {
+        long p = list != NULL ? list[i] : i;
+        coalescer_add(out, p, &src[p * piece_size]);
+    }
+    coalescer_flush(out); // Nothing else is coming to fill the last frame
+    coalescer_progress(out);
+    bufpool_put(gathered);
+}
+
+// Master: sends chunk 'chunk' of full_data to out->dest
+void send_chunk(int full_data[], int chunk, Coalescer* out) {
+    chunks_sent++;
+    long bytes_before = out->bytes_sent;
+    send_pieces(full_data, chunk, out, NULL, num_pieces);
+    if (out->mode == TRANSFER_ZEROCOPY) return;
+
+    // 6.2 Measure Communication Overhead (on sender)
+    printf("Master Node 0 sent %ld bytes (%ld on the wire) to node %d.\n", chunk_pack_size(),
+           out->bytes_sent - bytes_before, out->dest);
+}
+
+// 5.7 Master: the chunk a slave is working on, which it may ask to have
+// (partly) sent again while the master waits for its result
+typedef struct {
+    int* full_data;
+    int chunk;
+    Coalescer* link;
+    uint32_t* list;    // room for num_pieces indices
+} Resend;
+
+// 5.7 Master: sends the pieces the slave asked for, if it asked. Returns 1 if it did.
+int serve_resend(Resend* r) {
+    int flag, n;
+    MPI_Status status;
+    MPI_Iprobe(r->link->dest, TAG_RESEND, MPI_COMM_WORLD, &flag, &status);
+    if (!flag) return 0;
+    MPI_Get_count(&status, MPI_UINT32_T, &n);
+    MPI_Recv(r->list, n, MPI_UINT32_T, r->link->dest, TAG_RESEND, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    send_pieces(r->full_data, r->chunk, r->link, r->list, n);
+    return 1;
+}
+
+// Heartbeat Check (modified): waits for a receive from a slave. On a timeout
+// the receive is cancelled and 0 returned. 5.7 Meanwhile it serves the
+// slave's requests to send pieces again, if context is a Resend.
+int wait_heartbeat(MPI_Request* recv_request, MPI_Status* status, void* context) {
+    int flag = 0;
+    useconds_t pause = 10;
+    double start_time = MPI_Wtime();
+    while (flag == 0 && (MPI_Wtime() - start_time) < HEARTBEAT_TIMEOUT) {
+        MPI_Test(recv_request, &flag, status); // Check if data is received
+        if (!flag && context != NULL && serve_resend(context)) {
+            start_time = MPI_Wtime(); // The slave is alive
+            pause = 10;
+        } else if (!flag) {
+            // Sleep to avoid busy-waiting, backing off from 10 us to 10 milliseconds
+            usleep(pause);
+            if (pause < 10000) pause *= 2;
+        }
+    }
+    if (!flag) {
+        MPI_Cancel(recv_request); // Cancel the pending receive
+        MPI_Request_free(recv_request); // Free the request object
+    }
+    return flag;
+}
+
+// 5.5 Slave: waits for the master, meanwhile sending a frame that has waited
+// out its delay. Sends in flight progress inside MPI_Wait as well.
+int wait_for_master(MPI_Request* request, MPI_Status* status, void* context) {
+    Coalescer* out = context;
+    int flag = 0;
+    while (out->frame != NULL && !flag) {
+        MPI_Test(request, &flag, status);
+        if (!flag) coalescer_progress(out);
+    }
+    if (!flag) MPI_Wait(request, status);
+    return 1;
+}
+
+// Master: receives the result of 'chunk' from link->dest into its place in
+// results. Returns 0 if the slave missed the heartbeat timeout. 5.7 Pieces
+// that fail their check are asked for again, and the result is accepted
+// with an empty list once all of it has passed.
+int receive_result(int full_data[], int results[], int chunk, Coalescer* link) {
+    uint32_t* list = malloc(num_pieces * sizeof(uint32_t));
+    Resend resend = { full_data, chunk, link, list };
+
+    if (link->mode == TRANSFER_ZEROCOPY) {
+        // 5.4 Straight into place in results, (5.6) all segments posted at once
+        long segments = chunk_segments();
+        MPI_Request requests[segments + 1];
+        uint32_t crc = 0, whole_chunk = 0;
+        for (;;) {
+            for (long s = 0; s < segments; s++) {
+                MPI_Datatype type = (s + 1) * segment_elems <= CHUNK_SIZE ? segment_type : tail_type;
+                MPI_Irecv(chunk_element(results, chunk, s * segment_elems), 1, type, link->dest, 0,
+                          MPI_COMM_WORLD, &requests[s]);
+            }
+            if (check_crc) MPI_Irecv(&crc, 1, MPI_UINT32_T, link->dest, 0, MPI_COMM_WORLD, &requests[segments]);
+            for (long s = 0; s < segments + check_crc; s++) {
+                if (!wait_heartbeat(&requests[s], MPI_STATUS_IGNORE, &resend)) {
+                    for (long t = s + 1; t < segments + check_crc; t++) {
+                        MPI_Cancel(&requests[t]);
+                        MPI_Request_free(&requests[t]);
+                    }
+                    free(list);
+                    return 0;
+                }
+            }
+            maybe_corrupt((unsigned char*)chunk_element(results, chunk, CHUNK_SIZE / 2));
+            if (!check_crc || chunk_crc(results, chunk) == crc) break;
+            pieces_bad++;
+            MPI_Send(&whole_chunk, 1, MPI_UINT32_T, link->dest, TAG_RESEND, MPI_COMM_WORLD);
+        }
+    } else {
+        // 5.5 Frames arrive until every piece of the chunk is in
+        int* dst = block > 0 ? bufpool_get(CHUNK_BYTES) : chunk_element(results, chunk, 0);
+        Receipt got;
+        receipt_init(&got);
+        while (got.num_good < num_pieces) {
+            unsigned char* message = bufpool_get(link->capacity);
+            long received_size = recv_bytes(message, link->capacity, link->dest, wait_heartbeat, &resend);
+            if (received_size < 0) {
+                // The buffer is not returned to the pool: MPI may still write to it
+                if (block > 0) bufpool_put(dst);
+                receipt_free(&got);
+                free(list);
+                return 0;
+            }
+            unpack_frame(message, received_size, dst, link->mode, &got);
+            frames_received++;
+            bufpool_put(message);
+            if (got.num_bad > 0) request_resend(link->dest, &got);
+        }
+        if (block > 0) {
+            double t0 = MPI_Wtime();
+            scatter_chunk(results, chunk, dst);
+            bufpool_put(dst);
+            unpack_time += MPI_Wtime() - t0;
+        }
+        receipt_free(&got);
+    }
+    MPI_Send(NULL, 0, MPI_UINT32_T, link->dest, TAG_RESEND, MPI_COMM_WORLD);
+    free(list);
+    return 1;
 }
 
 int main(int argc, char** argv) {
     int rank, size;
-    int data[CHUNK_SIZE];
+    int* data = NULL;
 
     MPI_Init(&argc, &argv);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
+    bufpool_init();
+    crc32c_init();
+    int mode = transfer_mode();
+    layout_init();
 
     //4. Handling Node Failures
     int failed_nodes[size]; // Use a dynamic size array to store failure status
@@ -36,69 +777,104 @@ int main(int argc, char** argv) {
     int num_failed_nodes = 0; // Track number of failed nodes.
 
     if (rank == 0) { // Master Node
-        printf("Master: Distributing work to slaves...\n");
+        printf("Master: Distributing work to slaves (%s transfer, %s chunks)...\n",
+               transfer_names[mode], block > 0 ? "block-cyclic" : "contiguous");
 
-        int full_data[DATA_SIZE];
-        for (int i = 0; i < DATA_SIZE; i++) full_data[i] = i;
+        int* full_data = malloc(DATA_SIZE * sizeof(int));
+        for (long i = 0; i < DATA_SIZE; i++) full_data[i] = i % VALUE_RANGE;
+        int* results = malloc(DATA_SIZE * sizeof(int)); // Processed chunks, same layout as full_data
+
+        // 5.5 Frame policy per slave, from the measured link: a frame is large
+        // enough that the latency is at most 10% of its transfer time, but no
+        // more than a quarter of a chunk, so that a slave starts on the first
+        // frame while the master packs the next. A piece waits at most as long
+        // as a full frame takes to send.
+        // 5.6 Segments are as large as the largest size any link needs for 90%
+        // of its bandwidth (LAB2_SEGMENT=<bytes> overrides it).
+        Coalescer links[size];
+        size_t capacity = sizeof(uint32_t) + sizeof(PieceHeader) + piece_bound(mode);
+        double policy[size][2];
+        long segment = 0;
+        for (int i = 1; i < size; i++) {
+            double latency, bandwidth;
+            long link_segment;
+            probe_link(i, 1, &latency, &bandwidth, &link_segment);
+            if (link_segment > segment) segment = link_segment;
+            double threshold = 9 * latency * bandwidth;
+            if (threshold > CHUNK_BYTES / 4) threshold = CHUNK_BYTES / 4;
+            if (threshold < FRAME_MIN) threshold = FRAME_MIN;
+            policy[i][0] = coalesce ? threshold : 0;
+            policy[i][1] = coalesce ? latency + threshold / bandwidth : 0;
+            if (capacity < sizeof(uint32_t) + policy[i][0] + sizeof(PieceHeader) + piece_bound(mode)) {
+                capacity = sizeof(uint32_t) + policy[i][0] + sizeof(PieceHeader) + piece_bound(mode);
+            }
+            printf("Master: link to slave %d: %.1f us latency, %.2f GB/s (90%% of it from %ld KB messages)",
+                   i, 1e6 * latency, bandwidth / 1e9, link_segment / 1024);
+            if (mode == TRANSFER_ZEROCOPY) printf(".\n");
+            else if (coalesce) printf(": frames of %.0f KB, sent after %.1f us.\n", policy[i][0] / 1024, 1e6 * policy[i][1]);
+            else printf(": one message per piece.\n");
+        }
+        const char* env = getenv("LAB2_SEGMENT");
+        if (env != NULL && atol(env) > 0) segment = atol(env);
+        if (segment < (long)sizeof(int)) segment = sizeof(int);
+        if (segment > INT_MAX) segment = INT_MAX;
+        if (!LARGE_COUNT) segment_bytes = segment;
+        segments_init();
+#if LARGE_COUNT
+        printf("Master: MPI-%d large counts: every message goes in one piece.\n", MPI_VERSION);
+#else
+        printf("Master: MPI-%d int counts: messages of %ld KB or more go as segments of that size.\n",
+               MPI_VERSION, segment_bytes / 1024);
+#endif
+        for (int i = 1; i < size; i++) {
+            double frame[4] = { policy[i][0], policy[i][1], capacity, segment };
+            MPI_Send(frame, 4, MPI_DOUBLE, i, TAG_PROBE, MPI_COMM_WORLD);
+            coalescer_init(&links[i], i, mode, frame[0], frame[1], capacity);
+        }
+
+        // 5.3 Working set: the frames in flight to every slave, one frame to
+        // receive, one chunk to scatter from and (5.7) one to gather pieces
+        // to send again from
+        if (mode != TRANSFER_ZEROCOPY) {
+            int frames = 1;
+            for (int i = 1; i < size; i++) frames += frames_per_chunk(links[i].threshold);
+            bufpool_reserve(capacity, frames);
+            if (block > 0) bufpool_reserve(CHUNK_BYTES, 2);
+        }
 
         // Distribute work to slaves (initially)
+        double job_start = MPI_Wtime();
         int chunk_index = 0;
+        int slave_chunk[size];
         for (int i = 1; i < size; i++) {
             if(failed_nodes[i] == 0) //Only send to non failed nodes
             {
-                // 5.1 Using Non-Blocking Send/Receive + 5.2 Data Compression
-                unsigned char compressed_data[CHUNK_SIZE + 100]; // Add extra space for potential compression expansion
-                uLongf compressed_size = sizeof(compressed_data); // Size of dest buffer
-                compress(compressed_data, &compressed_size, (const Bytef *)&full_data[chunk_index * CHUNK_SIZE], CHUNK_SIZE);
-
-                MPI_Request request;
-                MPI_Isend(compressed_data, compressed_size, MPI_UNSIGNED_CHAR, i, 0, MPI_COMM_WORLD, &request);
-                MPI_Wait(&request, MPI_STATUS_IGNORE); // Wait for send to complete.
+                slave_chunk[i] = chunk_index;
+                send_chunk(full_data, chunk_index, &links[i]);
                 chunk_index++;
-
-                // 6.2 Measure Communication Overhead (on sender)
-                int bytes_sent;
-                MPI_Pack_size(CHUNK_SIZE, MPI_INT, MPI_COMM_WORLD, &bytes_sent);
-                printf("Master Node %d sent %d bytes to node %d.\n", rank, bytes_sent, i);
             }
         }
 
         // Receive processed data from slaves and check for failures
-        int received_data[CHUNK_SIZE];
-        unsigned char received_compressed_data[CHUNK_SIZE + 100];
-        MPI_Status status;
-
+        int verified = 0;
+        long bad_elements = 0;
         for (int i = 1; i < size; i++) {
             if (failed_nodes[i] == 0) // Only receive from non-failed nodes
             {
-                MPI_Request recv_request;
-
-                // Start non-blocking receive
-                MPI_Irecv(received_compressed_data, sizeof(received_compressed_data), MPI_UNSIGNED_CHAR, i, 0, MPI_COMM_WORLD, &recv_request);
-
-                // Heartbeat Check (modified)
-                int flag = 0;
-                double start_time = MPI_Wtime();
-                while (flag == 0 && (MPI_Wtime() - start_time) < HEARTBEAT_TIMEOUT) {
-                    MPI_Test(&recv_request, &flag, &status); // Check if data is received
-                    usleep(10000);                                // Sleep for 10 milliseconds to avoid busy-waiting
-                }
-
-                if (flag) {
-                    uLongf uncompressed_size = CHUNK_SIZE;
-                    uncompress((Bytef *)received_data, &uncompressed_size, received_compressed_data, status.count);
-
+                if (receive_result(full_data, results, slave_chunk[i], &links[i])) {
+                    // Slave i multiplied its chunk by i
+                    bad_elements += check_chunk(full_data, results, slave_chunk[i], i);
+                    verified++;
                     printf("Master received data from Slave %d\n", i);
                 } else {
                     failed_nodes[i] = 1;
                     num_failed_nodes++;
                     printf("Slave %d failed! (Heartbeat Timeout)\n", i);
-                    MPI_Cancel(&recv_request); // Cancel the pending receive
-                    MPI_Request_free(&recv_request); // Free the request object
                 }
             }
 
         }
+        double job_time = MPI_Wtime() - job_start;
 
         //Redistribute work to remaining active nodes (Simplified)
         if (num_failed_nodes > 0) {
@@ -111,54 +887,148 @@ int main(int argc, char** argv) {
             {
                 if (failed_nodes[i] == 0) //If the slave is alive.
                 {
-                    // 5.1 Using Non-Blocking Send/Receive + 5.2 Data Compression
-                    unsigned char compressed_data[CHUNK_SIZE + 100]; // Add extra space for potential compression expansion
-                    uLongf compressed_size = sizeof(compressed_data); // Size of dest buffer
-                    compress(compressed_data, &compressed_size, (const Bytef *)&full_data[chunk_index * CHUNK_SIZE], CHUNK_SIZE);
-
-                    MPI_Request request;
-                    MPI_Isend(compressed_data, compressed_size, MPI_UNSIGNED_CHAR, i, 0, MPI_COMM_WORLD, &request);
-                    MPI_Wait(&request, MPI_STATUS_IGNORE); // Wait for send to complete.
-
+                    send_chunk(full_data, chunk_index, &links[i]);
                     chunk_index++;
                 }
             }
         }
 
+        for (int i = 1; i < size; i++) coalescer_finish(&links[i]);
         printf("Master: Data processing completed.\n");
+        // 5.4 Copy cost per chunk on the master, and a check of the results
+        printf("Master: %s transfer: %.1f us packing and %.1f us unpacking per chunk; "
+               "%d chunks verified, %ld wrong elements.\n", transfer_names[mode],
+               chunks_sent > 0 ? 1e6 * pack_time / chunks_sent : 0.0,
+               verified > 0 ? 1e6 * unpack_time / verified : 0.0, verified, bad_elements);
+        // 5.5 Message rate and throughput of the whole exchange, both ways
+        if (mode != TRANSFER_ZEROCOPY) {
+            long messages = frames_received, pieces = 2L * verified * num_pieces;
+            for (int i = 1; i < size; i++) messages += links[i].messages;
+            printf("Master: %ld pieces of %ld elements in %ld messages (%.1f per message) in %.1f ms: "
+                   "%.0f messages/s, %.0f pieces/s, %.0f MB/s.\n", pieces, piece_size, messages,
+                   messages > 0 ? (double)pieces / messages : 0.0, 1e3 * job_time,
+                   messages / job_time, pieces / job_time,
+                   (double)pieces * piece_size * sizeof(int) / job_time / 1e6);
+        } else {
+            printf("Master: %d chunks each way in %.1f ms: %.0f MB/s.\n", verified, 1e3 * job_time,
+                   2.0 * verified * CHUNK_BYTES / job_time / 1e6);
+        }
+        free(full_data);
+        free(results);
 
     } else { // Slave Nodes
-        unsigned char compressed_data[CHUNK_SIZE + 100];
-        MPI_Status status;
-
-        // 5.1 Using Non-Blocking Send/Receive + 5.2 Data Compression
-        MPI_Request recv_request;
-        MPI_Irecv(compressed_data, sizeof(compressed_data), MPI_UNSIGNED_CHAR, 0, 0, MPI_COMM_WORLD, &recv_request);
-        MPI_Wait(&recv_request, &status); // Wait for receive to complete
+        data = malloc(CHUNK_BYTES);
 
-        uLongf uncompressed_size = CHUNK_SIZE;
-        uncompress((Bytef *)data, &uncompressed_size, compressed_data, status.count);
+        // 5.5 The master measures the link and sends back the frame policy
+        // and (5.6) the segment size
+        double latency, bandwidth, frame[4];
+        long link_segment;
+        probe_link(0, 0, &latency, &bandwidth, &link_segment);
+        MPI_Recv(frame, 4, MPI_DOUBLE, 0, TAG_PROBE, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        if (!LARGE_COUNT) segment_bytes = frame[3];
+        segments_init();
 
-        printf("Slave %d received data, starting processing...\n", rank);
-
-        process_data(rank, data);
+        if (mode == TRANSFER_ZEROCOPY) {
+            // 5.4 Straight into data[], which process_data() works on, (5.6) in
+            // segments, (5.7) followed by the chunk's CRC32C
+            long segments = chunk_segments();
+            MPI_Request requests[segments + 1];
+            uint32_t crc = 0, whole_chunk = 0;
+            for (;;) {
+                for (long s = 0; s < segments; s++) {
+                    long count = CHUNK_SIZE - s * segment_elems;
+                    post_ints(&data[s * segment_elems], count < segment_elems ? count : segment_elems, 0, 0, &requests[s]);
+                }
+                if (check_crc) MPI_Irecv(&crc, 1, MPI_UINT32_T, 0, 0, MPI_COMM_WORLD, &requests[segments]);
+                MPI_Waitall(segments + check_crc, requests, MPI_STATUSES_IGNORE);
+                maybe_corrupt((unsigned char*)&data[CHUNK_SIZE / 2]);
+                if (!check_crc || piece_crc(NULL, data, CHUNK_BYTES) == crc) break;
+                pieces_bad++;
+                MPI_Send(&whole_chunk, 1, MPI_UINT32_T, 0, TAG_RESEND, MPI_COMM_WORLD);
+            }
+            printf("Slave %d received data, starting processing...\n", rank);
+            printf("Slave %d processing data...\n", rank);
+            process_data(data, CHUNK_SIZE, rank);
+            printf("Slave %d processing complete.\n", rank);
 
-        // 5.1 Using Non-Blocking Send/Receive + 5.2 Data Compression
-        unsigned char compressed_data_send[CHUNK_SIZE + 100]; // Add extra space for potential compression expansion
-        uLongf compressed_size_send = sizeof(compressed_data_send); // Size of dest buffer
-        compress(compressed_data_send, &compressed_size_send, (const Bytef *)data, CHUNK_SIZE);
+            // 5.4 The result goes out in place, from data[], (5.7) again until
+            // the master accepts it with an empty list
+            crc = check_crc ? piece_crc(NULL, data, CHUNK_BYTES) : 0;
+            for (int n = 1; n > 0; ) {
+                for (long s = 0; s < segments; s++) {
+                    long count = CHUNK_SIZE - s * segment_elems;
+                    post_ints(&data[s * segment_elems], count < segment_elems ? count : segment_elems, 0, 1, &requests[s]);
+                }
+                if (check_crc) MPI_Isend(&crc, 1, MPI_UINT32_T, 0, 0, MPI_COMM_WORLD, &requests[segments]);
+                MPI_Waitall(segments + check_crc, requests, MPI_STATUSES_IGNORE);
+                MPI_Status status;
+                MPI_Probe(0, TAG_RESEND, MPI_COMM_WORLD, &status);
+                MPI_Get_count(&status, MPI_UINT32_T, &n);
+                MPI_Recv(&whole_chunk, n, MPI_UINT32_T, 0, TAG_RESEND, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                pieces_resent += n;
+            }
+        } else {
+            Coalescer out;
+            coalescer_init(&out, 0, mode, frame[0], frame[1], frame[2]);
+            // 5.3 The frame being received, the one being filled, and those in flight
+            bufpool_reserve(out.capacity, 2 + frames_per_chunk(out.threshold));
 
-        MPI_Request send_request;
-        MPI_Isend(compressed_data_send, compressed_size_send, MPI_UNSIGNED_CHAR, 0, 0, MPI_COMM_WORLD, &send_request);
-        MPI_Wait(&send_request, MPI_STATUS_IGNORE); // Wait for send to complete
+            // 5.1 Using Non-Blocking Send/Receive + 5.2 Data Compression
+            // 5.5 Each piece is processed and queued for the master as soon as it arrives
+            // 5.7 once it has passed its check; the others are asked for again
+            Receipt in;
+            receipt_init(&in);
+            while (in.num_good < num_pieces) {
+                unsigned char* message = bufpool_get(out.capacity);
+                long received_size = recv_bytes(message, out.capacity, 0, wait_for_master, &out);
+                coalescer_progress(&out); // Return the buffers of completed sends
+                unpack_frame(message, received_size, data, mode, &in);
+                bufpool_put(message);
+                if (in.num_bad > 0) request_resend(0, &in);
+                if (in.num_arrived > 0 && in.num_good == in.num_arrived) {
+                    printf("Slave %d received data, starting processing...\n", rank);
+                    printf("Slave %d processing data...\n", rank);
+                }
+                for (long k = 0; k < in.num_arrived; k++) {
+                    int* piece = &data[in.arrived[k] * piece_size];
+                    process_data(piece, piece_size, rank);
+                    coalescer_add(&out, in.arrived[k], piece);
+                }
+            }
+            printf("Slave %d processing complete.\n", rank);
 
-        // 6.2 Measure Communication Overhead (on sender)
-        int bytes_sent;
-        MPI_Pack_size(CHUNK_SIZE, MPI_INT, MPI_COMM_WORLD, &bytes_sent);
-        printf("Slave Node %d sent %d bytes to node 0.\n", rank, bytes_sent);
+            // 5.7 Until the master accepts the result with an empty list, send
+            // again the pieces it asks for; they are still in data[]
+            coalescer_flush(&out);
+            for (;;) {
+                MPI_Status status;
+                int n;
+                MPI_Probe(0, TAG_RESEND, MPI_COMM_WORLD, &status);
+                MPI_Get_count(&status, MPI_UINT32_T, &n);
+                MPI_Recv(in.bad, n, MPI_UINT32_T, 0, TAG_RESEND, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                if (n == 0) break;
+                pieces_resent += n;
+                for (int k = 0; k < n; k++) coalescer_add(&out, in.bad[k], &data[in.bad[k] * piece_size]);
+                coalescer_flush(&out);
+            }
+            coalescer_finish(&out);
+            receipt_free(&in);
 
+            // 6.2 Measure Communication Overhead (on sender)
+            printf("Slave Node %d sent %ld bytes (%ld on the wire in %ld messages) to node 0; "
+                   "%.1f us unpacking, %.1f us packing.\n", rank, chunk_pack_size(), out.bytes_sent,
+                   out.messages, 1e6 * unpack_time, 1e6 * pack_time);
+        }
+        free(data);
     }
 
+    // 5.7 Cost of the checks, and what they caught
+    report_integrity(rank == 0 ? "Master" : "Slave");
+    // 5.3 The counter shows that no message buffer was allocated after start-up
+    bufpool_report(rank == 0 ? "Master" : "Slave");
+    bufpool_destroy();
+    MPI_Type_free(&segment_type);
+    if (tail_type != MPI_DATATYPE_NULL) MPI_Type_free(&tail_type);
     MPI_Finalize();
     return 0;
 }
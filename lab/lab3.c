@@ -5,6 +5,11 @@
 #include <zlib.h>
 #include <unistd.h>       // For usleep
 #include <pthread.h>      // For multithreading
+#include <stdint.h>
+#include <stdatomic.h>    // Per-thread progress counters
+#include <fcntl.h>        // Slave spill file
+#include "locks.h"        // Lock library (pthread, ttas, ticket, mcs, spin_park)
+#include "bufpool.h"      // Reused message buffers and zlib streams
 
 // ------------------ Configurable Parameters ---------------------
 #define DATA_SIZE 1000000
@@ -14,8 +19,161 @@
 // Number of worker threads per slave node
 #define NUM_THREADS 4
 
+// Lock protecting the slave's shared aggregate; override at run time with
+// the LAB3_LOCK environment variable (pthread, ttas, ticket, mcs, spin_park)
+#define DEFAULT_SLAVE_LOCK LOCK_SPIN_PARK
+
+// Threads fold their partial results into the shared aggregate every
+// AGGREGATE_BATCH elements
+#define AGGREGATE_BATCH 1024
+
+// The input is split into NUM_CHUNKS chunks. The master hands one chunk at a
+// time to every idle slave until all of them are done.
+#define NUM_CHUNKS (DATA_SIZE / CHUNK_SIZE)
+
+// Message tags: chunks and results travel on TAG_DATA, progress reports on
+// TAG_PROGRESS, the replicated scheduling log on TAG_LOG. TAG_TAKEOVER,
+// TAG_SHUTDOWN and TAG_RESEND are control messages to the slaves.
+#define TAG_DATA 0
+#define TAG_PROGRESS 1
+#define TAG_LOG 2
+#define TAG_TAKEOVER 3
+#define TAG_SHUTDOWN 4
+#define TAG_RESEND 5
+
+// Chunks and results start with the chunk id (uint32_t). A message holds
+// the id and at most compressBound() bytes of compressed data; its buffers
+// come from bufpool.h.
+#define CHUNK_HEADER sizeof(uint32_t)
+#define CHUNK_BYTES (CHUNK_SIZE * sizeof(int))
+#define MESSAGE_SIZE (CHUNK_HEADER + compressBound(CHUNK_BYTES))
+
+// The slave samples its threads' progress and reports it this often; the
+// reports double as heartbeats. The master prints its progress view every
+// PROGRESS_PRINT_INTERVAL seconds.
+#define PROGRESS_INTERVAL_MS 100
+#define PROGRESS_PRINT_INTERVAL 1.0
+
+// A slave whose projected finish time exceeds STRAGGLER_FACTOR times the
+// median projected finish time is reported as a straggler
+#define STRAGGLER_FACTOR 2.0
+
+// Setting LAB3_SLOW_RANK=<r> makes the threads of rank r sleep this long
+// after every batch, to watch the progress view and straggler detection
+#define SLOW_RANK_DELAY_US 20000
+
+// Hot standby (LAB3_STANDBY=1, at least 3 ranks): rank STANDBY_RANK follows
+// the master's scheduling log and takes over when no record has arrived for
+// MASTER_TIMEOUT seconds. An idle master sends a heartbeat record every
+// LOG_HEARTBEAT_INTERVAL seconds. LAB3_MASTER_FAIL_AFTER=<n> makes the
+// master go silent after n completed chunks, to watch a takeover.
+#define STANDBY_RANK 1
+#define MASTER_TIMEOUT 1.0
+#define LOG_HEARTBEAT_INTERVAL 0.05
+#define LOG_BATCH 64
+
+// Slaves append their results to a spill file in LAB3_SPILL_DIR (default
+// /tmp) and upload them from there in the background, so they take new work
+// while the master is not receiving. LAB3_SPILL=0 makes a slave wait for
+// each upload instead. While computing, a slave checks its uploads every
+// UPLOAD_POLL_MS. LAB3_MASTER_STALL=<s> makes the master receive no results
+// for its first s seconds, as if it were busy elsewhere.
+#define UPLOAD_POLL_MS 5
+
 // ---------------------------------------------------------------
 
+// Progress of one worker thread. Each counter has its own cache line so that
+// a thread publishing its progress does not slow down its neighbours.
+typedef struct {
+    atomic_long done;     // elements finished so far (written by the thread)
+    long total;           // elements assigned to the thread
+} __attribute__((aligned(LOCK_CACHE_LINE))) ProgressSlot;
+
+// Progress report sent by a slave to the master on TAG_PROGRESS (12 bytes).
+// An idle slave with results still to upload keeps sending its last report.
+typedef struct {
+    uint32_t chunk;                    // chunk the report is about
+    uint16_t permille;                 // whole chunk, 0..1000
+    uint8_t  thread_pct[NUM_THREADS];  // each thread, 0..100
+    uint8_t  finished;                 // 1 in the last report
+} ProgressMsg;
+
+// Master-side view of one slave, built from its progress reports
+typedef struct {
+    ProgressMsg last;     // most recent report
+    int    reports;       // number of reports received
+    int    first_permille;
+    double first_time;    // when the first report arrived
+    double last_time;     // when the latest report arrived
+    double last_advance;  // last time the slave made progress
+    double last_heard;    // last report of any kind, also while idle
+    double chunk_start;   // when the current chunk was sent
+    double finish_time;   // when the slave finished it (0 while computing)
+    int    straggler;     // already reported as a straggler
+} SlaveProgress;
+
+// One entry of the replicated scheduling log (8 bytes)
+typedef struct {
+    uint8_t  type;        // LOG_HEARTBEAT, LOG_ASSIGN, ...
+    uint8_t  reserved;
+    uint16_t slave;
+    uint32_t chunk;
+} LogRecord;
+
+// LOG_FINISHED: the slave has computed the chunk and is free for the next
+// one; the chunk is complete once its result has arrived (LOG_COMPLETE)
+enum { LOG_HEARTBEAT, LOG_ASSIGN, LOG_FINISHED, LOG_COMPLETE, LOG_FAILED, LOG_DONE };
+
+// Scheduling state. The master changes it only through log records, and the
+// standby applies the same records to its copy, so both copies agree.
+#define CHUNK_PENDING -1
+#define CHUNK_DONE -2
+typedef struct {
+    int owner[NUM_CHUNKS];        // slave computing or holding the chunk, CHUNK_PENDING or CHUNK_DONE
+    int assignments[NUM_CHUNKS];  // times the chunk was handed out
+    int* current;                 // per rank: chunk the slave works on, or -1
+    int* failed;                  // per rank: 1 once the slave is deemed failed
+    int done;                     // completed chunks
+} JobState;
+
+// Master side: records not yet sent to the standby
+typedef struct {
+    LogRecord rec[LOG_BATCH];
+    int n;
+    int standby;          // rank of the standby, -1 without one
+    double last_flush;
+} ReplicationLog;
+
+// Slave side: the spill file and the upload of the results in it. Every
+// result is appended to the file; uploads to the master read it back one
+// at a time, in the order the results were queued.
+typedef struct {
+    int rank;
+    int master;
+    int fd;                       // append-only spill file
+    char path[256];
+    off_t end;                    // bytes written so far
+    off_t offset[NUM_CHUNKS];     // record of each chunk's result, -1 if none
+    int queue[NUM_CHUNKS];        // chunks waiting for upload (FIFO)
+    int head, count;
+    uint8_t queued[NUM_CHUNKS];
+    int uploading;                // chunk whose upload is in flight, -1 if none
+    unsigned char* buf;           // its bytes
+    MPI_Request request;
+    unsigned char* stale_buf;     // upload to a master that was taken over (pool buffer)
+    MPI_Request stale;
+    ProgressMsg last_report;      // sent again as a heartbeat while uploads wait
+    double last_report_time;
+    int results, spilled, uploads;
+} SlaveLink;
+
+// Slave-wide results shared by all worker threads
+typedef struct {
+    Lock lock;
+    long long sum;        // sum of all processed values
+    long processed;       // number of processed elements
+} SlaveAggregate;
+
 // Structure for passing work info to each thread
 typedef struct {
     int thread_id;
@@ -23,6 +181,9 @@ typedef struct {
     int* data;
     int start_idx;
     int end_idx;
+    SlaveAggregate* aggregate;
+    ProgressSlot* progress;
+    int batch_delay_us;   // simulated extra work per batch (LAB3_SLOW_RANK)
 } ThreadTask;
 
 // Thread function: processes a portion of the data array
@@ -30,28 +191,217 @@ void* thread_process(void* arg) {
     ThreadTask* task = (ThreadTask*)arg;
     int rank = task->rank;
 
+    long long partial_sum = 0;
+    long partial_count = 0;
+
     for (int i = task->start_idx; i < task->end_idx; i++) {
         // Simple multiply by rank (as a placeholder for real compute)
         task->data[i] = task->data[i] * rank;
+        partial_sum += task->data[i];
+        partial_count++;
+
+        // Fold the partial result into the shared aggregate
+        if (partial_count == AGGREGATE_BATCH || i == task->end_idx - 1) {
+            lock_acquire(&task->aggregate->lock);
+            task->aggregate->sum += partial_sum;
+            task->aggregate->processed += partial_count;
+            lock_release(&task->aggregate->lock);
+            partial_sum = 0;
+            partial_count = 0;
+
+            // Publish progress; only the slave's MPI thread reads it
+            atomic_store_explicit(&task->progress->done, i + 1 - task->start_idx,
+                                  memory_order_release);
+            if (task->batch_delay_us > 0) usleep(task->batch_delay_us);
+        }
     }
 
-    // Could also return partial stats if needed
     pthread_exit(NULL);
 }
 
+// Slave side: combine the per-thread counters into one compact report
+void sample_progress(ProgressSlot progress[], ProgressMsg* msg) {
+    long done_all = 0, total_all = 0;
+    msg->finished = 1;
+    for (int t = 0; t < NUM_THREADS; t++) {
+        long done = atomic_load_explicit(&progress[t].done, memory_order_acquire);
+        long total = progress[t].total;
+        msg->thread_pct[t] = (uint8_t)(total > 0 ? 100 * done / total : 100);
+        if (done < total) msg->finished = 0;
+        done_all += done;
+        total_all += total;
+    }
+    msg->permille = (uint16_t)(total_all > 0 ? 1000 * done_all / total_all : 1000);
+}
+
+// Slave side: switch to a new master if one has announced itself
+int poll_takeover(int rank, int* master) {
+    int flag;
+    MPI_Status status;
+    MPI_Iprobe(MPI_ANY_SOURCE, TAG_TAKEOVER, MPI_COMM_WORLD, &flag, &status);
+    if (!flag) return 0;
+    MPI_Recv(master, 1, MPI_INT, status.MPI_SOURCE, TAG_TAKEOVER, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    printf("Slave %d: rank %d took over as master.\n", rank, *master);
+    return 1;
+}
+
+void slave_link_open(SlaveLink* link, int rank) {
+    memset(link, 0, sizeof(*link));
+    link->rank = rank;
+    link->uploading = -1;
+    link->request = link->stale = MPI_REQUEST_NULL;
+    link->buf = bufpool_get(MESSAGE_SIZE);
+    for (int c = 0; c < NUM_CHUNKS; c++) link->offset[c] = -1;
+
+    const char* dir = getenv("LAB3_SPILL_DIR");
+    snprintf(link->path, sizeof(link->path), "%s/lab3-spill-%d-%d.bin",
+             dir != NULL ? dir : "/tmp", (int)getpid(), rank);
+    link->fd = open(link->path, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0600);
+    if (link->fd < 0) {
+        perror(link->path);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+}
+
+// Queues a chunk's result for upload; a chunk is queued at most once
+void upload_enqueue(SlaveLink* link, int chunk) {
+    if (link->offset[chunk] < 0 || link->queued[chunk] || link->uploading == chunk) return;
+    link->queue[(link->head + link->count++) % NUM_CHUNKS] = chunk;
+    link->queued[chunk] = 1;
+}
+
+// Completes the upload in flight and starts the next one from the spill file
+void upload_progress(SlaveLink* link) {
+    int flag;
+    if (link->stale != MPI_REQUEST_NULL) {
+        MPI_Test(&link->stale, &flag, MPI_STATUS_IGNORE);
+        if (flag) {
+            bufpool_put(link->stale_buf);
+            link->stale_buf = NULL;
+        }
+    }
+    if (link->request != MPI_REQUEST_NULL) {
+        MPI_Test(&link->request, &flag, MPI_STATUS_IGNORE);
+        if (!flag) return;
+        link->uploads++;
+    }
+    link->uploading = -1;
+    if (link->count == 0) return;
+
+    int chunk = link->queue[link->head];
+    link->head = (link->head + 1) % NUM_CHUNKS;
+    link->count--;
+    link->queued[chunk] = 0;
+    uint32_t size;
+    if (pread(link->fd, &size, sizeof(size), link->offset[chunk]) != sizeof(size) ||
+        pread(link->fd, link->buf, size, link->offset[chunk] + sizeof(size)) != (ssize_t)size) {
+        perror(link->path);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    link->uploading = chunk;
+    MPI_Isend(link->buf, size, MPI_UNSIGNED_CHAR, link->master, TAG_DATA, MPI_COMM_WORLD, &link->request);
+}
+
+// Slave side: switch the uploads to a new master
+void follow_takeover(SlaveLink* link) {
+    if (poll_takeover(link->rank, &link->master) && link->request != MPI_REQUEST_NULL) {
+        // The upload in flight went to the old master. It completes when that
+        // master drains its messages at the end; the new master asks again
+        // if it does not have the chunk.
+        link->stale = link->request;
+        link->stale_buf = link->buf;
+        link->request = MPI_REQUEST_NULL;
+        link->uploading = -1;
+        link->buf = bufpool_get(MESSAGE_SIZE);
+    }
+}
+
+// Slave side: follow a takeover, queue the results a new master asks for,
+// and keep the uploads going. Called whenever the slave's MPI thread is free.
+void slave_poll(SlaveLink* link) {
+    int flag;
+    MPI_Status status;
+    follow_takeover(link);
+    MPI_Iprobe(MPI_ANY_SOURCE, TAG_RESEND, MPI_COMM_WORLD, &flag, &status);
+    while (flag) {
+        uint32_t chunk;
+        if (status.MPI_SOURCE != link->master) {
+            // The new master's TAG_TAKEOVER was sent first; take it now
+            MPI_Probe(status.MPI_SOURCE, TAG_TAKEOVER, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            follow_takeover(link);
+            continue;
+        }
+        MPI_Recv(&chunk, 1, MPI_UINT32_T, status.MPI_SOURCE, TAG_RESEND, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        if (chunk < NUM_CHUNKS) upload_enqueue(link, chunk);
+        MPI_Iprobe(MPI_ANY_SOURCE, TAG_RESEND, MPI_COMM_WORLD, &flag, &status);
+    }
+    upload_progress(link);
+}
+
+// Appends a result to the spill file and queues it for upload
+void spill_result(SlaveLink* link, uint32_t chunk, const unsigned char* result, uint32_t size) {
+    upload_progress(link);
+    if (link->offset[chunk] < 0) {
+        // Size, then the result as it is sent (chunk id first)
+        if (write(link->fd, &size, sizeof(size)) != sizeof(size) ||
+            write(link->fd, result, size) != (ssize_t)size) {
+            perror(link->path);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        link->offset[chunk] = link->end;
+        link->end += sizeof(size) + size;
+    }
+    link->results++;
+    if (link->request != MPI_REQUEST_NULL) link->spilled++;   // has to wait its turn
+    upload_enqueue(link, chunk);
+    upload_progress(link);
+}
+
+void send_progress(SlaveLink* link, const ProgressMsg* msg) {
+    MPI_Send(msg, sizeof(*msg), MPI_BYTE, link->master, TAG_PROGRESS, MPI_COMM_WORLD);
+    link->last_report = *msg;
+    link->last_report_time = MPI_Wtime();
+}
+
+int uploads_pending(const SlaveLink* link) {
+    return link->request != MPI_REQUEST_NULL || link->count > 0;
+}
+
+void slave_link_close(SlaveLink* link) {
+    MPI_Wait(&link->request, MPI_STATUS_IGNORE);
+    MPI_Wait(&link->stale, MPI_STATUS_IGNORE);
+    bufpool_put(link->buf);
+    bufpool_put(link->stale_buf);
+    close(link->fd);
+    unlink(link->path);
+}
+
 // Slave-side function: spawns threads to process the chunk of data in parallel
-void process_data_multithreaded(int rank, int data[], int data_size) {
+void process_data_multithreaded(SlaveLink* link, uint32_t chunk, int data[], int data_size) {
+    int rank = link->rank;
     printf("Slave %d: Spawning %d threads to process data.\n", rank, NUM_THREADS);
 
+    // Shared aggregate and the lock that protects it
+    SlaveAggregate aggregate;
+    int lock_kind = lock_kind_parse(getenv("LAB3_LOCK"));
+    lock_init(&aggregate.lock, lock_kind >= 0 ? (LockKind)lock_kind : DEFAULT_SLAVE_LOCK);
+    aggregate.sum = 0;
+    aggregate.processed = 0;
+
     // Create and launch threads
     pthread_t threads[NUM_THREADS];
     ThreadTask tasks[NUM_THREADS];
+    ProgressSlot progress[NUM_THREADS];
+
+    const char* slow_rank = getenv("LAB3_SLOW_RANK");
+    int batch_delay_us = (slow_rank != NULL && atoi(slow_rank) == rank) ? SLOW_RANK_DELAY_US : 0;
 
     int chunk_per_thread = data_size / NUM_THREADS;
     for (int t = 0; t < NUM_THREADS; t++) {
         tasks[t].thread_id = t;
         tasks[t].rank = rank;
         tasks[t].data = data;
+        tasks[t].aggregate = &aggregate;
         tasks[t].start_idx = t * chunk_per_thread;
         
         // Last thread may go to the end in case data_size % NUM_THREADS != 0
@@ -61,179 +411,641 @@ void process_data_multithreaded(int rank, int data[], int data_size) {
             tasks[t].end_idx = (t + 1) * chunk_per_thread;
         }
 
+        atomic_init(&progress[t].done, 0);
+        progress[t].total = tasks[t].end_idx - tasks[t].start_idx;
+        tasks[t].progress = &progress[t];
+        tasks[t].batch_delay_us = batch_delay_us;
+
         pthread_create(&threads[t], NULL, thread_process, &tasks[t]);
     }
 
+    // While the threads work, this (MPI) thread samples their counters and
+    // reports to the master, and keeps the uploads of earlier results going.
+    // The last report ("finished") is left to the caller: it frees the slave
+    // for the next chunk, so it goes out once the result is taken care of.
+    ProgressMsg msg = { .chunk = chunk };
+    double next_report = 0.0;
+    for (;;) {
+        slave_poll(link);               // reports go to whoever is master now
+        sample_progress(progress, &msg);
+        if (msg.finished) break;
+        if (MPI_Wtime() >= next_report) {
+            send_progress(link, &msg);
+            next_report = link->last_report_time + PROGRESS_INTERVAL_MS / 1000.0;
+        }
+        usleep(UPLOAD_POLL_MS * 1000);
+    }
+    link->last_report = msg;
+
     // Wait for all threads to finish
     for (int t = 0; t < NUM_THREADS; t++) {
         pthread_join(threads[t], NULL);
     }
 
-    printf("Slave %d: All threads completed processing.\n", rank);
+    printf("Slave %d: All threads completed processing (%ld elements, sum %lld, %s lock).\n",
+           rank, aggregate.processed, aggregate.sum, lock_kind_name(aggregate.lock.kind));
+    lock_destroy(&aggregate.lock);
 }
 
-int main(int argc, char** argv) {
-    int rank, size;
-    // Each slave processes CHUNK_SIZE elements, but we split among threads
-    int data[CHUNK_SIZE];
+// Master side: receive every progress report that has arrived so far. A
+// report about another chunk than the current one only shows the slave is alive.
+void drain_progress(SlaveProgress view[], const JobState* job) {
+    int flag;
+    MPI_Status status;
+    MPI_Iprobe(MPI_ANY_SOURCE, TAG_PROGRESS, MPI_COMM_WORLD, &flag, &status);
+    while (flag) {
+        SlaveProgress* p = &view[status.MPI_SOURCE];
+        ProgressMsg msg;
+        MPI_Recv(&msg, sizeof(msg), MPI_BYTE, status.MPI_SOURCE, TAG_PROGRESS,
+                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
 
-    MPI_Init(&argc, &argv);
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
+        double now = MPI_Wtime();
+        p->last_heard = now;
+        if ((int)msg.chunk == job->current[status.MPI_SOURCE]) {
+            if (p->reports == 0) {
+                p->first_permille = msg.permille;
+                p->first_time = now;
+            }
+            if (p->reports == 0 || msg.permille > p->last.permille) p->last_advance = now;
+            p->last = msg;
+            p->last_time = now;
+            p->reports++;
+        }
 
-    // Track node failures
-    int failed_nodes[size];
-    for (int i = 0; i < size; ++i) {
-        failed_nodes[i] = 0; // 0 -> alive, 1 -> failed
+        MPI_Iprobe(MPI_ANY_SOURCE, TAG_PROGRESS, MPI_COMM_WORLD, &flag, &status);
     }
-    int num_failed_nodes = 0;
+}
 
-    if (rank == 0) {
-        // ---------------- Master Node ----------------
-        printf("Master: Distributing work to slaves...\n");
+// Seconds until the slave finishes, from its progress rate; -1 if unknown
+double progress_eta(const SlaveProgress* p) {
+    if (p->finish_time > 0 || p->last.finished) return 0.0;
+    double dt = p->last_time - p->first_time;
+    int advanced = p->last.permille - p->first_permille;
+    if (p->reports < 2 || dt <= 0 || advanced <= 0) return -1.0;
+    return (1000 - p->last.permille) * dt / advanced;
+}
 
-        // Full dataset
-        int full_data[DATA_SIZE];
-        for (int i = 0; i < DATA_SIZE; i++) {
-            full_data[i] = i;
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Time a slave needs for its current chunk (elapsed + ETA), or the time it
+// needed for its last one; -1 if unknown
+double chunk_duration(const SlaveProgress* p, double now) {
+    if (p->finish_time > 0) return p->finish_time - p->chunk_start;
+    double eta = progress_eta(p);
+    return eta < 0 ? -1.0 : now + eta - p->chunk_start;
+}
+
+// Flag slaves that will take much longer for their chunk than the others
+void detect_stragglers(SlaveProgress view[], const JobState* job, int size, int first_slave) {
+    double now = MPI_Wtime();
+    double duration[size];
+    int known = 0;
+    for (int i = first_slave; i < size; i++) {
+        if (job->failed[i]) continue;
+        double d = chunk_duration(&view[i], now);
+        if (d >= 0) duration[known++] = d;
+    }
+    if (known < 2) return;
+    qsort(duration, known, sizeof(double), compare_double);
+    double median = duration[(known - 1) / 2];
+
+    for (int i = first_slave; i < size; i++) {
+        double eta = progress_eta(&view[i]);
+        if (job->failed[i] || job->current[i] < 0 || view[i].straggler || eta <= 0) continue;
+        if (chunk_duration(&view[i], now) > STRAGGLER_FACTOR * median) {
+            view[i].straggler = 1;
+            printf("Master: slave %d is a straggler (%.1f%% of chunk %d done, ETA %.1fs, median chunk %.1fs).\n",
+                   i, view[i].last.permille / 10.0, job->current[i], eta, median);
         }
+    }
+}
 
-        // Distribute initial work to slaves
-        int chunk_index = 0;
-        for (int i = 1; i < size; i++) {
-            if (failed_nodes[i] == 0) {
-                // Compress the sub-chunk
-                unsigned char compressed_data[CHUNK_SIZE + 100];
-                uLongf compressed_size = sizeof(compressed_data);
+// Chunks the slave has finished whose result has not arrived yet
+int results_owed(const JobState* job, int slave) {
+    int n = 0;
+    for (int c = 0; c < NUM_CHUNKS; c++) n += job->owner[c] == slave && job->current[slave] != c;
+    return n;
+}
 
-                compress(compressed_data, &compressed_size,
-                         (const Bytef*)&full_data[chunk_index * CHUNK_SIZE],
-                         CHUNK_SIZE * sizeof(int)); // note: multiply for bytes
+void print_progress_view(const SlaveProgress view[], const JobState* job, int size, int first_slave) {
+    printf("Master: progress view (%d of %d chunks done)\n", job->done, NUM_CHUNKS);
+    for (int i = first_slave; i < size; i++) {
+        const SlaveProgress* p = &view[i];
+        char owed[48] = "";
+        int n = results_owed(job, i);
+        if (n > 0) snprintf(owed, sizeof(owed), ", %d result(s) not received yet", n);
+        if (job->failed[i]) {
+            printf("  slave %d: failed\n", i);
+        } else if (job->current[i] < 0) {
+            printf("  slave %d: idle%s\n", i, owed);
+        } else if (p->reports == 0) {
+            printf("  slave %d: chunk %d, no report yet%s\n", i, job->current[i], owed);
+        } else {
+            printf("  slave %d: chunk %d %5.1f%% [threads", i, job->current[i], p->last.permille / 10.0);
+            for (int t = 0; t < NUM_THREADS; t++) printf(" %3d%%", p->last.thread_pct[t]);
+            double eta = progress_eta(p);
+            if (eta >= 0) printf("] ETA %.1fs%s%s\n", eta, p->straggler ? " (straggler)" : "", owed);
+            else printf("] ETA ?%s%s\n", p->straggler ? " (straggler)" : "", owed);
+        }
+    }
+}
 
-                // Non-blocking send
-                MPI_Request request;
-                MPI_Isend(compressed_data, compressed_size, MPI_UNSIGNED_CHAR,
-                          i, 0, MPI_COMM_WORLD, &request);
-                // Wait for send to complete before overwriting buffer
-                MPI_Wait(&request, MPI_STATUS_IGNORE);
+// Applies one log record to the scheduling state (master and standby)
+void job_apply(JobState* job, const LogRecord* r) {
+    switch (r->type) {
+    case LOG_ASSIGN:
+        job->owner[r->chunk] = r->slave;
+        job->assignments[r->chunk]++;
+        job->current[r->slave] = r->chunk;
+        break;
+    case LOG_FINISHED:
+        if (job->current[r->slave] == (int)r->chunk) job->current[r->slave] = -1;
+        break;
+    case LOG_COMPLETE:
+        if (job->owner[r->chunk] != CHUNK_DONE) job->done++;
+        job->owner[r->chunk] = CHUNK_DONE;
+        if (job->current[r->slave] == (int)r->chunk) job->current[r->slave] = -1;
+        break;
+    case LOG_FAILED:
+        // Its current chunk and the results it had not uploaded are lost
+        job->failed[r->slave] = 1;
+        for (int c = 0; c < NUM_CHUNKS; c++) {
+            if (job->owner[c] == r->slave) job->owner[c] = CHUNK_PENDING;
+        }
+        job->current[r->slave] = -1;
+        break;
+    }
+}
 
-                chunk_index++;
+// Sends the buffered records to the standby; a heartbeat record if there are none
+void log_flush(ReplicationLog* log) {
+    if (log->standby < 0) return;
+    if (log->n == 0) log->rec[log->n++] = (LogRecord){ .type = LOG_HEARTBEAT };
+    MPI_Send(log->rec, log->n * sizeof(LogRecord), MPI_BYTE, log->standby, TAG_LOG, MPI_COMM_WORLD);
+    log->n = 0;
+    log->last_flush = MPI_Wtime();
+}
+
+// Master side: every scheduling decision goes through here
+void job_record(JobState* job, ReplicationLog* log, int type, int chunk, int slave) {
+    LogRecord r = { .type = (uint8_t)type, .slave = (uint16_t)slave, .chunk = (uint32_t)chunk };
+    job_apply(job, &r);
+    if (log->standby < 0) return;
+    if (log->n == LOG_BATCH) log_flush(log);
+    log->rec[log->n++] = r;
+}
 
-                // Measure overhead (approximate)
-                int bytes_sent;
-                MPI_Pack_size(CHUNK_SIZE, MPI_INT, MPI_COMM_WORLD, &bytes_sent);
-                printf("Master: sent ~%d bytes to slave %d.\n", bytes_sent, i);
+int next_pending_chunk(const JobState* job) {
+    for (int c = 0; c < NUM_CHUNKS; c++) {
+        if (job->owner[c] == CHUNK_PENDING) return c;
+    }
+    return -1;
+}
+
+// Compresses chunk 'chunk' of the input and sends it to 'slave'
+void send_chunk(const int full_data[], int chunk, int slave) {
+    unsigned char* compressed_data = bufpool_get(MESSAGE_SIZE);
+    uLongf compressed_size = MESSAGE_SIZE - CHUNK_HEADER;
+    uint32_t id = chunk;
+    memcpy(compressed_data, &id, CHUNK_HEADER);
+
+    bufpool_compress(compressed_data + CHUNK_HEADER, &compressed_size,
+                     (const Bytef*)&full_data[chunk * CHUNK_SIZE],
+                     CHUNK_BYTES); // note: multiply for bytes
+
+    // Non-blocking send; the buffer goes back to the pool once it completes
+    MPI_Request request;
+    MPI_Isend(compressed_data, compressed_size + CHUNK_HEADER, MPI_UNSIGNED_CHAR,
+              slave, TAG_DATA, MPI_COMM_WORLD, &request);
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+    bufpool_put(compressed_data);
+
+    // Measure overhead (approximate)
+    int bytes_sent;
+    MPI_Pack_size(CHUNK_SIZE, MPI_INT, MPI_COMM_WORLD, &bytes_sent);
+    printf("Master: sent chunk %d (~%d bytes) to slave %d.\n", chunk, bytes_sent, slave);
+}
+
+// A master that "crashed" (LAB3_MASTER_FAIL_AFTER). MPI aborts the whole job
+// when a rank exits, so the process stays alive but takes no part in the job
+// until the new master ends it. Then it drops what was sent to it.
+void play_dead(MPI_Request recv_requests[], int size) {
+    int flag = 0;
+    MPI_Status status;
+    while (!flag) {
+        MPI_Iprobe(MPI_ANY_SOURCE, TAG_SHUTDOWN, MPI_COMM_WORLD, &flag, &status);
+        if (!flag) usleep(10000);
+    }
+    MPI_Recv(NULL, 0, MPI_BYTE, status.MPI_SOURCE, TAG_SHUTDOWN, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    for (int i = 0; i < size; i++) {
+        if (recv_requests[i] == MPI_REQUEST_NULL) continue;
+        MPI_Cancel(&recv_requests[i]);
+        MPI_Wait(&recv_requests[i], MPI_STATUS_IGNORE);
+    }
+    MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
+    while (flag) {
+        int bytes;
+        MPI_Get_count(&status, MPI_BYTE, &bytes);
+        void* scratch = malloc(bytes > 0 ? bytes : 1);
+        MPI_Recv(scratch, bytes, MPI_BYTE, status.MPI_SOURCE, status.MPI_TAG, MPI_COMM_WORLD,
+                 MPI_STATUS_IGNORE);
+        free(scratch);
+        MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
+    }
+}
+
+// Runs the job until every chunk is done. Rank 0 starts with an empty state;
+// a standby that takes over starts with the state rebuilt from the log.
+// Returns 1 if the master simulated a crash, 0 otherwise.
+int run_master(int rank, int size, int first_slave, JobState* job, ReplicationLog* log,
+               const int full_data[], int fail_after, double stall) {
+    // Receive processed data (or detect failures). One receive stays posted
+    // for every live slave; while they are pending the master reads progress
+    // reports. A slave gets its next chunk as soon as it reports the current
+    // one finished; its results arrive in the background. It is deemed failed
+    // when it has made no progress for HEARTBEAT_TIMEOUT seconds, or has not
+    // been heard from for that long while it owes results, so a slow but
+    // working slave survives.
+    unsigned char* received_compressed_data[size];
+    MPI_Request recv_requests[size];
+    SlaveProgress view[size];
+    double sent_at[NUM_CHUNKS] = { 0 };
+    memset(view, 0, sizeof(view));
+    MPI_Status status;
+
+    double start = MPI_Wtime();
+    int receiving = stall <= 0;     // LAB3_MASTER_STALL: no receives posted yet
+    int live_slaves = 0;
+    for (int i = 0; i < size; i++) {
+        recv_requests[i] = MPI_REQUEST_NULL;
+        received_compressed_data[i] = NULL;
+        view[i].last_advance = view[i].last_heard = view[i].chunk_start = start;
+        if (i >= first_slave && !job->failed[i]) {
+            if (receiving) {
+                received_compressed_data[i] = bufpool_get(MESSAGE_SIZE);
+                MPI_Irecv(received_compressed_data[i], MESSAGE_SIZE,
+                          MPI_UNSIGNED_CHAR, i, TAG_DATA, MPI_COMM_WORLD, &recv_requests[i]);
             }
+            live_slaves++;
         }
+    }
+    if (!receiving) printf("Master: receiving no results for %.1fs.\n", stall);
 
-        // Receive processed data (or detect failures)
-        int received_data[CHUNK_SIZE];
-        unsigned char received_compressed_data[CHUNK_SIZE + 100];
-        MPI_Status status;
+    double last_print = start;
+    while (job->done < NUM_CHUNKS) {
+        if (fail_after >= 0 && job->done >= fail_after) {
+            printf("Master: simulating a crash after %d completed chunks (t=%.3f).\n",
+                   job->done, MPI_Wtime());
+            play_dead(recv_requests, size);
+            for (int i = 0; i < size; i++) bufpool_put(received_compressed_data[i]);
+            return 1;
+        }
+        if (!receiving && MPI_Wtime() - start >= stall) {
+            receiving = 1;
+            printf("Master: receiving results again (t=%.3f).\n", MPI_Wtime());
+            for (int i = first_slave; i < size; i++) {
+                if (job->failed[i]) continue;
+                received_compressed_data[i] = bufpool_get(MESSAGE_SIZE);
+                MPI_Irecv(received_compressed_data[i], MESSAGE_SIZE,
+                          MPI_UNSIGNED_CHAR, i, TAG_DATA, MPI_COMM_WORLD, &recv_requests[i]);
+            }
+        }
 
-        for (int i = 1; i < size; i++) {
-            if (failed_nodes[i] == 0) {
-                MPI_Request recv_request;
-                MPI_Irecv(received_compressed_data, sizeof(received_compressed_data),
-                          MPI_UNSIGNED_CHAR, i, 0, MPI_COMM_WORLD, &recv_request);
-
-                // Heartbeat-based timeout
-                int flag = 0;
-                double start_time = MPI_Wtime();
-                while (!flag && (MPI_Wtime() - start_time) < HEARTBEAT_TIMEOUT) {
-                    MPI_Test(&recv_request, &flag, &status);
-                    usleep(10000); // 10ms
-                }
+        // Hand a pending chunk to every idle slave. The assignment reaches the
+        // standby before the chunk reaches the slave (write-ahead).
+        for (int i = first_slave; i < size; i++) {
+            if (job->failed[i] || job->current[i] >= 0) continue;
+            int chunk = next_pending_chunk(job);
+            if (chunk < 0) break;
+            job_record(job, log, LOG_ASSIGN, chunk, i);
+            log_flush(log);
+            memset(&view[i], 0, sizeof(view[i]));
+            view[i].last_advance = view[i].last_heard = view[i].chunk_start = sent_at[chunk] = MPI_Wtime();
+            send_chunk(full_data, chunk, i);
+        }
+        if (live_slaves == 0) {
+            printf("Master: No slaves left, %d of %d chunks unfinished.\n",
+                   NUM_CHUNKS - job->done, NUM_CHUNKS);
+            break;
+        }
+
+        drain_progress(view, job);
+
+        for (int i = first_slave; i < size; i++) {
+            if (job->failed[i]) continue;
 
-                if (flag) {
+            // A slave that has finished its chunk is free for the next one
+            if (job->current[i] >= 0 && view[i].reports > 0 && view[i].last.finished) {
+                view[i].finish_time = view[i].last_time;
+                job_record(job, log, LOG_FINISHED, job->current[i], i);
+            }
+
+            int flag = 0;
+            if (recv_requests[i] != MPI_REQUEST_NULL) MPI_Test(&recv_requests[i], &flag, &status);
+            if (flag) {
+                int received_size;
+                uint32_t chunk;
+                MPI_Get_count(&status, MPI_UNSIGNED_CHAR, &received_size);
+                memcpy(&chunk, received_compressed_data[i], CHUNK_HEADER);
+                view[i].last_heard = MPI_Wtime();
+                if (chunk < NUM_CHUNKS && job->owner[chunk] != CHUNK_DONE) {
                     // Data arrived in time
-                    uLongf uncompressed_size = CHUNK_SIZE * sizeof(int);
-                    uncompress((Bytef*)received_data, &uncompressed_size,
-                               received_compressed_data, status.count);
+                    int* received_data = bufpool_get(CHUNK_BYTES);
+                    uLongf uncompressed_size = CHUNK_BYTES;
+                    bufpool_uncompress((Bytef*)received_data, &uncompressed_size,
+                                       received_compressed_data[i] + CHUNK_HEADER, received_size - CHUNK_HEADER);
+                    bufpool_put(received_data);
+                    job_record(job, log, LOG_COMPLETE, chunk, i);
+                    if (sent_at[chunk] > 0) {
+                        printf("Master: Received processed chunk %u from slave %d (%.2fs after sending it).\n",
+                               chunk, i, MPI_Wtime() - sent_at[chunk]);
+                    } else {
+                        printf("Master: Received processed chunk %u from slave %d (sent by the old master).\n",
+                               chunk, i);
+                    }
+                } else {
+                    // Sent again after a takeover: results are idempotent by chunk id
+                    printf("Master: Dropped duplicate result for chunk %u from slave %d.\n", chunk, i);
+                }
+                MPI_Irecv(received_compressed_data[i], MESSAGE_SIZE,
+                          MPI_UNSIGNED_CHAR, i, TAG_DATA, MPI_COMM_WORLD, &recv_requests[i]);
+                // LAB3_MASTER_FAIL_AFTER: take no more results, crash at exactly n
+                if (fail_after >= 0 && job->done >= fail_after) break;
+                continue;
+            }
 
-                    printf("Master: Received processed chunk from slave %d.\n", i);
+            double now = MPI_Wtime();
+            int stuck = job->current[i] >= 0 && now - view[i].last_advance > HEARTBEAT_TIMEOUT;
+            int silent = receiving && results_owed(job, i) > 0 && now - view[i].last_heard > HEARTBEAT_TIMEOUT;
+            if (stuck || silent) {
+                // Node is deemed failed; its chunks go back to the pending ones
+                if (stuck) {
+                    printf("Slave %d failed! (no progress for %d s, last at %.1f%% of chunk %d)\n",
+                           i, HEARTBEAT_TIMEOUT, view[i].last.permille / 10.0, job->current[i]);
                 } else {
-                    // Node is deemed failed
-                    failed_nodes[i] = 1;
-                    num_failed_nodes++;
-                    printf("Slave %d failed! (Heartbeat Timeout)\n", i);
+                    printf("Slave %d failed! (not heard from for %d s, %d result(s) not received)\n",
+                           i, HEARTBEAT_TIMEOUT, results_owed(job, i));
+                }
+                job_record(job, log, LOG_FAILED, job->current[i], i);
+                live_slaves--;
 
-                    MPI_Cancel(&recv_request);
-                    MPI_Request_free(&recv_request);
+                if (recv_requests[i] != MPI_REQUEST_NULL) {
+                    // The buffer stays out of the pool: MPI may still write to it
+                    MPI_Cancel(&recv_requests[i]);
+                    MPI_Request_free(&recv_requests[i]);
+                    received_compressed_data[i] = NULL;
                 }
             }
         }
 
-        // If any slaves failed, attempt a simple redistribution
-        if (num_failed_nodes > 0) {
-            printf("Master: Redistributing workload due to node failures.\n");
-            int active_slaves = size - 1 - num_failed_nodes;
+        detect_stragglers(view, job, size, first_slave);
+        if (MPI_Wtime() - last_print >= PROGRESS_PRINT_INTERVAL) {
+            print_progress_view(view, job, size, first_slave);
+            last_print = MPI_Wtime();
+        }
+        if (log->n > 0 || MPI_Wtime() - log->last_flush >= LOG_HEARTBEAT_INTERVAL) log_flush(log);
+        usleep(10000); // 10ms
+    }
+    drain_progress(view, job);  // final reports that arrived with the results
 
-            // For simplicity, we’ll just re-send the first chunk(s)
-            // In a real system, you'd track unprocessed chunks more carefully
-            chunk_index = 0;
-            for (int i = 1; i < size; i++) {
-                if (failed_nodes[i] == 0) {
-                    unsigned char compressed_data[CHUNK_SIZE + 100];
-                    uLongf compressed_size = sizeof(compressed_data);
+    for (int i = first_slave; i < size; i++) {
+        if (recv_requests[i] == MPI_REQUEST_NULL) continue;
+        MPI_Cancel(&recv_requests[i]);
+        MPI_Wait(&recv_requests[i], MPI_STATUS_IGNORE);
+    }
+    for (int i = 0; i < size; i++) bufpool_put(received_compressed_data[i]);
 
-                    compress(compressed_data, &compressed_size,
-                             (const Bytef*)&full_data[chunk_index * CHUNK_SIZE],
-                             CHUNK_SIZE * sizeof(int));
+    // The standby learns from the log that the job is over; everyone else,
+    // including a master that was taken over, gets TAG_SHUTDOWN
+    job_record(job, log, LOG_DONE, 0, rank);
+    log_flush(log);
+    for (int i = 0; i < size; i++) {
+        if (i != rank && i != log->standby) MPI_Send(NULL, 0, MPI_BYTE, i, TAG_SHUTDOWN, MPI_COMM_WORLD);
+    }
+    return 0;
+}
 
-                    MPI_Request request;
-                    MPI_Isend(compressed_data, compressed_size, MPI_UNSIGNED_CHAR,
-                              i, 0, MPI_COMM_WORLD, &request);
-                    MPI_Wait(&request, MPI_STATUS_IGNORE);
+// Follows the master's log; takes over the job when the master goes silent
+void run_standby(int rank, int size, int first_slave, JobState* job, const int full_data[]) {
+    LogRecord records[LOG_BATCH];
+    long applied = 0;
+    double last_heard = MPI_Wtime();
+    printf("Standby %d: Following the master's scheduling log.\n", rank);
 
-                    chunk_index++;
-                    if (chunk_index * CHUNK_SIZE >= DATA_SIZE) break;
+    for (;;) {
+        int flag;
+        MPI_Status status;
+        MPI_Iprobe(0, TAG_LOG, MPI_COMM_WORLD, &flag, &status);
+        if (flag) {
+            int bytes;
+            MPI_Get_count(&status, MPI_BYTE, &bytes);
+            MPI_Recv(records, sizeof(records), MPI_BYTE, 0, TAG_LOG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            for (int r = 0; r < bytes / (int)sizeof(LogRecord); r++) {
+                if (records[r].type == LOG_DONE) {
+                    printf("Standby %d: Master finished the job (%ld log records applied).\n",
+                           rank, applied);
+                    return;
                 }
+                job_apply(job, &records[r]);
+                if (records[r].type != LOG_HEARTBEAT) applied++;
             }
+            last_heard = MPI_Wtime();
+            continue;
         }
+        if (MPI_Wtime() - last_heard > MASTER_TIMEOUT) break;
+        usleep(1000);
+    }
 
-        printf("Master: All data processing (and re-distribution if needed) complete.\n");
+    // The master has failed: redirect every slave to this rank and carry on
+    // with the job as the log describes it
+    double detected = MPI_Wtime();
+    int in_flight = 0;
+    for (int c = 0; c < NUM_CHUNKS; c++) in_flight += job->owner[c] >= 0;
+    printf("Standby %d: No log record from the master for %.2fs (t=%.3f); taking over with "
+           "%d of %d chunks done and %d in flight.\n",
+           rank, detected - last_heard, detected, job->done, NUM_CHUNKS, in_flight);
+    for (int i = first_slave; i < size; i++) {
+        if (!job->failed[i]) MPI_Send(&rank, 1, MPI_INT, i, TAG_TAKEOVER, MPI_COMM_WORLD);
+    }
+    // Results the old master received but had not logged are lost with it:
+    // ask for every result still owed. A slave that has not finished the
+    // chunk yet ignores the request and uploads the result when it is ready.
+    int requested = 0;
+    for (int c = 0; c < NUM_CHUNKS; c++) {
+        if (job->owner[c] < 0 || job->failed[job->owner[c]]) continue;
+        uint32_t id = c;
+        MPI_Send(&id, 1, MPI_UINT32_T, job->owner[c], TAG_RESEND, MPI_COMM_WORLD);
+        requested++;
+    }
+    double redirected = MPI_Wtime();
 
-    } else {
-        // ---------------- Slave Nodes ----------------
-        // Non-blocking receive from master
-        unsigned char compressed_data[CHUNK_SIZE + 100];
-        MPI_Status status;
+    ReplicationLog no_standby = { .n = 0, .standby = -1 };
+    int done_before = job->done;
+    run_master(rank, size, first_slave, job, &no_standby, full_data, -1, 0.0);
+    double finished = MPI_Wtime();
+
+    int recomputed = 0;
+    for (int c = 0; c < NUM_CHUNKS; c++) recomputed += job->assignments[c] > 1 ? job->assignments[c] - 1 : 0;
+    printf("Standby %d: Takeover took %.3fs (%.3fs without a log record + %.2f ms to redirect the slaves). "
+           "Asked for %d owed results. Finished the remaining %d chunks %.2fs later; %d chunks were "
+           "computed twice.\n",
+           rank, redirected - last_heard, detected - last_heard, 1000 * (redirected - detected),
+           requested, NUM_CHUNKS - done_before, finished - redirected, recomputed);
+}
 
+void run_slave(int rank, int data[]) {
+    SlaveLink link;
+    slave_link_open(&link, rank);
+    const char* spill_env = getenv("LAB3_SPILL");
+    int wait_for_upload = spill_env != NULL && atoi(spill_env) == 0;
+    double blocked = 0.0;       // seconds spent waiting for uploads (LAB3_SPILL=0)
+    MPI_Status status;
+
+    for (;;) {
+        // Wait for a chunk or the end of the job; uploads go on meanwhile
+        int flag;
+        slave_poll(&link);
+        MPI_Iprobe(MPI_ANY_SOURCE, TAG_SHUTDOWN, MPI_COMM_WORLD, &flag, &status);
+        if (flag) {
+            MPI_Recv(NULL, 0, MPI_BYTE, status.MPI_SOURCE, TAG_SHUTDOWN, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            break;
+        }
+        // From any rank: a chunk the old master sent just before a takeover still counts
+        MPI_Iprobe(MPI_ANY_SOURCE, TAG_DATA, MPI_COMM_WORLD, &flag, &status);
+        if (!flag) {
+            if (uploads_pending(&link) && link.results > 0 &&
+                MPI_Wtime() - link.last_report_time >= PROGRESS_INTERVAL_MS / 1000.0) {
+                // Still alive, with results to deliver
+                send_progress(&link, &link.last_report);
+            }
+            usleep(1000);
+            continue;
+        }
+
+        // Non-blocking receive from master
+        unsigned char* compressed_data = bufpool_get(MESSAGE_SIZE);
         MPI_Request recv_request;
-        MPI_Irecv(compressed_data, sizeof(compressed_data), MPI_UNSIGNED_CHAR,
-                  0, 0, MPI_COMM_WORLD, &recv_request);
+        MPI_Irecv(compressed_data, MESSAGE_SIZE, MPI_UNSIGNED_CHAR,
+                  status.MPI_SOURCE, TAG_DATA, MPI_COMM_WORLD, &recv_request);
         MPI_Wait(&recv_request, &status);
 
         // Decompress
-        uLongf uncompressed_size = CHUNK_SIZE * sizeof(int);
-        uncompress((Bytef*)data, &uncompressed_size,
-                   compressed_data, status.count);
+        uint32_t chunk;
+        uLongf uncompressed_size = CHUNK_BYTES;
+        int received_size;
+        MPI_Get_count(&status, MPI_UNSIGNED_CHAR, &received_size);
+        memcpy(&chunk, compressed_data, CHUNK_HEADER);
+        bufpool_uncompress((Bytef*)data, &uncompressed_size,
+                           compressed_data + CHUNK_HEADER, received_size - CHUNK_HEADER);
+        bufpool_put(compressed_data);
 
-        printf("Slave %d: Received data, starting **multithreaded** processing...\n", rank);
+        printf("Slave %d: Received chunk %u, starting **multithreaded** processing...\n", rank, chunk);
 
         // Multithreaded processing
-        process_data_multithreaded(rank, data, CHUNK_SIZE);
+        process_data_multithreaded(&link, chunk, data, CHUNK_SIZE);
 
-        // Compress the processed data to send back
-        unsigned char compressed_data_send[CHUNK_SIZE + 100];
-        uLongf compressed_size_send = sizeof(compressed_data_send);
+        // Compress the processed data to send back, behind the chunk id
+        unsigned char* compressed_data_send = bufpool_get(MESSAGE_SIZE);
+        uLongf compressed_size_send = MESSAGE_SIZE - CHUNK_HEADER;
+        memcpy(compressed_data_send, &chunk, CHUNK_HEADER);
+        bufpool_compress(compressed_data_send + CHUNK_HEADER, &compressed_size_send,
+                         (const Bytef*)data, CHUNK_BYTES);
+
+        // Into the spill file; the upload to the master runs in the background
+        spill_result(&link, chunk, compressed_data_send, compressed_size_send + CHUNK_HEADER);
+        bufpool_put(compressed_data_send);
+        if (wait_for_upload) {
+            double t0 = MPI_Wtime();
+            while (uploads_pending(&link)) {
+                usleep(1000);
+                slave_poll(&link);
+            }
+            blocked += MPI_Wtime() - t0;
+        }
+        send_progress(&link, &link.last_report);    // finished: ready for the next chunk
+        printf("Slave %d: Result of chunk %u (%lu bytes) queued for master %d, %d upload(s) waiting.\n",
+               rank, chunk, (unsigned long)compressed_size_send + CHUNK_HEADER, link.master,
+               link.count + (link.request != MPI_REQUEST_NULL));
+    }
 
-        compress(compressed_data_send, &compressed_size_send,
-                 (const Bytef*)data, CHUNK_SIZE * sizeof(int));
+    printf("Slave %d: %d results, %d of them spilled while an upload was in flight; "
+           "%.2fs waiting for uploads.\n", rank, link.results, link.spilled, blocked);
+    slave_link_close(&link);
+}
 
-        // Send result back to master
-        MPI_Request send_request;
-        MPI_Isend(compressed_data_send, compressed_size_send, MPI_UNSIGNED_CHAR,
-                  0, 0, MPI_COMM_WORLD, &send_request);
-        MPI_Wait(&send_request, MPI_STATUS_IGNORE);
+int main(int argc, char** argv) {
+    int rank, size;
+    // Each slave processes CHUNK_SIZE elements, but we split among threads
+    int data[CHUNK_SIZE];
 
-        // Approximate overhead
-        int bytes_sent;
-        MPI_Pack_size(CHUNK_SIZE, MPI_INT, MPI_COMM_WORLD, &bytes_sent);
-        printf("Slave %d: Sent ~%d bytes back to master.\n", rank, bytes_sent);
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    bufpool_init();
+
+    // Track node failures
+    int failed_nodes[size];
+    int current_chunk[size];
+    for (int i = 0; i < size; ++i) {
+        failed_nodes[i] = 0; // 0 -> alive, 1 -> failed
+        current_chunk[i] = -1;
+    }
+
+    // With a hot standby, rank 1 follows the master and the slaves start at rank 2
+    const char* standby_env = getenv("LAB3_STANDBY");
+    int standby = (standby_env != NULL && atoi(standby_env) != 0 && size >= 3) ? STANDBY_RANK : -1;
+    int first_slave = standby >= 0 ? standby + 1 : 1;
+
+    JobState job = { .current = current_chunk, .failed = failed_nodes, .done = 0 };
+    for (int c = 0; c < NUM_CHUNKS; c++) {
+        job.owner[c] = CHUNK_PENDING;
+        job.assignments[c] = 0;
+    }
+
+    if (rank == 0 || rank == standby) {
+        // ---------------- Master Node (and its standby) ----------------
+        // Full dataset; the standby has it too, so it can hand out chunks
+        int full_data[DATA_SIZE];
+        for (int i = 0; i < DATA_SIZE; i++) {
+            full_data[i] = i;
+        }
+
+        // Working set: a receive buffer per slave, plus one to send a chunk
+        // and one to decompress a result into (both of the same size class)
+        bufpool_reserve(MESSAGE_SIZE, size - first_slave + 2);
+
+        if (rank == standby) {
+            run_standby(rank, size, first_slave, &job, full_data);
+        } else {
+            printf("Master: Distributing %d chunks to slaves%s...\n", NUM_CHUNKS,
+                   standby >= 0 ? " (hot standby on rank 1)" : "");
+            // Only with a standby: without one, nobody would ever end the job
+            const char* fail_env = standby >= 0 ? getenv("LAB3_MASTER_FAIL_AFTER") : NULL;
+            const char* stall_env = getenv("LAB3_MASTER_STALL");
+            ReplicationLog log = { .n = 0, .standby = standby, .last_flush = MPI_Wtime() };
+            double t0 = MPI_Wtime();
+            if (run_master(rank, size, first_slave, &job, &log, full_data,
+                           fail_env != NULL ? atoi(fail_env) : -1,
+                           stall_env != NULL ? atof(stall_env) : 0.0) == 0) {
+                printf("Master: Job took %.2fs.\n", MPI_Wtime() - t0);
+                printf("Master: All data processing (and re-distribution if needed) complete.\n");
+            }
+        }
+    } else {
+        // ---------------- Slave Nodes ----------------
+        // Working set: the chunk received, the result, the upload in flight
+        // and one upload stranded by a takeover
+        bufpool_reserve(MESSAGE_SIZE, 4);
+        run_slave(rank, data);
     }
 
+    char who[32];
+    snprintf(who, sizeof(who), rank == 0 ? "Master" : rank == standby ? "Standby %d" : "Slave %d", rank);
+    bufpool_report(who);
+    bufpool_destroy();
     MPI_Finalize();
     return 0;
 }
@@ -0,0 +1,112 @@
+// lock_bench.c
+// Throughput of the locks in locks.h under contention.
+//
+// Each thread repeatedly: acquires the lock, runs a critical section of
+// <cs_len> dependent updates to shared data, releases, then does <cs_len>
+// units of private work. Threads are swept 1..N and critical-section
+// lengths over a few sizes.
+//
+// Output is CSV:
+//   lock,threads,cs_len,ops,time_s,ops_per_s,correct
+//
+// Compile: gcc -O2 -o lock_bench lock_bench.c -lpthread
+// Run:     ./lock_bench <max_threads> [seconds_per_point] > locks.csv
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "locks.h"
+
+#define MAX_THREADS 256
+
+static const int cs_lengths[] = { 0, 10, 100, 1000 };
+
+typedef struct {
+    Lock*          lock;
+    volatile long* shared;      // protected by lock
+    int            cs_len;
+    volatile int*  stop;
+    long           ops;         // acquisitions done by this thread
+    char           pad[64];
+} BenchThread;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void* bench_thread(void* arg) {
+    BenchThread* b = (BenchThread*) arg;
+    volatile long private_work = 0;
+    long ops = 0;
+
+    while (!*b->stop) {
+        lock_acquire(b->lock);
+        b->shared[0]++;                         // counts acquisitions
+        for (int i = 0; i < b->cs_len; i++) b->shared[1] += i;
+        lock_release(b->lock);
+
+        for (int i = 0; i < b->cs_len; i++) private_work += i;
+        ops++;
+    }
+    b->ops = ops;
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <max_threads> [seconds_per_point]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    int    max_threads = atoi(argv[1]);
+    double seconds     = argc > 2 ? atof(argv[2]) : 0.2;
+    if (max_threads <= 0 || max_threads > MAX_THREADS || seconds <= 0) {
+        fprintf(stderr, "Error: 1 <= max_threads <= %d and seconds > 0 required.\n", MAX_THREADS);
+        return EXIT_FAILURE;
+    }
+
+    pthread_t   threads[MAX_THREADS];
+    BenchThread tasks[MAX_THREADS];
+    int         all_ok = 1;
+
+    printf("lock,threads,cs_len,ops,time_s,ops_per_s,correct\n");
+    for (int k = 0; k < LOCK_KIND_COUNT; k++) {
+        for (size_t c = 0; c < sizeof(cs_lengths) / sizeof(cs_lengths[0]); c++) {
+            for (int p = 1; p <= max_threads; p++) {
+                Lock          lock;
+                volatile long shared[2] = {0, 0};
+                volatile int  stop = 0;
+                lock_init(&lock, (LockKind) k);
+
+                double t0 = now_sec();
+                for (int t = 0; t < p; t++) {
+                    tasks[t] = (BenchThread){ &lock, shared, cs_lengths[c], &stop, 0, {0} };
+                    pthread_create(&threads[t], NULL, bench_thread, &tasks[t]);
+                }
+                struct timespec ts = { (time_t) seconds,
+                                       (long) ((seconds - (time_t) seconds) * 1e9) };
+                nanosleep(&ts, NULL);
+                stop = 1;
+
+                long ops = 0;
+                for (int t = 0; t < p; t++) {
+                    pthread_join(threads[t], NULL);
+                    ops += tasks[t].ops;
+                }
+                double dt = now_sec() - t0;
+                lock_destroy(&lock);
+
+                // Every acquisition incremented shared[0] exactly once
+                int ok = shared[0] == ops;
+                all_ok &= ok;
+                printf("%s,%d,%d,%ld,%.4f,%.4e,%s\n", lock_kind_name((LockKind) k),
+                       p, cs_lengths[c], ops, dt, ops / dt, ok ? "yes" : "NO");
+                fflush(stdout);
+            }
+        }
+    }
+    return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
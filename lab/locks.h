@@ -0,0 +1,254 @@
+// locks.h
+// Small lock library for Lab 3: one interface, five lock algorithms.
+//
+//   LOCK_PTHREAD    plain pthread_mutex_t (the Lab 3 default)
+//   LOCK_TTAS       test-and-test-and-set spinlock with exponential backoff
+//   LOCK_TICKET     FIFO ticket lock with backoff proportional to queue position
+//   LOCK_MCS        MCS queue lock: each waiter spins on its OWN cache line
+//   LOCK_SPIN_PARK  spin briefly, then sleep in the kernel (Linux futex)
+//
+// Usage:
+//   Lock l;
+//   lock_init(&l, LOCK_MCS);
+//   lock_acquire(&l);  ... critical section ...  lock_release(&l);
+//   lock_destroy(&l);
+//
+// MCS needs a queue node per waiting thread; nodes come from a small
+// thread-local stack, so a thread may hold up to LOCK_MCS_MAX_NESTED MCS
+// locks at once and must release them in reverse order.
+//
+// Header-only: just #include "locks.h" and link with -lpthread.
+
+#ifndef LOCKS_H
+#define LOCKS_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <string.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define LOCK_CACHE_LINE      64
+#define LOCK_BACKOFF_MIN     4
+#define LOCK_BACKOFF_MAX     1024
+#define LOCK_SPIN_BEFORE_PARK 100
+#define LOCK_MCS_MAX_NESTED  8
+
+typedef enum {
+    LOCK_PTHREAD,
+    LOCK_TTAS,
+    LOCK_TICKET,
+    LOCK_MCS,
+    LOCK_SPIN_PARK,
+    LOCK_KIND_COUNT
+} LockKind;
+
+typedef struct McsNode {
+    _Atomic(struct McsNode*) next;
+    atomic_int               locked;
+    char                     pad[LOCK_CACHE_LINE - sizeof(void*) - sizeof(int)];
+} McsNode;
+
+typedef struct {
+    LockKind kind;
+    union {
+        pthread_mutex_t mutex;
+        atomic_int      flag;                 // TTAS: 0 free, 1 held
+        struct {
+            atomic_uint next;                 // next ticket to hand out
+            atomic_uint serving;              // ticket allowed in
+        } ticket;
+        _Atomic(McsNode*) tail;               // MCS: last waiter, NULL if free
+        atomic_int      state;                // SPIN_PARK: 0 free, 1 held, 2 held + waiters
+    } u;
+} __attribute__((aligned(LOCK_CACHE_LINE))) Lock;
+
+// -------------------------------------------------------------------------
+// Helpers
+// -------------------------------------------------------------------------
+static inline void lock_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+// Spin for 'n' pause instructions
+static inline void lock_backoff(unsigned n) {
+    for (unsigned i = 0; i < n; i++) lock_cpu_relax();
+}
+
+#ifdef __linux__
+static inline void lock_futex_wait(atomic_int* addr, int expected) {
+    syscall(SYS_futex, (int*) addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+static inline void lock_futex_wake_one(atomic_int* addr) {
+    syscall(SYS_futex, (int*) addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+#else
+// No futex: parking degrades to yielding the CPU
+static inline void lock_futex_wait(atomic_int* addr, int expected) {
+    (void) addr; (void) expected;
+    sched_yield();
+}
+static inline void lock_futex_wake_one(atomic_int* addr) { (void) addr; }
+#endif
+
+static __thread McsNode lock_mcs_nodes[LOCK_MCS_MAX_NESTED];
+static __thread int     lock_mcs_depth;
+
+static const char* const lock_kind_names[LOCK_KIND_COUNT] = {
+    "pthread", "ttas", "ticket", "mcs", "spin_park"
+};
+
+static inline const char* lock_kind_name(LockKind kind) {
+    return (kind >= 0 && kind < LOCK_KIND_COUNT) ? lock_kind_names[kind] : "unknown";
+}
+
+// Returns the kind for a name such as "mcs", or -1 if unknown
+static inline int lock_kind_parse(const char* name) {
+    for (int k = 0; k < LOCK_KIND_COUNT; k++)
+        if (name != NULL && strcmp(name, lock_kind_names[k]) == 0) return k;
+    return -1;
+}
+
+// -------------------------------------------------------------------------
+// Interface
+// -------------------------------------------------------------------------
+static inline void lock_init(Lock* l, LockKind kind) {
+    memset(l, 0, sizeof(*l));
+    l->kind = kind;
+    switch (kind) {
+    case LOCK_PTHREAD:   pthread_mutex_init(&l->u.mutex, NULL); break;
+    case LOCK_TTAS:      atomic_init(&l->u.flag, 0); break;
+    case LOCK_TICKET:    atomic_init(&l->u.ticket.next, 0);
+                         atomic_init(&l->u.ticket.serving, 0); break;
+    case LOCK_MCS:       atomic_init(&l->u.tail, NULL); break;
+    case LOCK_SPIN_PARK: atomic_init(&l->u.state, 0); break;
+    default: break;
+    }
+}
+
+static inline void lock_destroy(Lock* l) {
+    if (l->kind == LOCK_PTHREAD) pthread_mutex_destroy(&l->u.mutex);
+}
+
+static inline void lock_acquire(Lock* l) {
+    switch (l->kind) {
+    case LOCK_PTHREAD:
+        pthread_mutex_lock(&l->u.mutex);
+        break;
+
+    case LOCK_TTAS: {
+        // Spin on a plain load (stays in our cache) and only try the
+        // atomic exchange when the lock looks free; back off on failure.
+        unsigned delay = LOCK_BACKOFF_MIN;
+        for (;;) {
+            while (atomic_load_explicit(&l->u.flag, memory_order_relaxed))
+                lock_cpu_relax();
+            if (!atomic_exchange_explicit(&l->u.flag, 1, memory_order_acquire))
+                return;
+            lock_backoff(delay);
+            if (delay < LOCK_BACKOFF_MAX) delay *= 2;
+            else sched_yield();
+        }
+    }
+
+    case LOCK_TICKET: {
+        unsigned me = atomic_fetch_add_explicit(&l->u.ticket.next, 1, memory_order_relaxed);
+        for (;;) {
+            unsigned cur = atomic_load_explicit(&l->u.ticket.serving, memory_order_acquire);
+            if (cur == me) return;
+            // Wait roughly in proportion to the number of threads ahead of us
+            unsigned ahead = me - cur;
+            lock_backoff(ahead * LOCK_BACKOFF_MIN * 8);
+            if (ahead > 1) sched_yield();
+        }
+    }
+
+    case LOCK_MCS: {
+        McsNode* me = &lock_mcs_nodes[lock_mcs_depth++];
+        atomic_store_explicit(&me->next, NULL, memory_order_relaxed);
+        atomic_store_explicit(&me->locked, 1, memory_order_relaxed);
+        McsNode* prev = atomic_exchange_explicit(&l->u.tail, me, memory_order_acq_rel);
+        if (prev != NULL) {
+            atomic_store_explicit(&prev->next, me, memory_order_release);
+            unsigned spins = 0;
+            while (atomic_load_explicit(&me->locked, memory_order_acquire)) {
+                lock_cpu_relax();
+                if (++spins % LOCK_BACKOFF_MAX == 0) sched_yield();
+            }
+        }
+        return;
+    }
+
+    case LOCK_SPIN_PARK: {
+        // Spin a little: most critical sections are short
+        for (int i = 0; i < LOCK_SPIN_BEFORE_PARK; i++) {
+            int expected = 0;
+            if (atomic_compare_exchange_weak_explicit(&l->u.state, &expected, 1,
+                                                      memory_order_acquire,
+                                                      memory_order_relaxed))
+                return;
+            lock_cpu_relax();
+        }
+        // Then mark the lock contended (2) and sleep until it is released
+        while (atomic_exchange_explicit(&l->u.state, 2, memory_order_acquire) != 0)
+            lock_futex_wait(&l->u.state, 2);
+        return;
+    }
+
+    default:
+        break;
+    }
+}
+
+static inline void lock_release(Lock* l) {
+    switch (l->kind) {
+    case LOCK_PTHREAD:
+        pthread_mutex_unlock(&l->u.mutex);
+        break;
+
+    case LOCK_TTAS:
+        atomic_store_explicit(&l->u.flag, 0, memory_order_release);
+        break;
+
+    case LOCK_TICKET:
+        atomic_fetch_add_explicit(&l->u.ticket.serving, 1, memory_order_release);
+        break;
+
+    case LOCK_MCS: {
+        McsNode* me   = &lock_mcs_nodes[--lock_mcs_depth];
+        McsNode* next = atomic_load_explicit(&me->next, memory_order_acquire);
+        if (next == NULL) {
+            // No known successor: try to swing the tail back to empty
+            McsNode* expected = me;
+            if (atomic_compare_exchange_strong_explicit(&l->u.tail, &expected, NULL,
+                                                        memory_order_acq_rel,
+                                                        memory_order_acquire))
+                return;
+            // A successor is linking itself in; wait for it
+            while ((next = atomic_load_explicit(&me->next, memory_order_acquire)) == NULL)
+                lock_cpu_relax();
+        }
+        atomic_store_explicit(&next->locked, 0, memory_order_release);
+        break;
+    }
+
+    case LOCK_SPIN_PARK:
+        // Only pay for a system call if someone may be sleeping
+        if (atomic_exchange_explicit(&l->u.state, 0, memory_order_release) == 2)
+            lock_futex_wake_one(&l->u.state);
+        break;
+
+    default:
+        break;
+    }
+}
+
+#endif // LOCKS_H
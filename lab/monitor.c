@@ -0,0 +1,378 @@
+// monitor.c
+// Event-driven cluster monitor: a C replacement for MasterNode in lab1.py.
+//
+// lab1.py starts one Python thread per slave, reads with recv(1024) without
+// any framing, and every 5 s scans the whole slave dictionary under a global
+// lock. This daemon instead:
+//
+//   - runs ONE epoll loop per shard (default 1). With several shards each
+//     thread owns its own listening socket (SO_REUSEPORT: the kernel spreads
+//     new connections over them), its own epoll set and its own timer wheel,
+//     so the shards share nothing but statistics counters;
+//   - speaks length-prefixed binary frames (monitor_proto.h), including the
+//     batched telemetry frame of lab/telemetry.py, decoded in place into
+//     the node's connection state without any allocation;
+//   - keeps liveness in a timer wheel: a heartbeat moves the node to the
+//     slot of its new deadline in O(1), and each tick only looks at the nodes
+//     whose deadline falls in that slot - no periodic scan of all nodes.
+//
+// A node that stays silent for timeout_ms is reported as unresponsive and
+// disconnected. Nodes that send telemetry announce when their next report is
+// due; they are expired after MISSED_REPORTS such intervals instead. TLS is
+// not handled here (see lab1.py for the TLS setup).
+//
+// Compile: gcc -O2 -o monitor monitor.c -lpthread
+// Run:     ./monitor [port] [shards] [timeout_ms]
+//          ./monitor_bench 127.0.0.1 8000 10000      (see monitor_bench.c)
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include "monitor_proto.h"
+
+#define DEFAULT_PORT       8000
+#define DEFAULT_TIMEOUT_MS 10000     // as in lab1.py
+#define MAX_SHARDS         64
+#define TICK_MS            50        // timer wheel resolution
+#define WHEEL_SLOTS        512       // power of two; one round = 25.6 s
+#define MAX_EVENTS         256
+#define RBUF_SIZE          4096
+#define REPORT_INTERVAL_MS 5000
+#define MISSED_REPORTS     2         // as in lab/telemetry.py
+
+// One connected slave (or a monitoring client that only asks for stats)
+typedef struct Conn {
+    int          fd;
+    uint32_t     node_id;            // set by MSG_HELLO
+    int          is_node;            // 1 after MSG_HELLO: tracked by the wheel
+    uint64_t     deadline;           // tick at which the node is declared dead
+    int          in_wheel;           // 1 while linked into slots[deadline]
+    uint64_t     silence_ticks;      // how long the node may stay silent
+    MonTelemetry telemetry;          // latest MSG_TELEMETRY contents
+    struct Conn* prev;               // neighbours in the wheel slot list
+    struct Conn* next;
+    uint32_t     rlen;               // bytes buffered in rbuf
+    uint8_t      rbuf[RBUF_SIZE];
+} Conn;
+
+typedef struct {
+    Conn*    slots[WHEEL_SLOTS];
+    uint64_t now;                    // last tick processed
+} TimerWheel;
+
+// Counters written by one shard, read by whoever answers MSG_STATS_REQ
+typedef struct {
+    _Atomic uint64_t frames;
+    _Atomic uint64_t bytes;
+    atomic_uint      live;
+    atomic_uint      expired;
+    atomic_uint      disconnected;
+} __attribute__((aligned(64))) ShardStats;
+
+typedef struct {
+    int        id;
+    int        listen_fd;
+    int        epfd;
+    TimerWheel wheel;
+    ShardStats stats;
+} Shard;
+
+static Shard    shards[MAX_SHARDS];
+static int      num_shards = 1;
+static int      timeout_ms = DEFAULT_TIMEOUT_MS;
+static uint64_t timeout_ticks;
+static struct timespec start_time;
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)(ts.tv_sec - start_time.tv_sec) * 1000
+           + (ts.tv_nsec - start_time.tv_nsec) / 1000000;
+}
+
+// -------------------------------------------------------------------------
+// Timer wheel
+// -------------------------------------------------------------------------
+static void wheel_unlink(TimerWheel* w, Conn* c) {
+    if (!c->in_wheel) return;                // a new node has no slot yet
+    if (c->prev != NULL) c->prev->next = c->next;
+    else w->slots[c->deadline & (WHEEL_SLOTS - 1)] = c->next;
+    if (c->next != NULL) c->next->prev = c->prev;
+    c->prev = c->next = NULL;
+    c->in_wheel = 0;
+}
+
+// (Re)arm the node's deadline 'silence_ticks' after the current tick: O(1)
+static void wheel_touch(TimerWheel* w, Conn* c) {
+    uint64_t deadline = w->now + c->silence_ticks + 1;
+    if (c->in_wheel && c->deadline == deadline) return;  // already in the right slot
+    wheel_unlink(w, c);
+    c->deadline = deadline;
+    Conn** slot = &w->slots[deadline & (WHEEL_SLOTS - 1)];
+    c->next = *slot;
+    if (*slot != NULL) (*slot)->prev = c;
+    *slot = c;
+    c->in_wheel = 1;
+}
+
+// -------------------------------------------------------------------------
+// Connections
+// -------------------------------------------------------------------------
+static void close_conn(Shard* s, Conn* c, int expired) {
+    if (c->is_node) {
+        wheel_unlink(&s->wheel, c);
+        atomic_fetch_sub_explicit(&s->stats.live, 1, memory_order_relaxed);
+        if (expired) {
+            atomic_fetch_add_explicit(&s->stats.expired, 1, memory_order_relaxed);
+            printf("Monitor: node %u is unresponsive (no frame for %llu ms), disconnecting\n",
+                   c->node_id, (unsigned long long) c->silence_ticks * TICK_MS);
+        } else {
+            atomic_fetch_add_explicit(&s->stats.disconnected, 1, memory_order_relaxed);
+        }
+    }
+    epoll_ctl(s->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    free(c);
+}
+
+static void send_stats(Conn* c) {
+    uint64_t frames = 0, bytes = 0;
+    uint32_t live = 0, expired = 0;
+    for (int i = 0; i < num_shards; i++) {
+        frames  += atomic_load_explicit(&shards[i].stats.frames, memory_order_relaxed);
+        bytes   += atomic_load_explicit(&shards[i].stats.bytes, memory_order_relaxed);
+        live    += atomic_load_explicit(&shards[i].stats.live, memory_order_relaxed);
+        expired += atomic_load_explicit(&shards[i].stats.expired, memory_order_relaxed);
+    }
+    uint8_t payload[MON_STATS_PAYLOAD], frame[MON_HEADER_SIZE + 1 + MON_STATS_PAYLOAD];
+    mon_put_u64(payload, frames);
+    mon_put_u64(payload + 8, bytes);
+    mon_put_u32(payload + 16, live);
+    mon_put_u32(payload + 20, expired);
+    mon_put_u32(payload + 24, (uint32_t) timeout_ms);
+    size_t n = mon_put_frame(frame, MSG_STATS, payload, sizeof(payload));
+    // A 33-byte reply fits in any socket buffer; a client that does not read
+    // its replies simply loses them
+    if (write(c->fd, frame, n) < 0 && errno != EAGAIN) perror("write");
+}
+
+// Handles one complete frame. Returns 1 for a frame from a node, 0 for a
+// stats request and -1 on a protocol error.
+static int handle_frame(Shard* s, Conn* c, uint8_t type, const uint8_t* p, uint32_t len) {
+    switch (type) {
+    case MSG_HELLO:
+        if (len < 4 || c->is_node) return -1;
+        c->node_id = mon_get_u32(p);
+        c->is_node = 1;
+        c->silence_ticks = timeout_ticks;
+        atomic_fetch_add_explicit(&s->stats.live, 1, memory_order_relaxed);
+        break;
+    case MSG_HEARTBEAT:
+    case MSG_RESOURCE:
+        // The payload is not needed for liveness; every frame counts
+        if (!c->is_node) return -1;
+        break;
+    case MSG_TELEMETRY:
+        if (!c->is_node || mon_apply_telemetry(&c->telemetry, p, len) < 0) return -1;
+        if (c->telemetry.interval_ms > 0)
+            c->silence_ticks = (uint64_t) MISSED_REPORTS * c->telemetry.interval_ms / TICK_MS + 1;
+        break;
+    case MSG_STATS_REQ:
+        send_stats(c);
+        return 0;
+    default:
+        return -1;
+    }
+    wheel_touch(&s->wheel, c);
+    return 1;
+}
+
+// Reads what is available and handles every complete frame in it
+static void on_readable(Shard* s, Conn* c) {
+    ssize_t n = read(c->fd, c->rbuf + c->rlen, RBUF_SIZE - c->rlen);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+        close_conn(s, c, 0);
+        return;
+    }
+    if (n < 0) return;
+    c->rlen += (uint32_t) n;
+    atomic_fetch_add_explicit(&s->stats.bytes, (uint64_t) n, memory_order_relaxed);
+
+    uint32_t off = 0, frames = 0;
+    while (c->rlen - off >= MON_HEADER_SIZE) {
+        uint32_t len = mon_get_u32(c->rbuf + off);
+        if (len == 0 || len > MON_MAX_FRAME) {
+            fprintf(stderr, "Monitor: bad frame length %u, closing connection\n", len);
+            close_conn(s, c, 0);
+            return;
+        }
+        if (c->rlen - off < MON_HEADER_SIZE + len) break;     // wait for the rest
+        const uint8_t* f = c->rbuf + off + MON_HEADER_SIZE;
+        int r = handle_frame(s, c, f[0], f + 1, len - 1);
+        if (r < 0) {
+            fprintf(stderr, "Monitor: unexpected frame type %u, closing connection\n", f[0]);
+            close_conn(s, c, 0);
+            return;
+        }
+        off += MON_HEADER_SIZE + len;
+        frames += (uint32_t) r;
+    }
+    // Keep a partial frame at the start of the buffer
+    if (off > 0) {
+        memmove(c->rbuf, c->rbuf + off, c->rlen - off);
+        c->rlen -= off;
+    }
+    atomic_fetch_add_explicit(&s->stats.frames, frames, memory_order_relaxed);
+}
+
+static void on_accept(Shard* s) {
+    for (;;) {
+        int fd = accept4(s->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EINTR) perror("accept4");
+            return;
+        }
+        Conn* c = calloc(1, sizeof(Conn));
+        if (c == NULL) {
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+        if (epoll_ctl(s->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            perror("epoll_ctl");
+            close(fd);
+            free(c);
+        }
+    }
+}
+
+// Processes every tick up to 'tick', expiring the nodes whose deadline it is
+static void advance_wheel(Shard* s, uint64_t tick) {
+    TimerWheel* w = &s->wheel;
+    while (w->now < tick) {
+        w->now++;
+        Conn* c = w->slots[w->now & (WHEEL_SLOTS - 1)];
+        while (c != NULL) {
+            Conn* next = c->next;
+            // Nodes with a deadline one or more rounds later share the slot
+            if (c->deadline <= w->now) close_conn(s, c, 1);
+            c = next;
+        }
+    }
+}
+
+static void report(void) {
+    static uint64_t last_frames, last_ms;
+    uint64_t frames = 0, t = now_ms();
+    unsigned live = 0, expired = 0, disconnected = 0;
+    for (int i = 0; i < num_shards; i++) {
+        frames       += atomic_load_explicit(&shards[i].stats.frames, memory_order_relaxed);
+        live         += atomic_load_explicit(&shards[i].stats.live, memory_order_relaxed);
+        expired      += atomic_load_explicit(&shards[i].stats.expired, memory_order_relaxed);
+        disconnected += atomic_load_explicit(&shards[i].stats.disconnected, memory_order_relaxed);
+    }
+    double rate = t > last_ms ? (frames - last_frames) * 1000.0 / (t - last_ms) : 0.0;
+    printf("Monitor: %u live nodes, %.0f frames/s, %u unresponsive, %u disconnected\n",
+           live, rate, expired, disconnected);
+    fflush(stdout);
+    last_frames = frames;
+    last_ms = t;
+}
+
+static void* shard_loop(void* arg) {
+    Shard* s = (Shard*) arg;
+    struct epoll_event events[MAX_EVENTS];
+    uint64_t next_report = REPORT_INTERVAL_MS;
+
+    for (;;) {
+        int n = epoll_wait(s->epfd, events, MAX_EVENTS, TICK_MS);
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == NULL) on_accept(s);
+            else on_readable(s, (Conn*) events[i].data.ptr);
+        }
+
+        uint64_t t = now_ms();
+        advance_wheel(s, t / TICK_MS);
+        if (s->id == 0 && t >= next_report) {
+            report();
+            next_report = t + REPORT_INTERVAL_MS;
+        }
+    }
+    return NULL;
+}
+
+static int open_listener(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((uint16_t) port);
+    if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char* argv[]) {
+    int port   = argc > 1 ? atoi(argv[1]) : DEFAULT_PORT;
+    num_shards = argc > 2 ? atoi(argv[2]) : 1;
+    timeout_ms = argc > 3 ? atoi(argv[3]) : DEFAULT_TIMEOUT_MS;
+    if (num_shards < 1 || num_shards > MAX_SHARDS || timeout_ms < TICK_MS) {
+        fprintf(stderr, "Usage: %s [port] [shards 1..%d] [timeout_ms >= %d]\n",
+                argv[0], MAX_SHARDS, TICK_MS);
+        return EXIT_FAILURE;
+    }
+    timeout_ticks = (uint64_t) timeout_ms / TICK_MS;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    // One descriptor per node: raise the limit as far as we are allowed
+    struct rlimit rl = { 0, 0 };
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    for (int i = 0; i < num_shards; i++) {
+        Shard* s = &shards[i];
+        s->id = i;
+        s->listen_fd = open_listener(port);
+        s->epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (s->listen_fd < 0 || s->epfd < 0) {
+            perror("listen");
+            return EXIT_FAILURE;
+        }
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+        epoll_ctl(s->epfd, EPOLL_CTL_ADD, s->listen_fd, &ev);
+    }
+    printf("Monitor listening on port %d (%d shard%s, timeout %d ms, %ld descriptors)\n",
+           port, num_shards, num_shards > 1 ? "s" : "", timeout_ms, (long) rl.rlim_cur);
+    fflush(stdout);
+
+    pthread_t threads[MAX_SHARDS];
+    for (int i = 1; i < num_shards; i++)
+        pthread_create(&threads[i], NULL, shard_loop, &shards[i]);
+    shard_loop(&shards[0]);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,308 @@
+// monitor_bench.c
+// Load generator for monitor.c: thousands of simulated slaves on one host.
+//
+// 1. Connects <slaves> TCP connections; each sends MSG_HELLO with its id.
+// 2. Throughput: for [seconds] s every slave sends bursts of heartbeats as
+//    fast as the daemon reads them (at most MAX_UNSENT bytes queued per
+//    socket, so the kernel buffers do not fill up with seconds of backlog
+//    that would delay later heartbeats). The daemon's own frame counter
+//    (MSG_STATS) gives the heartbeats/sec it actually handled.
+// 3. Detection latency: every slave sends one heartbeat every timeout/4,
+//    except [victims] slaves that go silent (socket left open, like a hung
+//    process). The daemon closes a connection when it declares the node
+//    unresponsive; the time from the victim's last heartbeat to that close
+//    is the detection latency. Any other slave that gets closed is a false
+//    positive. Meanwhile late slaves keep joining (MSG_HELLO, then silence),
+//    and the phase lasts longer than one round of the daemon's timer wheel,
+//    so deadlines wrap around to slot 0 while new nodes register.
+//
+// Compile: gcc -O2 -o monitor_bench monitor_bench.c
+// Run:     ./monitor 8000 1 2000 &
+//          ./monitor_bench 127.0.0.1 8000 10000 [seconds] [victims]
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <linux/sockios.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include "monitor_proto.h"
+
+#define BURST 8                 // heartbeats per write in the throughput phase
+#define MAX_UNSENT (4 * BURST * (MON_HEADER_SIZE + 5))   // bytes queued per socket
+#define WHEEL_TICK  0.05        // monitor.c's timer wheel: one slot per tick...
+#define WHEEL_ROUND 25.6        // ...and 512 slots per round
+#define MAX_LATE 1024           // slaves that join during the detection phase
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int connect_to(const struct sockaddr_in* addr) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (const struct sockaddr*) addr, sizeof(*addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int write_all(int fd, const uint8_t* buf, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, buf, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += w;
+        n -= (size_t) w;
+    }
+    return 0;
+}
+
+// Connects a slave and registers it with MSG_HELLO; the socket is left non-blocking
+static int connect_slave(const struct sockaddr_in* addr, uint32_t id) {
+    int fd = connect_to(addr);
+    if (fd < 0) return -1;
+    uint8_t payload[4], frame[MON_HEADER_SIZE + 5];
+    mon_put_u32(payload, id);
+    write_all(fd, frame, mon_put_frame(frame, MSG_HELLO, payload, sizeof(payload)));
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+static int read_all(int fd, uint8_t* buf, size_t n) {
+    while (n > 0) {
+        ssize_t r = read(fd, buf, n);
+        if (r <= 0) {
+            if (r < 0 && errno == EINTR) continue;
+            return -1;
+        }
+        buf += r;
+        n -= (size_t) r;
+    }
+    return 0;
+}
+
+typedef struct {
+    uint64_t frames;
+    uint32_t live;
+    uint32_t expired;
+    uint32_t timeout_ms;
+} Stats;
+
+// Asks the daemon for its counters over the (blocking) control connection
+static int query_stats(int fd, Stats* st) {
+    uint8_t req[MON_HEADER_SIZE + 1], reply[MON_HEADER_SIZE + 1 + MON_STATS_PAYLOAD];
+    size_t n = mon_put_frame(req, MSG_STATS_REQ, NULL, 0);
+    if (write_all(fd, req, n) < 0 || read_all(fd, reply, sizeof(reply)) < 0) return -1;
+    if (reply[MON_HEADER_SIZE] != MSG_STATS) return -1;
+    const uint8_t* p = reply + MON_HEADER_SIZE + 1;
+    st->frames     = mon_get_u64(p);
+    st->live       = mon_get_u32(p + 16);
+    st->expired    = mon_get_u32(p + 20);
+    st->timeout_ms = mon_get_u32(p + 24);
+    return 0;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <host> <port> <slaves> [seconds] [victims]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    int    slaves  = atoi(argv[3]);
+    double seconds = argc > 4 ? atof(argv[4]) : 5.0;
+    int    victims = argc > 5 ? atoi(argv[5]) : 100;
+    if (slaves <= 0 || seconds <= 0 || victims < 0 || victims > slaves) {
+        fprintf(stderr, "Error: need slaves > 0, seconds > 0, 0 <= victims <= slaves.\n");
+        return EXIT_FAILURE;
+    }
+
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+        if ((long) rl.rlim_cur < slaves + MAX_LATE + 16) {
+            fprintf(stderr, "Error: only %ld descriptors allowed (ulimit -n)\n", (long) rl.rlim_cur);
+            return EXIT_FAILURE;
+        }
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t) atoi(argv[2]));
+    if (inet_pton(AF_INET, argv[1], &addr.sin_addr) != 1) {
+        fprintf(stderr, "Error: bad IPv4 address %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    int control = connect_to(&addr);
+    Stats st0, st1;
+    if (control < 0 || query_stats(control, &st0) < 0) {
+        perror("Error: cannot reach the monitor");
+        return EXIT_FAILURE;
+    }
+    double timeout = st0.timeout_ms / 1000.0;
+
+    // ---------------- 1. Connect ----------------
+    int* fds = malloc((slaves + MAX_LATE) * sizeof(int));
+    double t0 = now_sec();
+    for (int i = 0; i < slaves; i++) {
+        fds[i] = connect_slave(&addr, (uint32_t) i + 1);
+        if (fds[i] < 0) {
+            fprintf(stderr, "Error: connection %d failed: %s\n", i, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        // Let the daemon keep up with accept() so the backlog never overflows
+        if (i % 500 == 499) usleep(2000);
+    }
+    do {
+        query_stats(control, &st1);
+    } while (st1.live < st0.live + (uint32_t) slaves && now_sec() - t0 < 30);
+    printf("connected %d slaves in %.2f s (monitor reports %u live, timeout %.2f s)\n",
+           slaves, now_sec() - t0, st1.live, timeout);
+
+    // ---------------- 2. Throughput ----------------
+    uint8_t burst[BURST * (MON_HEADER_SIZE + 5)];
+    size_t burst_len = 0;
+    for (int b = 0; b < BURST; b++) {
+        uint8_t seq[4];
+        mon_put_u32(seq, (uint32_t) b);
+        burst_len += mon_put_frame(burst + burst_len, MSG_HEARTBEAT, seq, sizeof(seq));
+    }
+
+    query_stats(control, &st0);
+    t0 = now_sec();
+    long sent = 0;
+    while (now_sec() - t0 < seconds) {
+        for (int i = 0; i < slaves; i++) {
+            int unsent = 0;
+            ioctl(fds[i], SIOCOUTQ, &unsent);
+            if (unsent > MAX_UNSENT) continue;
+            // Whole bursts only, so frames are never cut in half on EAGAIN
+            if (write(fds[i], burst, burst_len) == (ssize_t) burst_len) sent += BURST;
+        }
+    }
+    // Wait until the daemon has drained its sockets
+    double t_last_change = now_sec();
+    uint64_t last = 0;
+    for (;;) {
+        query_stats(control, &st1);
+        if (st1.frames != last) {
+            last = st1.frames;
+            t_last_change = now_sec();
+        } else if (now_sec() - t_last_change > 0.2) {
+            break;
+        }
+        usleep(20000);
+    }
+    uint64_t handled = st1.frames - st0.frames;
+    printf("throughput: %ld heartbeats sent, %llu handled in %.2f s -> %.3e heartbeats/s\n",
+           sent, (unsigned long long) handled, t_last_change - t0,
+           handled / (t_last_change - t0));
+
+    // ---------------- 3. Detection latency ----------------
+    // Every (slaves / victims)-th slave goes silent after one last heartbeat
+    int*    is_victim = calloc(slaves + MAX_LATE, sizeof(int));
+    double* last_hb   = calloc(slaves + MAX_LATE, sizeof(double));
+    double* latency   = calloc(victims + MAX_LATE, sizeof(double));
+    for (int v = 0; v < victims; v++) is_victim[(long) v * slaves / victims] = 1;
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    for (int i = 0; i < slaves; i++) {
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP, .data.u32 = (uint32_t) i };
+        epoll_ctl(epfd, EPOLL_CTL_ADD, fds[i], &ev);
+    }
+
+    uint8_t hb[MON_HEADER_SIZE + 5], seq[4] = { 0, 0, 0, 0 };
+    size_t hb_len = mon_put_frame(hb, MSG_HEARTBEAT, seq, sizeof(seq));
+    double interval = timeout / 4, next_round = 0, start = now_sec();
+    int detected = 0, false_positives = 0, round = 0;
+    struct epoll_event events[256];
+    uint8_t drain[256];
+
+    // A late slave joins every wheel tick until a round and a timeout have
+    // passed, so that every slot, slot 0 included, gets a silent node while
+    // new nodes register
+    double join_window = WHEEL_ROUND + timeout;
+    double next_join = start;
+    int total = slaves, joining = 1;
+
+    while ((joining || detected < victims) && now_sec() - start < join_window + 3 * timeout + 1) {
+        double t = now_sec();
+        joining = t - start < join_window && total < slaves + MAX_LATE;
+        if (joining && t >= next_join) {
+            int fd = connect_slave(&addr, (uint32_t) total + 1);
+            if (fd >= 0) {
+                fds[total] = fd;
+                is_victim[total] = 1;
+                last_hb[total] = now_sec();
+                struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP, .data.u32 = (uint32_t) total };
+                epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+                total++;
+                victims++;
+            }
+            next_join += WHEEL_TICK;
+        }
+        if (t >= next_round) {
+            for (int i = 0; i < slaves; i++) {
+                if (fds[i] < 0 || (is_victim[i] && round > 0)) continue;
+                if (write(fds[i], hb, hb_len) == (ssize_t) hb_len) last_hb[i] = now_sec();
+            }
+            round++;
+            next_round = t + interval;
+        }
+        int n = epoll_wait(epfd, events, 256, 5);
+        for (int e = 0; e < n; e++) {
+            int i = (int) events[e].data.u32;
+            if (read(fds[i], drain, sizeof(drain)) > 0) continue;
+            // The monitor closed this connection
+            double t_close = now_sec();
+            epoll_ctl(epfd, EPOLL_CTL_DEL, fds[i], NULL);
+            close(fds[i]);
+            fds[i] = -1;
+            if (is_victim[i]) latency[detected++] = t_close - last_hb[i];
+            else false_positives++;
+        }
+    }
+
+    if (victims > 0) {
+        qsort(latency, detected, sizeof(double), cmp_double);
+        printf("detection: %d/%d silent slaves detected (%d joined during the phase), "
+               "%d false positives\n", detected, victims, total - slaves, false_positives);
+        if (detected > 0) {
+            printf("latency from last heartbeat (timeout %.2f s): min %.3f s, median %.3f s, "
+                   "p99 %.3f s, max %.3f s\n", timeout, latency[0], latency[detected / 2],
+                   latency[(int) (0.99 * (detected - 1))], latency[detected - 1]);
+            printf("delay beyond the timeout: median %.0f ms, max %.0f ms\n",
+                   (latency[detected / 2] - timeout) * 1000, (latency[detected - 1] - timeout) * 1000);
+        }
+    }
+    query_stats(control, &st1);
+    printf("monitor: %u live, %u unresponsive in total\n", st1.live, st1.expired);
+
+    for (int i = 0; i < total; i++)
+        if (fds[i] >= 0) close(fds[i]);
+    close(control);
+    return (detected == victims && false_positives == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,120 @@
+// monitor_proto.h
+// Wire format shared by monitor.c (the daemon) and monitor_bench.c.
+//
+// Every message is one frame:
+//
+//   +----------------+--------+-----------------------+
+//   | length (u32 BE)| type   | payload               |
+//   +----------------+--------+-----------------------+
+//     4 bytes          1 byte   length - 1 bytes
+//
+// 'length' counts the type byte and the payload, so a reader always knows
+// how many bytes to wait for: frames can never be merged or split the way
+// the "HEARTBEAT" strings of lab1.py are by TCP.
+//
+// Payloads (all integers big-endian):
+//   MSG_HELLO      u32 node_id                     first frame of a slave
+//   MSG_HEARTBEAT  u32 sequence number
+//   MSG_RESOURCE   u16 cpu_permille, u16 mem_permille
+//   MSG_STATS_REQ  (empty)                         any client may ask
+//   MSG_STATS      u64 node_frames, u64 bytes, u32 live_nodes, u32 expired_nodes,
+//                  u32 timeout_ms                  reply to MSG_STATS_REQ
+//   MSG_TELEMETRY  heartbeat + resources + progress in one frame, the
+//                  layout of lab/telemetry.py (version 1, 40 bytes):
+//                  u8 version, u8 flags, u8 n_threads, u8 reserved,
+//                  u32 seq, u32 interval_ms, u16 cpu, u16 mem (permille),
+//                  u32 net_rx, u32 net_tx (deltas), u16 progress[8]
+//
+// Header-only: just #include "monitor_proto.h".
+
+#ifndef MONITOR_PROTO_H
+#define MONITOR_PROTO_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define MON_HEADER_SIZE 4
+#define MON_MAX_FRAME   64      // largest length value accepted
+
+enum {
+    MSG_HELLO     = 1,
+    MSG_HEARTBEAT = 2,
+    MSG_RESOURCE  = 3,
+    MSG_STATS_REQ = 4,
+    MSG_STATS     = 5,
+    MSG_TELEMETRY = 6
+};
+
+#define MON_STATS_PAYLOAD (8 + 8 + 4 + 4 + 4)
+
+#define MON_TELEMETRY_V1_PAYLOAD 40
+#define MON_TELEMETRY_KEYFRAME   0x01
+#define MON_MAX_THREADS          8
+
+// Latest telemetry of one node; the delta-encoded counters are accumulated
+typedef struct {
+    uint32_t seq;
+    uint32_t interval_ms;            // next report is due within this time
+    uint16_t cpu_permille;
+    uint16_t mem_permille;
+    uint64_t net_rx_total;
+    uint64_t net_tx_total;
+    uint8_t  n_threads;
+    uint16_t progress[MON_MAX_THREADS];
+} MonTelemetry;
+
+static inline void mon_put_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t) v;
+}
+
+static inline void mon_put_u32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t) v;
+}
+
+static inline void mon_put_u64(uint8_t* p, uint64_t v) {
+    mon_put_u32(p, (uint32_t)(v >> 32));
+    mon_put_u32(p + 4, (uint32_t) v);
+}
+
+static inline uint16_t mon_get_u16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t mon_get_u32(const uint8_t* p) {
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static inline uint64_t mon_get_u64(const uint8_t* p) {
+    return ((uint64_t) mon_get_u32(p) << 32) | mon_get_u32(p + 4);
+}
+
+// Writes a frame into 'buf' and returns its total size in bytes
+static inline size_t mon_put_frame(uint8_t* buf, uint8_t type,
+                                   const void* payload, uint32_t payload_len) {
+    mon_put_u32(buf, payload_len + 1);
+    buf[MON_HEADER_SIZE] = type;
+    if (payload_len > 0) memcpy(buf + MON_HEADER_SIZE + 1, payload, payload_len);
+    return MON_HEADER_SIZE + 1 + payload_len;
+}
+
+// Applies a MSG_TELEMETRY payload to 't' in place; returns -1 if malformed.
+// Later versions may append fields: they are ignored.
+static inline int mon_apply_telemetry(MonTelemetry* t, const uint8_t* p, uint32_t len) {
+    if (len < MON_TELEMETRY_V1_PAYLOAD || p[0] < 1) return -1;
+    if (p[1] & MON_TELEMETRY_KEYFRAME) t->net_rx_total = t->net_tx_total = 0;
+    t->n_threads    = p[2] < MON_MAX_THREADS ? p[2] : MON_MAX_THREADS;
+    t->seq          = mon_get_u32(p + 4);
+    t->interval_ms  = mon_get_u32(p + 8);
+    t->cpu_permille = mon_get_u16(p + 12);
+    t->mem_permille = mon_get_u16(p + 14);
+    t->net_rx_total += mon_get_u32(p + 16);
+    t->net_tx_total += mon_get_u32(p + 20);
+    for (int i = 0; i < MON_MAX_THREADS; i++) t->progress[i] = mon_get_u16(p + 24 + 2 * i);
+    return 0;
+}
+
+#endif // MONITOR_PROTO_H
@@ -0,0 +1,223 @@
+#!/usr/bin/env python3
+"""
+Connections/sec and concurrent-connection capacity of the server designs
+used in the course.
+
+Every server answers each line it receives with "OK\\n". Designs compared:
+
+  iterative   accept a client and serve it until it leaves, then accept
+              the next one (the CS1 socket server)
+  threaded    a new thread for every connection (the CS2 registry and the
+              lab1.py master)
+  core        server_core.py: one asyncio event loop for every connection
+  core-N      server_core.py with N processes sharing the port through
+              SO_REUSEPORT (--shards)
+
+Two tests, with the clients in this process on one asyncio event loop:
+
+  rate        --concurrency clients each connect, send one line, wait for
+              the answer and disconnect, again and again for --seconds
+  capacity    --conns connections are opened and kept open; then every one
+              of them sends a line and must get its answer within
+              --timeout. The server's memory (RSS of all its processes) is
+              measured before and after opening them.
+
+Both sides need a file descriptor per connection: raise "ulimit -n" above
+--conns.
+
+Run examples:
+    python server_bench.py
+    python server_bench.py --conns 10000 --shards 4
+    python server_bench.py --designs threaded,core --seconds 5
+
+No external libraries are required.
+"""
+
+import argparse
+import asyncio
+import contextlib
+import multiprocessing as mp
+import os
+import signal
+import socket
+import socketserver
+import time
+
+from server_core import Handler, ServerCore
+
+REPLY = b"OK\n"
+
+
+# --- Servers ---
+class LineHandler(socketserver.StreamRequestHandler):
+    def handle(self):
+        try:
+            for _ in self.rfile:
+                self.wfile.write(REPLY)
+        except ConnectionError:
+            pass
+
+
+class IterativeServer(socketserver.TCPServer):
+    allow_reuse_address = True
+    request_queue_size = 1024
+
+
+class ThreadedServer(socketserver.ThreadingMixIn, socketserver.TCPServer):
+    allow_reuse_address = True
+    daemon_threads = True
+    request_queue_size = 1024
+
+
+class OkHandler(Handler):
+    def on_data(self, conn):
+        lines = conn.read_lines()
+        if lines:
+            conn.write(REPLY * len(lines))
+
+
+def run_server(design, port, shards, ready):
+    if design.startswith("core"):
+        core = ServerCore(OkHandler, "127.0.0.1", port, shards=shards, drain_timeout=1.0,
+                          name=design)
+        ready.set()
+        core.run()
+        return
+    server_class = IterativeServer if design == "iterative" else ThreadedServer
+    with server_class(("127.0.0.1", port), LineHandler) as server:
+        signal.signal(signal.SIGTERM, lambda *a: os._exit(0))
+        ready.set()
+        server.serve_forever()
+
+
+@contextlib.contextmanager
+def running_server(ctx, design, shards):
+    port = free_port()
+    ready = ctx.Event()
+    server = ctx.Process(target=run_server, args=(design, port, shards, ready))
+    server.start()
+    ready.wait()
+    time.sleep(0.5)
+    try:
+        yield port, server.pid
+    finally:
+        os.kill(server.pid, signal.SIGTERM)
+        server.join(10)
+        if server.is_alive():
+            server.kill()
+
+
+def free_port():
+    with socket.socket() as s:
+        s.bind(("127.0.0.1", 0))
+        return s.getsockname()[1]
+
+
+def rss_kb(pid):
+    """Resident memory of a process and its children, in KB."""
+    total = 0
+    pids = [pid]
+    while pids:
+        p = pids.pop()
+        try:
+            with open(f"/proc/{p}/status") as f:
+                total += next(int(line.split()[1]) for line in f if line.startswith("VmRSS"))
+            for task in os.listdir(f"/proc/{p}/task"):
+                with open(f"/proc/{p}/task/{task}/children") as f:
+                    pids.extend(int(c) for c in f.read().split())
+        except (OSError, StopIteration):
+            pass
+    return total
+
+
+# --- Clients ---
+async def rate_test(port, concurrency, seconds):
+    done = errors = 0
+    deadline = time.perf_counter() + seconds
+
+    async def client():
+        nonlocal done, errors
+        while time.perf_counter() < deadline:
+            try:
+                reader, writer = await asyncio.wait_for(
+                    asyncio.open_connection("127.0.0.1", port), 5)
+                writer.write(b"ping\n")
+                await asyncio.wait_for(reader.readline(), 5)
+                writer.close()
+                done += 1
+            except (OSError, asyncio.TimeoutError):
+                errors += 1
+
+    t0 = time.perf_counter()
+    await asyncio.gather(*(client() for _ in range(concurrency)))
+    return done / (time.perf_counter() - t0), errors
+
+
+async def capacity_test(port, server_pid, conns, timeout):
+    rss_before = rss_kb(server_pid)
+
+    async def connect():
+        try:
+            return await asyncio.wait_for(asyncio.open_connection("127.0.0.1", port), timeout)
+        except (OSError, asyncio.TimeoutError):
+            return None
+
+    streams = []
+    for start in range(0, conns, 500):
+        # In steps, so that the listen backlog does not overflow
+        streams += await asyncio.gather(*(connect() for _ in range(min(500, conns - start))))
+    opened = [s for s in streams if s is not None]
+    await asyncio.sleep(1.0)                # let the server accept them all
+    rss_after = rss_kb(server_pid)
+
+    async def request(reader, writer):
+        try:
+            writer.write(b"ping\n")
+            return await asyncio.wait_for(reader.readline(), timeout) == REPLY
+        except (OSError, asyncio.TimeoutError):
+            return False
+
+    t0 = time.perf_counter()
+    served = sum(await asyncio.gather(*(request(r, w) for r, w in opened)))
+    elapsed = time.perf_counter() - t0
+    for _, writer in opened:
+        writer.close()
+    per_conn = (rss_after - rss_before) / max(len(opened), 1)
+    return len(opened), served, elapsed, per_conn
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("--designs", default="iterative,threaded,core,core-N")
+    parser.add_argument("--shards", type=int, default=2, help="processes for core-N")
+    parser.add_argument("--concurrency", type=int, default=50, help="clients in the rate test")
+    parser.add_argument("--seconds", type=float, default=3.0, help="length of the rate test")
+    parser.add_argument("--conns", type=int, default=5000, help="connections in the capacity test")
+    parser.add_argument("--timeout", type=float, default=5.0, help="seconds allowed per answer")
+    args = parser.parse_args()
+
+    # Servers start in a fresh interpreter: a forked one would inherit (and reuse)
+    # the memory this process freed after its own tests
+    ctx = mp.get_context("spawn")
+    print(f"rate: {args.concurrency} clients for {args.seconds:.0f}s; "
+          f"capacity: {args.conns} open connections, {args.timeout:.0f}s per answer\n")
+    print("| Server    | Conns/sec | Opened | Served | All served in | KB/conn |")
+    print("|-----------|-----------|--------|--------|---------------|---------|")
+    for design in args.designs.split(","):
+        shards = args.shards if design == "core-N" else 1
+        with running_server(ctx, design, shards) as (port, _):
+            rate, errors = asyncio.run(rate_test(port, args.concurrency, args.seconds))
+        # A fresh server, so that memory freed after the rate test does not hide
+        # what the open connections cost
+        with running_server(ctx, design, shards) as (port, pid):
+            opened, served, elapsed, per_conn = asyncio.run(
+                capacity_test(port, pid, args.conns, args.timeout))
+        name = f"core-{shards}" if design == "core-N" else design
+        all_served = f"{elapsed:.2f}s" if served == opened else "-"
+        print(f"| {name:<9} | {rate:9.0f} | {opened:6d} | {served:6d} | {all_served:>13} "
+              f"| {per_conn:7.1f} |")
+        if errors:
+            print(f"  {errors} connection errors in the rate test")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,259 @@
+"""
+server_core.py
+Reusable event-driven TCP server core for the course examples.
+
+The example servers handle connections in one of two simple ways:
+- The CS1 socket server runs each client to completion inside its accept
+  loop, so only one client is served at a time.
+- The CS2 registry and the lab1 master start a thread for every accepted
+  connection. Each thread costs a stack and scheduler work, and they all
+  contend for the GIL.
+
+ServerCore runs all connections of a process on one asyncio event loop and
+adds what a long-running server needs:
+
+- Sharding: with shards > 1 the core forks that many processes. Each one
+  binds its own listening socket with SO_REUSEPORT, and the kernel spreads
+  new connections over them, so the shards share no state and no lock.
+- Bounded buffers:
+  - Unread input may not grow beyond max_input bytes; a client that sends
+    more without completing a message is disconnected.
+  - Unsent output above max_output bytes pauses reading from that client
+    until its output has drained below a quarter of max_output. A slow
+    reader therefore cannot make the server queue replies without limit.
+  - Handlers can pause a client too (conn.pause_reading()), for example
+    when the stage behind them is full.
+- Graceful drain: on SIGINT or SIGTERM the core stops accepting, calls
+  on_drain() for every open connection, and waits up to drain_timeout
+  seconds for the clients to leave. It then closes the rest after sending
+  their pending output, and calls on_shutdown().
+- TLS: pass an SSLContext and the handshake runs inside the event loop.
+
+A server is a Handler subclass. One handler object is created in each shard
+process (by handler_factory), so it can keep per-shard state:
+
+    class Echo(Handler):
+        def on_data(self, conn):
+            for line in conn.read_lines():
+                conn.write(line + b"\\n")
+
+    ServerCore(Echo, "0.0.0.0", 12345, shards=2).run()
+
+Linux only for shards > 1 (fork and SO_REUSEPORT).
+"""
+
+import asyncio
+import os
+import signal
+import socket
+
+
+class Handler:
+    """Callbacks of a server; all of them run on the shard's event loop."""
+
+    def on_start(self, core):
+        """The shard is listening; core.call_every() can schedule timers."""
+
+    def on_connect(self, conn):
+        """A client connected. conn.state can hold per-connection data."""
+
+    def on_data(self, conn):
+        """New bytes are in conn.inbuf; consume what you use (see read_lines())."""
+
+    def on_close(self, conn):
+        """The connection is gone, whoever closed it."""
+
+    def on_drain(self, conn):
+        """The server is shutting down; e.g. tell the client to leave."""
+
+    def on_shutdown(self):
+        """Every connection is closed; release the shard's resources."""
+
+
+class Connection(asyncio.Protocol):
+    """One client connection, as seen by the handler."""
+
+    def __init__(self, core):
+        self.core = core
+        self.handler = core.handler
+        self.transport = None
+        self.peer = None
+        self.inbuf = bytearray()
+        self.state = None
+        self.closed = False
+        self.paused_by = set()              # "output" and/or "handler"
+
+    # -- asyncio callbacks --------------------------------------------------
+    def connection_made(self, transport):
+        self.transport = transport
+        self.peer = transport.get_extra_info("peername")
+        transport.set_write_buffer_limits(high=self.core.max_output,
+                                          low=self.core.max_output // 4)
+        self.core.connections.add(self)
+        self.core.accepted += 1
+        self.handler.on_connect(self)
+
+    def data_received(self, data):
+        self.inbuf += data
+        self.handler.on_data(self)
+        if len(self.inbuf) > self.core.max_input and not self.closed:
+            print(f"{self.core.name}: {self.peer} exceeded {self.core.max_input} unread bytes, closing.")
+            self.close()
+
+    def connection_lost(self, exc):
+        self.closed = True
+        self.core.connections.discard(self)
+        self.handler.on_close(self)
+        if self.core.draining and not self.core.connections:
+            self.core.drained.set()
+
+    def pause_writing(self):
+        self._pause("output")
+
+    def resume_writing(self):
+        self._resume("output")
+
+    # -- For handlers -------------------------------------------------------
+    def write(self, data):
+        if not self.closed:
+            self.transport.write(data)
+
+    def close(self):
+        """Closes after the pending output has been sent."""
+        if not self.closed:
+            self.closed = True
+            self.transport.close()
+
+    def pause_reading(self):
+        self._pause("handler")
+
+    def resume_reading(self):
+        self._resume("handler")
+
+    def read_lines(self):
+        """Removes and returns the complete lines in inbuf (without "\\n")."""
+        end = self.inbuf.rfind(b"\n")
+        if end < 0:
+            return []
+        lines = self.inbuf[:end].split(b"\n")
+        del self.inbuf[:end + 1]
+        return lines
+
+    def _pause(self, reason):
+        if not self.paused_by and not self.closed:
+            self.transport.pause_reading()
+        self.paused_by.add(reason)
+
+    def _resume(self, reason):
+        self.paused_by.discard(reason)
+        if not self.paused_by and not self.closed:
+            self.transport.resume_reading()
+
+
+class ServerCore:
+    def __init__(self, handler_factory, host, port, shards=1, ssl_context=None,
+                 max_input=64 * 1024, max_output=256 * 1024, drain_timeout=5.0,
+                 backlog=1024, name="Server"):
+        self.handler_factory = handler_factory
+        self.host = host
+        self.port = port
+        self.shards = shards
+        self.ssl_context = ssl_context
+        self.max_input = max_input
+        self.max_output = max_output
+        self.drain_timeout = drain_timeout
+        self.backlog = backlog
+        self.name = name
+        self.shard = 0
+        self.handler = None
+        self.loop = None
+        self.connections = set()
+        self.accepted = 0
+        self.draining = False
+        self.drained = None
+
+    def run(self):
+        """Serves until SIGINT/SIGTERM; forks the shards if there are several."""
+        if self.shards <= 1:
+            self._serve_shard(0)
+            return
+        children = []
+        for shard in range(self.shards):
+            pid = os.fork()
+            if pid == 0:
+                try:
+                    self._serve_shard(shard)
+                finally:
+                    os._exit(0)
+            children.append(pid)
+
+        def forward(signum, frame):
+            for pid in children:
+                try:
+                    os.kill(pid, signum)
+                except ProcessLookupError:
+                    pass
+        signal.signal(signal.SIGTERM, forward)
+        signal.signal(signal.SIGINT, forward)
+        for pid in children:
+            while True:
+                try:
+                    os.waitpid(pid, 0)
+                    break
+                except InterruptedError:
+                    continue
+
+    def call_every(self, interval, fn):
+        """Calls fn() every 'interval' seconds on the shard's event loop."""
+        def tick():
+            fn()
+            self.loop.call_later(interval, tick)
+        self.loop.call_later(interval, tick)
+
+    def _serve_shard(self, shard):
+        self.shard = shard
+        if self.shards > 1:
+            self.name = f"{self.name} shard {shard}"
+        # Created before the event loop runs, so handlers may fork workers here
+        self.handler = self.handler_factory()
+        asyncio.run(self._main())
+
+    def _listen_socket(self):
+        sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        if self.shards > 1:
+            # Every shard binds the same port; the kernel balances new connections
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+        sock.bind((self.host, self.port))
+        sock.listen(self.backlog)
+        sock.setblocking(False)
+        return sock
+
+    async def _main(self):
+        self.loop = asyncio.get_running_loop()
+        self.drained = asyncio.Event()
+        server = await self.loop.create_server(lambda: Connection(self), sock=self._listen_socket(),
+                                               ssl=self.ssl_context, backlog=self.backlog)
+        print(f"{self.name}: Listening on {self.host}:{self.port}...")
+        stop = asyncio.Event()
+        for signum in (signal.SIGINT, signal.SIGTERM):
+            self.loop.add_signal_handler(signum, stop.set)
+        self.handler.on_start(self)
+        await stop.wait()
+
+        # Graceful drain: no new clients, ask the current ones to leave, wait a bit
+        self.draining = True
+        server.close()
+        print(f"{self.name}: Draining {len(self.connections)} connections...")
+        for conn in list(self.connections):
+            self.handler.on_drain(conn)
+        if self.connections:
+            try:
+                await asyncio.wait_for(self.drained.wait(), self.drain_timeout)
+            except asyncio.TimeoutError:
+                pass
+        for conn in list(self.connections):
+            conn.close()                    # pending output is still sent
+        await asyncio.sleep(0)
+        self.handler.on_shutdown()
+        print(f"{self.name}: Stopped after {self.accepted} connections.")
@@ -0,0 +1,480 @@
+#!/usr/bin/env python3
+"""
+SWIM gossip membership: failure detection without a central registry.
+
+lab1.py (MasterNode.monitor_slaves) and the CS2 registry server make one
+node the judge of who is alive: every node sends it heartbeats, so its load
+grows with N, and when it fails nobody knows anything. SWIM (Das, Gupta and
+Motivala, 2002) spreads that job over all members:
+
+  probing        every protocol period each member pings ONE member, taken
+                 from a shuffled round-robin list, and expects an ACK
+  indirect ping  if no ACK comes within the ping timeout, it asks K random
+                 members to ping the target for it (PING_REQ); their relayed
+                 ACKs count too, so one lossy link is not a failure
+  suspicion      a target that did not answer by the end of the period is
+                 only SUSPECT; if it is still suspected after the suspicion
+                 timeout (proportional to log N) it is declared DEAD
+  incarnations   a member that hears it is suspected increments its
+                 incarnation number and gossips ALIVE; a newer incarnation
+                 overrides the suspicion everywhere
+  piggybacking   membership updates (ALIVE / SUSPECT / DEAD) ride on the
+                 PING, PING_REQ and ACK messages, each one about
+                 RETRANSMIT_MULT * log N times, so they reach everybody
+                 in O(log N) periods without extra messages; a message to
+                 a member we suspect always carries that suspicion
+
+Each member sends one probe per period whatever N is, so the load per member
+is constant; the time to detect a failure is one or two periods plus the
+suspicion timeout, and spreading it takes O(log N) periods.
+
+The simulation runs every member as its own UDP socket on 127.0.0.1 (port
+base_port + member id). Members are spread over --workers processes; each
+process drives its members from one selectors loop, and members talk only
+through UDP, also within one process. After a warm-up, --fail members stop
+(their sockets are closed) and the report shows how fast the others found
+out, how many healthy members were wrongly declared dead, and the message
+load per member. --loss drops a fraction of all messages, to show how
+indirect probes and refutation keep healthy members alive.
+
+Run examples:
+    python swim.py
+    python swim.py --members 1000 --fail 10
+    python swim.py --sweep 100,300,1000 --period 0.5
+    python swim.py --members 500 --loss 0.05
+
+No external libraries are required.
+"""
+
+import argparse
+import heapq
+import itertools
+import math
+import multiprocessing as mp
+import random
+import resource
+import selectors
+import socket
+import statistics
+import struct
+import time
+
+# Message types
+PING, ACK, PING_REQ = 1, 2, 3
+# Member states, in the order in which they override each other
+ALIVE, SUSPECT, DEAD = 0, 1, 2
+
+INDIRECT_PROBES = 3         # K members asked to ping for us
+PING_TIMEOUT = 0.3          # of a period, before indirect probing starts
+SUSPICION_MULT = 3          # suspicion timeout = SUSPICION_MULT * log10(N) periods
+RETRANSMIT_MULT = 3         # each update is piggybacked RETRANSMIT_MULT * log10(N + 1) times
+MAX_PIGGYBACK = 8           # updates per message
+
+# type, seq, sender, target, number of updates; then (state, member, incarnation) each
+HEADER = struct.Struct("!BIHHB")
+UPDATE = struct.Struct("!BHI")
+MAX_MESSAGE = HEADER.size + MAX_PIGGYBACK * UPDATE.size
+
+
+class Member:
+    """One SWIM member: its view of the group and its pending probes."""
+
+    def __init__(self, member_id, n, base_port, loss, rng):
+        self.id = member_id
+        self.n = n
+        self.base_port = base_port
+        self.loss = loss                    # simulated message loss rate
+        self.rng = rng
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setblocking(False)
+        self.sock.bind(("127.0.0.1", base_port + member_id))
+        self.failed = False
+
+        self.incarnation = 0
+        self.state = [ALIVE] * n            # what this member believes
+        self.inc = [0] * n
+        self.updates = {}                   # member -> [state, incarnation, transmissions]
+        self.probe_order = [m for m in range(n) if m != member_id]
+        rng.shuffle(self.probe_order)
+        self.probe_index = 0
+        self.next_seq = 1
+        self.pending = {}                   # seq -> probed member
+        self.relays = {}                    # our seq -> (origin, origin's seq)
+
+        self.sent = 0
+        self.received = 0
+
+    def address(self, member_id):
+        return ("127.0.0.1", self.base_port + member_id)
+
+    def send(self, msg_type, seq, to, target):
+        """Sends one message with as many piggybacked updates as fit.
+
+        If we believe the receiver is suspect or dead, the message always
+        tells it so (the "buddy system" of Lifeguard), so that it can refute
+        right away instead of waiting for the gossip to reach it.
+        """
+        chosen = sorted(self.updates.items(), key=lambda kv: kv[1][2])[:MAX_PIGGYBACK]
+        buddy = self.state[to] != ALIVE and to not in self.updates
+        if buddy:
+            chosen = chosen[:MAX_PIGGYBACK - 1]
+        buf = bytearray(HEADER.pack(msg_type, seq, self.id, target, len(chosen) + buddy))
+        if buddy:
+            buf += UPDATE.pack(self.state[to], to, self.inc[to])
+        limit = RETRANSMIT_MULT * math.ceil(math.log10(self.n + 1))
+        for member, entry in chosen:
+            buf += UPDATE.pack(entry[0], member, entry[1])
+            entry[2] += 1
+            if entry[2] >= limit:
+                del self.updates[member]
+        self.sent += 1
+        if self.loss and self.rng.random() < self.loss:
+            return
+        try:
+            self.sock.sendto(buf, self.address(to))
+        except OSError:
+            pass                            # a full buffer is a lost message
+
+    def take_seq(self):
+        seq = self.next_seq
+        self.next_seq = (self.next_seq + 1) & 0xFFFFFFFF
+        return seq
+
+    def next_target(self):
+        """Round-robin over a shuffled list, skipping members known to be dead."""
+        for _ in range(len(self.probe_order)):
+            if self.probe_index == len(self.probe_order):
+                self.rng.shuffle(self.probe_order)
+                self.probe_index = 0
+            target = self.probe_order[self.probe_index]
+            self.probe_index += 1
+            if self.state[target] != DEAD:
+                return target
+        return None
+
+    def random_helpers(self, exclude):
+        helpers = []
+        for _ in range(4 * INDIRECT_PROBES):
+            m = self.rng.randrange(self.n)
+            if m != self.id and m != exclude and self.state[m] == ALIVE and m not in helpers:
+                helpers.append(m)
+                if len(helpers) == INDIRECT_PROBES:
+                    break
+        return helpers
+
+
+class Worker:
+    """Drives a range of members from one event loop (one process)."""
+
+    def __init__(self, ids, args, n, victims, t_fail, rng):
+        self.args = args
+        self.n = n
+        self.period = args.period
+        self.suspicion_timeout = SUSPICION_MULT * max(1.0, math.log10(n)) * args.period
+        self.victims = victims
+        self.t_fail = t_fail
+        self.members = {i: Member(i, n, args.base_port, args.loss, random.Random(rng.random())) for i in ids}
+        self.sel = selectors.DefaultSelector()
+        for m in self.members.values():
+            self.sel.register(m.sock, selectors.EVENT_READ, m)
+        self.timers = []
+        self.counter = itertools.count()
+
+        # Results
+        self.first_suspect = {}             # victim -> earliest time anyone here suspected it
+        self.learned_dead = {v: [] for v in victims}  # victim -> times members here learned it
+        self.false_suspicions = 0           # probes of healthy members that failed
+        self.false_deaths = set()           # healthy members someone here declared dead
+        self.refutations = 0
+        self.window_sent = {}
+        self.window_received = {}
+
+    def at(self, when, fn, *args):
+        heapq.heappush(self.timers, (when, next(self.counter), fn, args))
+
+    # -- Membership updates -------------------------------------------------
+    def apply(self, m, state, who, inc, now):
+        """Applies an update to m's view; gossips it on if it is news."""
+        if who == m.id:
+            # Someone thinks we are suspect or dead: refute with a newer
+            # incarnation, or gossip the current one again if it is already newer
+            if state != ALIVE:
+                if inc >= m.incarnation:
+                    m.incarnation = inc + 1
+                    self.refutations += 1
+                m.updates[m.id] = [ALIVE, m.incarnation, 0]
+            return
+        current, current_inc = m.state[who], m.inc[who]
+        if state == ALIVE:
+            news = inc > current_inc
+        elif state == SUSPECT:
+            news = (current == ALIVE and inc >= current_inc) or (current == SUSPECT and inc > current_inc)
+        else:
+            news = current != DEAD
+        if not news:
+            return
+        m.state[who], m.inc[who] = state, inc
+        m.updates[who] = [state, inc, 0]
+        if state == SUSPECT:
+            self.at(now + self.suspicion_timeout, self.confirm, m, who, inc)
+            if who in self.victims and now >= self.t_fail:
+                self.first_suspect.setdefault(who, now)
+        elif state == DEAD:
+            if who in self.victims and now >= self.t_fail:
+                self.learned_dead[who].append(now)
+            else:
+                self.false_deaths.add(who)
+
+    def confirm(self, m, who, inc, now):
+        """Suspicion timeout: still suspected with the same incarnation -> dead."""
+        if not m.failed and m.state[who] == SUSPECT and m.inc[who] == inc:
+            self.apply(m, DEAD, who, inc, now)
+
+    # -- Probing ------------------------------------------------------------
+    def tick(self, m, now):
+        if m.failed:
+            return
+        self.at(now + self.period, self.tick, m)
+        target = m.next_target()
+        if target is None:
+            return
+        seq = m.take_seq()
+        m.pending[seq] = target
+        m.send(PING, seq, target, target)
+        self.at(now + PING_TIMEOUT * self.period, self.indirect, m, seq)
+        self.at(now + self.period, self.probe_end, m, seq)
+
+    def indirect(self, m, seq, now):
+        target = m.pending.get(seq)
+        if target is None or m.failed:
+            return
+        for helper in m.random_helpers(target):
+            m.send(PING_REQ, seq, helper, target)
+
+    def probe_end(self, m, seq, now):
+        target = m.pending.pop(seq, None)
+        if target is None or m.failed:
+            return
+        if m.state[target] == ALIVE:
+            if target not in self.victims:
+                self.false_suspicions += 1
+            self.apply(m, SUSPECT, target, m.inc[target], now)
+
+    def drop_relay(self, m, seq, now):
+        m.relays.pop(seq, None)
+
+    def receive(self, m, data, now):
+        if len(data) < HEADER.size:
+            return
+        msg_type, seq, sender, target, n_updates = HEADER.unpack_from(data)
+        m.received += 1
+        offset = HEADER.size
+        for _ in range(min(n_updates, (len(data) - offset) // UPDATE.size)):
+            state, who, inc = UPDATE.unpack_from(data, offset)
+            offset += UPDATE.size
+            if who < self.n:
+                self.apply(m, state, who, inc, now)
+
+        if msg_type == PING:
+            m.send(ACK, seq, sender, m.id)
+        elif msg_type == PING_REQ:
+            # Ping the target on the sender's behalf and relay its ACK
+            relay_seq = m.take_seq()
+            m.relays[relay_seq] = (sender, seq)
+            m.send(PING, relay_seq, target, target)
+            self.at(now + self.period, self.drop_relay, m, relay_seq)
+        elif msg_type == ACK:
+            if m.pending.pop(seq, None) is None:
+                relay = m.relays.pop(seq, None)
+                if relay is not None:
+                    m.send(ACK, relay[1], relay[0], target)
+
+    # -- Event loop ---------------------------------------------------------
+    def run(self, t_start, t_end):
+        for m in self.members.values():
+            self.at(t_start + m.rng.random() * self.period, self.tick, m)
+        self.at(self.t_fail, self.fail_victims)
+        self.at(self.t_fail, self.snapshot, self.window_sent, self.window_received)
+
+        while True:
+            now = time.monotonic()
+            if now >= t_end:
+                break
+            timeout = min(self.timers[0][0] - now, t_end - now) if self.timers else t_end - now
+            for key, _ in self.sel.select(max(0.0, timeout)):
+                m = key.data
+                for _ in range(64):
+                    try:
+                        data = m.sock.recv(MAX_MESSAGE)
+                    except BlockingIOError:
+                        break
+                    self.receive(m, data, time.monotonic())
+            now = time.monotonic()
+            while self.timers and self.timers[0][0] <= now:
+                _, _, fn, args = heapq.heappop(self.timers)
+                fn(*args, now)
+
+        window = t_end - self.t_fail
+        periods = window / self.period
+        sent = [(m.sent - self.window_sent[i]) / periods
+                for i, m in self.members.items() if not m.failed]
+        received = [(m.received - self.window_received[i]) / periods
+                    for i, m in self.members.items() if not m.failed]
+        # Healthy members that live members still believe dead at the end
+        wrong = sum(1 for m in self.members.values() if not m.failed
+                    for who, state in enumerate(m.state) if state == DEAD and who not in self.victims)
+        ru = resource.getrusage(resource.RUSAGE_SELF)
+        return {
+            "first_suspect": self.first_suspect,
+            "learned_dead": self.learned_dead,
+            "false_suspicions": self.false_suspicions,
+            "false_deaths": self.false_deaths,
+            "refutations": self.refutations,
+            "wrong_views": wrong,
+            "sent": sent,
+            "received": received,
+            "live": len(sent),
+            "cpu": ru.ru_utime + ru.ru_stime,
+        }
+
+    def fail_victims(self, now):
+        for v in self.victims:
+            m = self.members.get(v)
+            if m is not None:
+                m.failed = True
+                self.sel.unregister(m.sock)
+                m.sock.close()
+
+    def snapshot(self, sent, received, now):
+        for i, m in self.members.items():
+            sent[i], received[i] = m.sent, m.received
+
+
+def run_worker(ids, args, n, victims, t_start, t_fail, t_end, seed, conn):
+    soft, hard = resource.getrlimit(resource.RLIMIT_NOFILE)
+    resource.setrlimit(resource.RLIMIT_NOFILE, (hard, hard))
+    worker = Worker(ids, args, n, victims, t_fail, random.Random(seed))
+    conn.send("ready")
+    conn.send(worker.run(t_start, t_end))
+
+
+def simulate(n, args):
+    rng = random.Random(args.seed)
+    victims = set(rng.sample(range(n), min(args.fail, n - 1)))
+    suspicion = SUSPICION_MULT * max(1.0, math.log10(n)) * args.period
+    setup = 1.0 + n / 1000.0                     # time to create the sockets
+    t_start = time.monotonic() + setup
+    t_fail = t_start + args.warmup * args.period
+    t_end = t_fail + suspicion + args.periods_after * args.period
+
+    ctx = mp.get_context("fork")
+    procs, conns = [], []
+    for w in range(args.workers):
+        ids = range(w * n // args.workers, (w + 1) * n // args.workers)
+        parent_conn, child_conn = mp.Pipe()
+        p = ctx.Process(target=run_worker,
+                        args=(ids, args, n, victims, t_start, t_fail, t_end, rng.random(), child_conn))
+        p.start()
+        procs.append(p)
+        conns.append(parent_conn)
+    for c in conns:
+        c.recv()
+    if time.monotonic() > t_start:
+        print(f"warning: setup took longer than {setup:.1f} s, the warm-up is shorter")
+    results = [c.recv() for c in conns]
+    for p in procs:
+        p.join()
+
+    live = sum(r["live"] for r in results)
+    first_suspect, first_dead, all_dead, reached = [], [], [], []
+    for v in victims:
+        s = [r["first_suspect"][v] for r in results if v in r["first_suspect"]]
+        d = sorted(t for r in results for t in r["learned_dead"][v])
+        if s:
+            first_suspect.append(min(s) - t_fail)
+        if d:
+            first_dead.append(d[0] - t_fail)
+            reached.append(len(d) / live)
+            if len(d) >= live:
+                all_dead.append(d[-1] - t_fail)
+    sent = [x for r in results for x in r["sent"]]
+    received = [x for r in results for x in r["received"]]
+    window = t_end - t_fail
+    return {
+        "n": n,
+        "loss": args.loss,
+        "victims": len(victims),
+        "suspicion": suspicion,
+        "first_suspect": first_suspect,
+        "first_dead": first_dead,
+        "all_dead": all_dead,
+        "reached": reached,
+        "false_suspicions": sum(r["false_suspicions"] for r in results),
+        "false_deaths": len(set().union(*(r["false_deaths"] for r in results))),
+        "wrong_views": sum(r["wrong_views"] for r in results),
+        "refutations": sum(r["refutations"] for r in results),
+        "sent_mean": statistics.mean(sent),
+        "sent_max": max(sent),
+        "recv_mean": statistics.mean(received),
+        "recv_max": max(received),
+        "cpu_per_member_period": sum(r["cpu"] for r in results) / n / ((t_end - t_start) / args.period),
+        "window": window,
+    }
+
+
+def median(values):
+    return statistics.median(values) if values else float("nan")
+
+
+def print_report(r, period):
+    print(f"\n=== {r['n']} members, {r['victims']} failed, {100 * r['loss']:.0f}% loss, period {period:.2f} s, "
+          f"suspicion timeout {r['suspicion']:.1f} s ===")
+    print(f"first suspicion after the failure : median {median(r['first_suspect']):6.2f} s, "
+          f"max {max(r['first_suspect'], default=float('nan')):6.2f} s")
+    print(f"first member declares it dead     : median {median(r['first_dead']):6.2f} s, "
+          f"max {max(r['first_dead'], default=float('nan')):6.2f} s")
+    print(f"every live member knows it is dead: median {median(r['all_dead']):6.2f} s "
+          f"({len(r['all_dead'])}/{r['victims']} failures reached everyone, "
+          f"min coverage {100 * min(r['reached'], default=0):.1f}%)")
+    print(f"healthy members: {r['false_suspicions']} failed probes, {r['refutations']} refutations, "
+          f"{r['false_deaths']} declared dead, {r['wrong_views']} dead entries left at the end")
+    print(f"messages per member per period    : sent {r['sent_mean']:.2f} (max {r['sent_max']:.1f}), "
+          f"received {r['recv_mean']:.2f} (max {r['recv_max']:.1f})")
+    print(f"a central registry would receive  : {r['n'] - r['victims']} heartbeats per period")
+    print(f"CPU per member per period         : {1e6 * r['cpu_per_member_period']:.0f} us")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("--members", type=int, default=1000)
+    parser.add_argument("--sweep", help="comma-separated member counts, e.g. 100,300,1000")
+    parser.add_argument("--fail", type=int, default=10, help="members that fail after the warm-up")
+    parser.add_argument("--period", type=float, default=1.0, help="protocol period in seconds")
+    parser.add_argument("--warmup", type=int, default=5, help="periods before the failures")
+    parser.add_argument("--periods-after", type=int, default=15,
+                        help="periods simulated after failure + suspicion timeout")
+    parser.add_argument("--loss", type=float, default=0.0, help="fraction of messages dropped")
+    parser.add_argument("--workers", type=int, default=4, help="processes hosting the members")
+    parser.add_argument("--base-port", type=int, default=30000)
+    parser.add_argument("--seed", type=int, default=7)
+    args = parser.parse_args()
+
+    sizes = [int(s) for s in args.sweep.split(",")] if args.sweep else [args.members]
+    if max(sizes) > 65535 - args.base_port:
+        parser.error("not enough ports above --base-port")
+    results = []
+    for n in sizes:
+        r = simulate(n, args)
+        results.append(r)
+        print_report(r, args.period)
+
+    if len(results) > 1:
+        print("\n| Members | log10 N | First dead (s) | All know (s) | Msgs sent/member/period |")
+        print("|---------|---------|----------------|--------------|-------------------------|")
+        for r in results:
+            print(f"| {r['n']:7d} | {math.log10(r['n']):7.2f} | {median(r['first_dead']):14.2f} "
+                  f"| {median(r['all_dead']):12.2f} | {r['sent_mean']:23.2f} |")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,218 @@
+"""
+telemetry.py
+Versioned binary telemetry protocol for the Lab 1 control plane.
+
+One fixed-layout frame carries everything a slave reports: it is the
+heartbeat, the resource status (CPU, memory, network) and the progress of
+up to MAX_THREADS worker threads. It replaces the separate "HEARTBEAT" and
+"RESOURCE CPU: x%, Memory: y%" strings of the first version of lab1.py.
+
+Frame layout (big-endian, 45 bytes for version 1):
+
+    offset  size  field
+    0       4     length        bytes after this field (41 in version 1)
+    4       1     type          MSG_TELEMETRY (6, as in monitor_proto.h)
+    5       1     version       1
+    6       1     flags         FLAG_KEYFRAME on the first frame of a connection
+    7       1     n_threads     valid entries in progress[]
+    8       1     reserved
+    9       4     seq           report number
+    13      4     interval_ms   the sender's next report comes within this time
+    17      2     cpu           permille
+    19      2     mem           permille
+    21      4     net_rx        bytes received since the previous report
+    25      4     net_tx        bytes sent since the previous report
+    29      16    progress[8]   permille per worker thread
+
+Network counters are sent as deltas against the previous report, so they fit
+in 32 bits; the keyframe resets the receiver's totals. A keyframe is sent on
+each new connection and whenever a counter goes backwards. A receiver accepts
+any version >= 1 and skips bytes it does not know, so later versions can
+append fields without breaking old masters.
+
+The slave adapts its rate: after a report in which something changed by
+CHANGE_PERMILLE or more it reports again after MIN_INTERVAL; otherwise the
+interval doubles up to MAX_INTERVAL. The master derives each node's deadline
+from the interval announced in its last frame.
+"""
+
+import struct
+
+VERSION = 1
+MSG_TELEMETRY = 6
+FLAG_KEYFRAME = 0x01
+MAX_THREADS = 8
+
+MIN_INTERVAL = 1.0          # seconds, while the node is changing
+MAX_INTERVAL = 10.0         # seconds, when idle (the old resource period)
+CHANGE_PERMILLE = 20        # a 2% change counts as activity
+MISSED_REPORTS = 2          # master: dead after 2 announced intervals
+
+HEADER = struct.Struct("!IB")                       # length, type
+FRAME = struct.Struct("!IBBBBBIIHHII%dH" % MAX_THREADS)
+FRAME_SIZE = FRAME.size
+V1_LENGTH = FRAME_SIZE - 4
+READ_BUFFER = 64 * 1024
+
+
+class ProtocolError(Exception):
+    pass
+
+
+class TelemetryEncoder:
+    """Slave side: builds frames and chooses the report interval."""
+
+    def __init__(self):
+        self.seq = 0
+        self.interval = MIN_INTERVAL
+        self.last_rx = None
+        self.last_tx = None
+        self.last_cpu = -1
+        self.last_mem = -1
+        self.last_progress = [0] * MAX_THREADS
+        self.progress = [0] * MAX_THREADS
+
+    def restart(self):
+        """Call on a new connection: the next frame is a keyframe."""
+        self.last_rx = self.last_tx = None
+
+    def encode(self, cpu_percent, mem_percent, rx_total, tx_total, n_threads=0):
+        """Returns the next frame; progress comes from self.progress (permille)."""
+        cpu = min(1000, int(cpu_percent * 10))
+        mem = min(1000, int(mem_percent * 10))
+        # Counters that went backwards (e.g. a NIC went away) restart the totals
+        keyframe = (self.last_rx is None
+                    or rx_total < self.last_rx or tx_total < self.last_tx)
+        rx = 0 if keyframe else min(0xFFFFFFFF, rx_total - self.last_rx)
+        tx = 0 if keyframe else min(0xFFFFFFFF, tx_total - self.last_tx)
+
+        changed = (keyframe
+                   or abs(cpu - self.last_cpu) >= CHANGE_PERMILLE
+                   or abs(mem - self.last_mem) >= CHANGE_PERMILLE
+                   or self.progress != self.last_progress)
+        self.interval = MIN_INTERVAL if changed else min(MAX_INTERVAL, self.interval * 2)
+
+        frame = FRAME.pack(V1_LENGTH, MSG_TELEMETRY, VERSION,
+                           FLAG_KEYFRAME if keyframe else 0, n_threads, 0,
+                           self.seq, int(self.interval * 1000), cpu, mem, rx, tx,
+                           *self.progress)
+        self.seq = (self.seq + 1) & 0xFFFFFFFF
+        self.last_rx, self.last_tx = rx_total, tx_total
+        self.last_cpu, self.last_mem = cpu, mem
+        self.last_progress[:] = self.progress
+        return frame
+
+
+class NodeState:
+    """Master side: latest telemetry of one node, updated in place."""
+
+    __slots__ = ("seq", "cpu", "mem", "rx_total", "tx_total", "n_threads",
+                 "progress", "interval", "last_seen", "deadline", "frames")
+
+    def __init__(self):
+        self.seq = 0
+        self.cpu = 0
+        self.mem = 0
+        self.rx_total = 0
+        self.tx_total = 0
+        self.n_threads = 0
+        self.progress = [0] * MAX_THREADS
+        self.interval = MAX_INTERVAL
+        self.last_seen = 0.0
+        self.deadline = 0.0
+        self.frames = 0
+
+
+class TelemetryReader:
+    """Master side: reassembles frames from a stream socket.
+
+    Bytes are received with recv_into() into one preallocated buffer and
+    decoded in place with unpack_from(). The only per-frame objects are the
+    unpacked fields: no bytes copies, no decode(), no string splitting.
+    """
+
+    def __init__(self, sock, buffer_size=READ_BUFFER):
+        self.sock = sock
+        self.buf = bytearray(buffer_size)
+        self.view = memoryview(self.buf)
+        self.start = 0
+        self.end = 0
+
+    def read(self, state, now):
+        """Reads once and applies every complete frame to 'state'.
+
+        Returns the number of frames applied, or -1 when the peer closed.
+        """
+        if self.end == len(self.buf):
+            # Move the partial frame to the front to make room
+            pending = self.end - self.start
+            self.buf[:pending] = self.view[self.start:self.end]
+            self.start, self.end = 0, pending
+        n = self.sock.recv_into(self.view[self.end:])
+        if n == 0:
+            return -1
+        self.end += n
+        return self.parse(state, now)
+
+    def feed(self, data, state, now):
+        """Like read(), for bytes an event loop has already received.
+
+        Used with sock=None by the master on lab/server_core.py. The buffer
+        stays the same size: 'data' is copied in and parsed piece by piece.
+        """
+        data = memoryview(data)
+        frames = 0
+        while data:
+            if self.end == len(self.buf):
+                pending = self.end - self.start
+                if pending == len(self.buf):
+                    raise ProtocolError("frame larger than the read buffer")
+                self.buf[:pending] = self.view[self.start:self.end]
+                self.start, self.end = 0, pending
+            n = min(len(data), len(self.buf) - self.end)
+            self.buf[self.end:self.end + n] = data[:n]
+            self.end += n
+            data = data[n:]
+            frames += self.parse(state, now)
+        return frames
+
+    def parse(self, state, now):
+        frames = 0
+        buf, start, end = self.buf, self.start, self.end
+        while end - start >= HEADER.size:
+            length, msg_type = HEADER.unpack_from(buf, start)
+            if msg_type != MSG_TELEMETRY or length < V1_LENGTH or length > len(buf) - 4:
+                raise ProtocolError("bad frame (type %d, length %d)" % (msg_type, length))
+            if end - start < 4 + length:
+                break
+            (_, _, version, flags, n_threads, _, seq, interval_ms, cpu, mem,
+             rx, tx, *progress) = FRAME.unpack_from(buf, start)
+            if version < 1:
+                raise ProtocolError("unknown version %d" % version)
+            if flags & FLAG_KEYFRAME:
+                state.rx_total = state.tx_total = 0
+            state.seq = seq
+            state.cpu = cpu
+            state.mem = mem
+            state.rx_total += rx
+            state.tx_total += tx
+            state.n_threads = min(n_threads, MAX_THREADS)
+            state.progress[:] = progress
+            state.interval = interval_ms / 1000.0
+            state.last_seen = now
+            state.deadline = now + MISSED_REPORTS * state.interval
+            state.frames += 1
+            frames += 1
+            start += 4 + length          # skips fields added by later versions
+        if start == end:
+            start = end = 0
+        self.start, self.end = start, end
+        return frames
+
+
+def sample_resources():
+    """CPU %, memory % and total network bytes (rx, tx) of this host."""
+    import psutil
+    net = psutil.net_io_counters()
+    return (psutil.cpu_percent(), psutil.virtual_memory().percent,
+            net.bytes_recv, net.bytes_sent)
@@ -0,0 +1,302 @@
+#!/usr/bin/env python3
+"""
+Master CPU per node: ASCII heartbeat strings vs. binary telemetry frames.
+
+A master process accepts N simulated slaves over plain TCP (no TLS, so only
+the protocol and the master design are measured) and handles their reports
+in one of three ways:
+
+  ascii-threads    the first lab1.py master: one thread per slave,
+                   recv(1024), decode(), startswith(), print per message;
+                   slaves send HEARTBEAT every 5 s and RESOURCE every 10 s
+  binary-threads   the current lab1.py master: one thread per slave,
+                   TelemetryReader decodes frames into a NodeState
+  binary-selector  the same decoder driven by ONE selectors loop
+  binary-c-monitor the epoll daemon monitor.c (compile it first; skipped if
+                   --monitor does not exist), which decodes the same frames
+
+Binary slaves use TelemetryEncoder, so their rate adapts: a fraction of the
+nodes (--busy) changes its CPU load all the time, the rest are idle.
+
+Time is compressed by --speed (a 5 s heartbeat is sent every 5/speed s).
+The master's CPU time (user + system) and the result is printed
+as CPU milliseconds per node per (simulated) minute.
+
+Run examples:
+    python telemetry_bench.py
+    python telemetry_bench.py --nodes 500 --seconds 10 --speed 50
+    gcc -O2 -o monitor monitor.c -lpthread && python telemetry_bench.py --monitor ./monitor
+
+No external libraries are required.
+"""
+
+import argparse
+import heapq
+import multiprocessing as mp
+import os
+import random
+import resource
+import selectors
+import socket
+import struct
+import subprocess
+import sys
+import threading
+import time
+
+from telemetry import TelemetryEncoder, TelemetryReader, NodeState
+
+MODES = ("ascii-threads", "binary-threads", "binary-selector", "binary-c-monitor")
+HELLO = struct.Struct("!IBI")          # length, MSG_HELLO, node id (monitor_proto.h)
+
+
+# ---------------------------------------------------------------------------
+# Master side (runs in a child process)
+# ---------------------------------------------------------------------------
+def ascii_handler(sock, addr, slaves, lock, counter):
+    """The message handling of the first lab1.py master."""
+    with sock:
+        while True:
+            data = sock.recv(1024).decode()
+            if not data:
+                break
+            counter[0] += 1
+            if data.startswith("HEARTBEAT"):
+                with lock:
+                    slaves[addr] = time.time()
+                print(f"Heartbeat received from {addr}")
+            elif data.startswith("RESOURCE"):
+                resource_data = data.split(" ", 1)[1]
+                print(f"Resource data from {addr}: {resource_data}")
+
+
+def binary_handler(sock, addr, slaves, lock, counter):
+    """The message handling of the current lab1.py master."""
+    state = NodeState()
+    reader = TelemetryReader(sock)
+    with lock:
+        slaves[addr] = state
+    with sock:
+        while True:
+            n = reader.read(state, time.time())
+            if n < 0:
+                break
+            counter[0] += n
+
+
+def run_master(mode, listener, conn):
+    # The ASCII master prints per message, like lab1.py; discard the output
+    sys.stdout = open(os.devnull, "w")
+    slaves, lock, counter = {}, threading.Lock(), [0]
+    stop = threading.Event()
+
+    if mode == "binary-selector":
+        def loop():
+            sel = selectors.DefaultSelector()
+            listener.setblocking(False)
+            sel.register(listener, selectors.EVENT_READ, None)
+            while not stop.is_set():
+                for key, _ in sel.select(timeout=0.1):
+                    if key.data is None:
+                        sock, addr = listener.accept()
+                        sock.setblocking(False)
+                        state = NodeState()
+                        slaves[addr] = state
+                        sel.register(sock, selectors.EVENT_READ, (TelemetryReader(sock), state))
+                    else:
+                        reader, state = key.data
+                        n = reader.read(state, time.time())
+                        if n < 0:
+                            sel.unregister(key.fileobj)
+                            key.fileobj.close()
+                        else:
+                            counter[0] += n
+        threading.Thread(target=loop, daemon=True).start()
+    else:
+        handler = ascii_handler if mode == "ascii-threads" else binary_handler
+
+        def accept_loop():
+            while True:
+                sock, addr = listener.accept()
+                threading.Thread(target=handler, args=(sock, addr, slaves, lock, counter),
+                                 daemon=True).start()
+        threading.Thread(target=accept_loop, daemon=True).start()
+
+    conn.recv()                        # "start": reset the CPU baseline
+    ru0 = resource.getrusage(resource.RUSAGE_SELF)
+    frames0 = counter[0]
+    conn.send("ready")
+    conn.recv()                        # "stop"
+    ru1 = resource.getrusage(resource.RUSAGE_SELF)
+    stop.set()
+    cpu = (ru1.ru_utime - ru0.ru_utime) + (ru1.ru_stime - ru0.ru_stime)
+    conn.send((cpu, counter[0] - frames0))
+
+
+# ---------------------------------------------------------------------------
+# Slave side (all simulated slaves run in the parent process)
+# ---------------------------------------------------------------------------
+def drive_slaves(mode, socks, seconds, speed, busy_fraction, rng):
+    """Sends every slave's reports on schedule; returns (messages, bytes)."""
+    messages = sent_bytes = 0
+    start = time.monotonic()
+    events = []                        # (due time, slave index, kind)
+    encoders, busy, rx = [], [], []
+
+    for i in range(len(socks)):
+        offset = rng.random()          # spread the slaves over the period
+        if mode == "ascii-threads":
+            heapq.heappush(events, (start + offset * 5 / speed, i, "HEARTBEAT"))
+            heapq.heappush(events, (start + offset * 10 / speed, i, "RESOURCE"))
+        else:
+            encoders.append(TelemetryEncoder())
+            busy.append(rng.random() < busy_fraction)
+            rx.append(0)
+            heapq.heappush(events, (start + offset * 0.5 / speed, i, "TELEMETRY"))
+
+    cpu = 10.0
+    while True:
+        due, i, kind = events[0]
+        if due - start >= seconds:
+            break
+        delay = due - time.monotonic()
+        if delay > 0:
+            time.sleep(delay)
+        heapq.heappop(events)
+
+        if kind == "HEARTBEAT":
+            data, period = b"HEARTBEAT", 5
+        elif kind == "RESOURCE":
+            cpu = rng.uniform(0, 100)
+            data = f"RESOURCE CPU: {cpu:.1f}%, Memory: 40.0%".encode()
+            period = 10
+        else:
+            enc = encoders[i]
+            load = rng.uniform(0, 100) if busy[i] else 10.0
+            rx[i] += rng.randrange(100, 10000) if busy[i] else 100
+            data = enc.encode(load, 40.0, rx[i], rx[i] // 2)
+            period = enc.interval
+        socks[i].sendall(data)
+        messages += 1
+        sent_bytes += len(data)
+        heapq.heappush(events, (due + period / speed, i, kind))
+    return messages, sent_bytes
+
+
+def process_cpu(pid):
+    """User + system CPU seconds of another process (Linux /proc)."""
+    with open(f"/proc/{pid}/stat") as f:
+        fields = f.read().rsplit(")", 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")
+
+
+def measure_c_monitor(args):
+    probe = socket.socket()
+    probe.bind(("127.0.0.1", 0))
+    port = probe.getsockname()[1]
+    probe.close()
+    daemon = subprocess.Popen([args.monitor, str(port), "1", "10000"],
+                              stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    time.sleep(0.3)
+
+    socks = []
+    for i in range(args.nodes):
+        s = socket.create_connection(("127.0.0.1", port))
+        s.sendall(HELLO.pack(5, 1, i + 1))
+        socks.append(s)
+    time.sleep(0.5)
+    cpu0 = process_cpu(daemon.pid)
+    messages, sent_bytes = drive_slaves("binary-c-monitor", socks, args.seconds, args.speed,
+                                        args.busy, random.Random(args.seed))
+    time.sleep(0.2)
+    cpu = process_cpu(daemon.pid) - cpu0
+
+    for s in socks:
+        s.close()
+    daemon.terminate()
+    daemon.wait()
+    return cpu, messages, messages, sent_bytes
+
+
+def measure(mode, args):
+    if mode == "binary-c-monitor":
+        cpu, messages, handled, sent_bytes = measure_c_monitor(args)
+    else:
+        listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        listener.bind(("127.0.0.1", 0))
+        listener.listen(1024)
+        port = listener.getsockname()[1]
+
+        parent_conn, child_conn = mp.Pipe()
+        master = mp.get_context("fork").Process(target=run_master,
+                                                args=(mode, listener, child_conn))
+        master.start()
+        listener.close()
+
+        socks = [socket.create_connection(("127.0.0.1", port)) for _ in range(args.nodes)]
+        time.sleep(0.5)                # let the master accept everyone
+        parent_conn.send("start")
+        parent_conn.recv()
+        messages, sent_bytes = drive_slaves(mode, socks, args.seconds, args.speed, args.busy,
+                                            random.Random(args.seed))
+        time.sleep(0.2)                # let the master drain its sockets
+        parent_conn.send("stop")
+        cpu, handled = parent_conn.recv()
+
+        for s in socks:
+            s.close()
+        master.terminate()
+        master.join()
+
+    minutes = args.seconds * args.speed / 60.0
+    return {
+        "mode": mode,
+        "messages": messages,
+        "handled": handled,
+        "bytes_per_node_min": sent_bytes / args.nodes / minutes,
+        "msgs_per_node_min": messages / args.nodes / minutes,
+        "cpu_ms_per_node_min": 1000.0 * cpu / args.nodes / minutes,
+        "cpu_us_per_msg": 1e6 * cpu / max(1, messages),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("--nodes", type=int, default=200)
+    parser.add_argument("--seconds", type=float, default=10.0, help="wall time per mode")
+    parser.add_argument("--speed", type=float, default=30.0, help="time compression factor")
+    parser.add_argument("--busy", type=float, default=0.1, help="fraction of busy nodes")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--monitor", default="./monitor", help="path of the compiled monitor.c")
+    args = parser.parse_args()
+
+    soft, hard = resource.getrlimit(resource.RLIMIT_NOFILE)
+    resource.setrlimit(resource.RLIMIT_NOFILE, (hard, hard))
+
+    print(f"{args.nodes} nodes, {args.seconds:.0f} s per mode at {args.speed:.0f}x "
+          f"({args.seconds * args.speed / 60:.1f} simulated minutes), "
+          f"{args.busy * 100:.0f}% busy nodes\n")
+    print("| Master           | Msgs/node/min | Bytes/node/min | CPU us/msg | CPU ms/node/min |")
+    print("|------------------|---------------|----------------|------------|-----------------|")
+    results = []
+    for mode in MODES:
+        if mode == "binary-c-monitor" and not os.access(args.monitor, os.X_OK):
+            print(f"| {mode:<16} | (skipped: {args.monitor} not found)")
+            continue
+        r = measure(mode, args)
+        results.append(r)
+        print(f"| {r['mode']:<16} | {r['msgs_per_node_min']:13.1f} | {r['bytes_per_node_min']:14.0f} "
+              f"| {r['cpu_us_per_msg']:10.1f} | {r['cpu_ms_per_node_min']:15.3f} |")
+        if r["handled"] < r["messages"] and r["mode"] != "ascii-threads":
+            print(f"  warning: master handled {r['handled']} of {r['messages']} frames")
+
+    base = results[0]["cpu_ms_per_node_min"]
+    for r in results[1:]:
+        print(f"\n{r['mode']}: {base / r['cpu_ms_per_node_min']:.1f}x less master CPU per node "
+              f"than ascii-threads", end="")
+    print()
+
+
+if __name__ == "__main__":
+    main()
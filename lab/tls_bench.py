@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+"""
+Handshakes/sec and master CPU: new TLS connections vs. resumption vs. reuse.
+
+A master process accepts TLS 1.3 connections with ONE shared server
+SSLContext and reads 9-byte "HEARTBEAT" messages. The client (this process)
+sends --count heartbeats in one of four ways:
+
+  new-context     a new TCP connection, a new client SSLContext and a full
+                  handshake for every heartbeat (the CS2 heartbeat node with
+                  TLS, and what a slave does if it builds its context per call)
+  shared-context  a new connection and a full handshake per heartbeat, but
+                  one client SSLContext for all of them
+  resumed         a new connection per heartbeat that resumes the previous
+                  TLS session from its session ticket (no certificate
+                  exchange, no signature)
+  persistent      one connection for all heartbeats (the lab1.py slave)
+
+The master measures its own CPU time (user + system) while the client runs;
+the result is printed as handshakes/sec and master CPU per heartbeat.
+
+A temporary self-signed certificate is generated with the openssl command
+line tool (--key-bits sets the RSA key size; lab1.md uses 2048).
+
+Run examples:
+    python tls_bench.py
+    python tls_bench.py --count 2000 --key-bits 4096
+
+No external libraries are required.
+"""
+
+import argparse
+import multiprocessing as mp
+import os
+import resource
+import socket
+import ssl
+import subprocess
+import tempfile
+import threading
+import time
+
+MODES = ("new-context", "shared-context", "resumed", "persistent")
+HEARTBEAT = b"HEARTBEAT"
+
+
+def make_certificate(directory, key_bits):
+    certfile = os.path.join(directory, "server.crt")
+    keyfile = os.path.join(directory, "server.key")
+    subprocess.run(["openssl", "req", "-x509", "-newkey", f"rsa:{key_bits}", "-nodes",
+                    "-keyout", keyfile, "-out", certfile, "-days", "1", "-subj", "/CN=localhost"],
+                   check=True, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    return certfile, keyfile
+
+
+def server_context(certfile, keyfile):
+    context = ssl.create_default_context(ssl.Purpose.CLIENT_AUTH)
+    context.load_cert_chain(certfile=certfile, keyfile=keyfile)
+    context.minimum_version = ssl.TLSVersion.TLSv1_3
+    context.num_tickets = 2
+    return context
+
+
+def client_context():
+    context = ssl.create_default_context(ssl.Purpose.SERVER_AUTH)
+    context.check_hostname = False
+    context.verify_mode = ssl.CERT_NONE
+    context.minimum_version = ssl.TLSVersion.TLSv1_3
+    return context
+
+
+# ---------------------------------------------------------------------------
+# Master side (runs in a child process)
+# ---------------------------------------------------------------------------
+def handle(context, sock, counters, lock):
+    try:
+        with context.wrap_socket(sock, server_side=True) as secure:
+            with lock:
+                counters["handshakes"] += 1
+                counters["resumed"] += secure.session_reused
+            while True:
+                data = secure.recv(1024)
+                if not data:
+                    break
+                with lock:
+                    counters["heartbeats"] += data.count(HEARTBEAT)
+    except (ssl.SSLError, OSError):
+        pass
+
+
+def run_master(listener, certfile, keyfile, conn):
+    context = server_context(certfile, keyfile)
+    counters, lock = {"handshakes": 0, "resumed": 0, "heartbeats": 0}, threading.Lock()
+
+    def accept_loop():
+        while True:
+            sock, _ = listener.accept()
+            threading.Thread(target=handle, args=(context, sock, counters, lock),
+                             daemon=True).start()
+    threading.Thread(target=accept_loop, daemon=True).start()
+
+    while conn.recv() == "start":
+        ru0 = resource.getrusage(resource.RUSAGE_SELF)
+        with lock:
+            before = dict(counters)
+        conn.send("ready")
+        conn.recv()                    # "stop"
+        ru1 = resource.getrusage(resource.RUSAGE_SELF)
+        cpu = (ru1.ru_utime - ru0.ru_utime) + (ru1.ru_stime - ru0.ru_stime)
+        with lock:
+            delta = {k: counters[k] - before[k] for k in counters}
+        conn.send((cpu, delta))
+
+
+# ---------------------------------------------------------------------------
+# Client side
+# ---------------------------------------------------------------------------
+def connect(port, context, session=None):
+    raw = socket.create_connection(("127.0.0.1", port))
+    return context.wrap_socket(raw, server_hostname="localhost", session=session)
+
+
+def collect_ticket(secure):
+    """TLS 1.3 tickets arrive after the handshake and are read lazily."""
+    secure.settimeout(0.05)
+    try:
+        secure.recv(1)
+    except (socket.timeout, ssl.SSLWantReadError):
+        pass
+    secure.settimeout(None)
+    return secure.session
+
+
+def finish(secure):
+    """Closes our side and waits for the master to close.
+
+    Closing right away would reset the connection if the master's session
+    tickets are still unread, and the reset can discard heartbeats that the
+    master has not read yet.
+    """
+    secure.shutdown(socket.SHUT_WR)
+    while secure.recv(1024):
+        pass
+    secure.close()
+
+
+def run_client(mode, port, count):
+    shared = client_context()
+    if mode == "persistent":
+        secure = connect(port, shared)
+        for _ in range(count):
+            secure.sendall(HEARTBEAT)
+        finish(secure)
+        return
+
+    session = None
+    if mode == "resumed":
+        with connect(port, shared) as secure:   # one full handshake for the ticket
+            session = collect_ticket(secure)
+    for _ in range(count):
+        context = client_context() if mode == "new-context" else shared
+        secure = connect(port, context, session)
+        secure.sendall(HEARTBEAT)
+        if mode == "resumed" and not secure.session_reused:
+            session = collect_ticket(secure)
+        finish(secure)
+
+
+def measure(mode, port, conn, count):
+    conn.send("start")
+    conn.recv()
+    t0 = time.perf_counter()
+    run_client(mode, port, count)
+    elapsed = time.perf_counter() - t0
+    time.sleep(0.2)                    # let the master finish the last connections
+    conn.send("stop")
+    cpu, delta = conn.recv()
+    return {
+        "mode": mode,
+        "elapsed": elapsed,
+        "handshakes": delta["handshakes"],
+        "resumed": delta["resumed"],
+        "heartbeats": delta["heartbeats"],
+        "handshakes_per_sec": delta["handshakes"] / elapsed,
+        "heartbeats_per_sec": delta["heartbeats"] / elapsed,
+        "cpu_us_per_heartbeat": 1e6 * cpu / max(1, delta["heartbeats"]),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("--count", type=int, default=300, help="heartbeats per mode")
+    parser.add_argument("--key-bits", type=int, default=2048, help="RSA key size of the master")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as directory:
+        certfile, keyfile = make_certificate(directory, args.key_bits)
+
+        listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        listener.bind(("127.0.0.1", 0))
+        listener.listen(128)
+        port = listener.getsockname()[1]
+
+        parent_conn, child_conn = mp.Pipe()
+        master = mp.get_context("fork").Process(target=run_master,
+                                                args=(listener, certfile, keyfile, child_conn))
+        master.start()
+        listener.close()
+
+        print(f"{args.count} heartbeats per mode, RSA-{args.key_bits} master certificate, "
+              f"{ssl.OPENSSL_VERSION}\n")
+        print("| Client         | Handshakes | Resumed | Handshakes/s | Heartbeats/s | Master CPU us/heartbeat |")
+        print("|----------------|------------|---------|--------------|--------------|-------------------------|")
+        results = []
+        for mode in MODES:
+            r = measure(mode, port, parent_conn, args.count)
+            results.append(r)
+            print(f"| {r['mode']:<14} | {r['handshakes']:10d} | {r['resumed']:7d} "
+                  f"| {r['handshakes_per_sec']:12.0f} | {r['heartbeats_per_sec']:12.0f} "
+                  f"| {r['cpu_us_per_heartbeat']:23.1f} |")
+        parent_conn.send("exit")
+        master.join()
+
+    base = results[0]["cpu_us_per_heartbeat"]
+    for r in results[1:]:
+        print(f"\n{r['mode']}: {base / r['cpu_us_per_heartbeat']:.1f}x less master CPU per heartbeat "
+              f"than new-context", end="")
+    print()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,164 @@
+// transfer_bench.c
+// Cost of the copies around an uncompressed chunk transfer (lab2.md 5.4).
+//
+// Rank 0 sends one chunk of an array to rank 1, which puts it in the same
+// place in its own array and sends it back; this round trip is repeated.
+// The array holds NUM_CHUNKS chunks, laid out either contiguously or
+// block-cyclically (blocks of <block> elements dealt round robin). Modes:
+//
+//   copy      the chunk is copied into a contiguous byte buffer, sent as
+//             bytes, and copied out of the buffer on the other side
+//   zerocopy  the chunk is sent and received in place, described by an
+//             MPI derived datatype (contiguous or vector)
+//
+// copy_us is the time rank 0 spends copying per round trip.
+//
+// Output is CSV:
+//   mode,layout,elements,round_trips,us_per_round_trip,payload_gb_per_s,copy_us,correct
+//
+// Compile: mpicc -O2 -o transfer_bench transfer_bench.c -lpthread -lz
+// Run:     mpirun -np 2 ./transfer_bench [max_elements] > transfer.csv
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bufpool.h"
+
+#define NUM_CHUNKS 10
+#define CHUNK      3     // the chunk that travels
+
+static const int blocks[] = { 0, 1024, 16 };   // 0: contiguous
+
+enum { MODE_COPY, MODE_ZEROCOPY };
+static const char* const mode_names[] = { "copy", "zerocopy" };
+
+static int* chunk_start(int* full, int elements, int block) {
+    return &full[block > 0 ? CHUNK * block : CHUNK * elements];
+}
+
+static void gather(const int* full, int elements, int block, int* dst) {
+    if (block == 0) {
+        memcpy(dst, &full[CHUNK * elements], elements * sizeof(int));
+        return;
+    }
+    for (int b = 0; b < elements / block; b++) {
+        memcpy(&dst[b * block], &full[(b * NUM_CHUNKS + CHUNK) * block], block * sizeof(int));
+    }
+}
+
+static void scatter(int* full, int elements, int block, const int* src) {
+    if (block == 0) {
+        memcpy(&full[CHUNK * elements], src, elements * sizeof(int));
+        return;
+    }
+    for (int b = 0; b < elements / block; b++) {
+        memcpy(&full[(b * NUM_CHUNKS + CHUNK) * block], &src[b * block], block * sizeof(int));
+    }
+}
+
+// One round trip; returns the seconds rank 0 spent copying
+static double round_trip(int rank, int mode, int* full, int elements, int block,
+                         MPI_Datatype type, void* buffer) {
+    int peer = 1 - rank;
+    size_t bytes = elements * sizeof(int);
+    double copying = 0, t0;
+
+    for (int leg = 0; leg < 2; leg++) {
+        int sending = (leg == 0) == (rank == 0);
+        if (mode == MODE_ZEROCOPY) {
+            if (sending) MPI_Send(chunk_start(full, elements, block), 1, type, peer, 0, MPI_COMM_WORLD);
+            else MPI_Recv(chunk_start(full, elements, block), 1, type, peer, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        } else if (sending) {
+            t0 = MPI_Wtime();
+            gather(full, elements, block, buffer);
+            copying += MPI_Wtime() - t0;
+            MPI_Send(buffer, bytes, MPI_UNSIGNED_CHAR, peer, 0, MPI_COMM_WORLD);
+        } else {
+            MPI_Recv(buffer, bytes, MPI_UNSIGNED_CHAR, peer, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            t0 = MPI_Wtime();
+            scatter(full, elements, block, buffer);
+            copying += MPI_Wtime() - t0;
+        }
+    }
+    return copying;
+}
+
+int main(int argc, char** argv) {
+    int rank, size;
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    if (size != 2) {
+        if (rank == 0) fprintf(stderr, "transfer_bench needs exactly 2 ranks\n");
+        MPI_Finalize();
+        return 1;
+    }
+    int max_elements = argc > 1 ? atoi(argv[1]) : 1000000;
+    bufpool_init();
+
+    if (rank == 0) printf("mode,layout,elements,round_trips,us_per_round_trip,payload_gb_per_s,copy_us,correct\n");
+    for (int elements = 1024; elements <= max_elements; elements *= 4) {
+        size_t bytes = elements * sizeof(int);
+        int* full = malloc(bytes * NUM_CHUNKS);
+        void* buffer = bufpool_get(bytes);
+        int rounds = 20 + (int)(200000000L / bytes);
+
+        for (int bi = 0; bi < (int)(sizeof(blocks) / sizeof(blocks[0])); bi++) {
+            int block = blocks[bi];
+            if (block > 0 && elements % block != 0) continue;
+            MPI_Datatype type;
+            if (block == 0) MPI_Type_contiguous(elements, MPI_INT, &type);
+            else MPI_Type_vector(elements / block, block, block * NUM_CHUNKS, MPI_INT, &type);
+            MPI_Type_commit(&type);
+
+            for (int mode = MODE_COPY; mode <= MODE_ZEROCOPY; mode++) {
+                for (long i = 0; i < (long)elements * NUM_CHUNKS; i++) full[i] = rank == 0 ? (int)i : -1;
+                round_trip(rank, mode, full, elements, block, type, buffer); // warm-up
+
+                MPI_Barrier(MPI_COMM_WORLD);
+                double copying = 0, t0 = MPI_Wtime();
+                for (int r = 0; r < rounds; r++) {
+                    copying += round_trip(rank, mode, full, elements, block, type, buffer);
+                }
+                double elapsed = MPI_Wtime() - t0;
+
+                // Rank 1 must now hold exactly rank 0's chunk, and nothing else
+                long wrong = 0;
+                if (rank == 1) {
+                    int* expect = malloc(bytes);
+                    for (int k = 0; k < elements; k++) {
+                        expect[k] = block > 0 ? ((k / block) * NUM_CHUNKS + CHUNK) * block + k % block
+                                              : CHUNK * elements + k;
+                    }
+                    int* got = malloc(bytes);
+                    gather(full, elements, block, got);
+                    for (int k = 0; k < elements; k++) wrong += got[k] != expect[k];
+                    for (long i = 0; i < (long)elements * NUM_CHUNKS; i++) wrong += full[i] != -1;
+                    wrong -= elements;  // the chunk's own elements were counted as not -1
+                    free(got);
+                    free(expect);
+                }
+                MPI_Bcast(&wrong, 1, MPI_LONG, 1, MPI_COMM_WORLD);
+
+                if (rank == 0) {
+                    char layout[32] = "contiguous";
+                    if (block > 0) snprintf(layout, sizeof(layout), "cyclic-%d", block);
+                    double us = 1e6 * elapsed / rounds;
+                    printf("%s,%s,%d,%d,%.2f,%.3f,%.2f,%s\n", mode_names[mode], layout, elements,
+                           rounds, us, 2.0 * bytes / (us * 1e3), 1e6 * copying / rounds,
+                           wrong == 0 ? "yes" : "no");
+                    fflush(stdout);
+                }
+            }
+            MPI_Type_free(&type);
+        }
+        bufpool_put(buffer);
+        free(full);
+    }
+
+    bufpool_destroy();
+    MPI_Finalize();
+    return 0;
+}